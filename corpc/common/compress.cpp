@@ -0,0 +1,353 @@
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include "corpc/common/compress.h"
+#include "corpc/common/log.h"
+#include "corpc/net/byte_util.h"
+
+#ifdef CORPC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef CORPC_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace corpc {
+
+// 按id索引的已注册算法，注册只在启动时进行，查找不加锁
+struct CompressorRegistry {
+    Compressor::ptr compressors[COMPRESS_MAX + 1];
+    std::mutex mutex;
+
+    CompressorRegistry()
+    {
+        compressors[COMPRESS_ZLIB] = std::make_shared<ZlibCompressor>(false);
+        compressors[COMPRESS_GZIP] = std::make_shared<ZlibCompressor>(true);
+#ifdef CORPC_HAVE_ZSTD
+        compressors[COMPRESS_ZSTD] = std::make_shared<ZstdCompressor>();
+#endif
+#ifdef CORPC_HAVE_LZ4
+        compressors[COMPRESS_LZ4] = std::make_shared<Lz4Compressor>();
+#endif
+    }
+};
+
+static CompressorRegistry &getRegistry()
+{
+    static CompressorRegistry registry;
+    return registry;
+}
+
+bool Compressor::registerCompressor(Compressor::ptr compressor)
+{
+    if (!compressor || compressor->type() <= COMPRESS_NONE || compressor->type() > COMPRESS_MAX) {
+        LOG_ERROR << "register compressor error, invalid type";
+        return false;
+    }
+    CompressorRegistry &registry = getRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    registry.compressors[compressor->type()] = compressor;
+    LOG_INFO << "succ register compressor[" << compressor->name() << "], type=" << compressor->type();
+    return true;
+}
+
+Compressor *Compressor::get(int type)
+{
+    if (type <= COMPRESS_NONE || type > COMPRESS_MAX) {
+        return nullptr;
+    }
+    return getRegistry().compressors[type].get();
+}
+
+Compressor *Compressor::get(const std::string &name)
+{
+    CompressorRegistry &registry = getRegistry();
+    for (int i = COMPRESS_NONE + 1; i <= COMPRESS_MAX; ++i) {
+        if (registry.compressors[i] && registry.compressors[i]->name() == name) {
+            return registry.compressors[i].get();
+        }
+    }
+    return nullptr;
+}
+
+Compressor *Compressor::getByContentEncoding(const std::string &encoding)
+{
+    if (encoding == "deflate") {
+        return get(COMPRESS_ZLIB);
+    }
+    return get(encoding);
+}
+
+std::string Compressor::getNames()
+{
+    CompressorRegistry &registry = getRegistry();
+    std::string names;
+    for (int i = COMPRESS_NONE + 1; i <= COMPRESS_MAX; ++i) {
+        if (registry.compressors[i]) {
+            if (!names.empty()) {
+                names += ",";
+            }
+            names += registry.compressors[i]->name();
+        }
+    }
+    return names;
+}
+
+uint64_t Compressor::parseNames(const std::string &names)
+{
+    uint64_t mask = 0;
+    size_t start = 0;
+    while (start <= names.size()) {
+        size_t end = names.find(',', start);
+        if (end == names.npos) {
+            end = names.size();
+        }
+        Compressor *compressor = get(names.substr(start, end - start));
+        if (compressor) {
+            mask |= 1ULL << compressor->type();
+        }
+        start = end + 1;
+    }
+    return mask;
+}
+
+// 每个线程缓存的zlib上下文，压缩和解压时只需要reset
+struct ZlibStreams {
+    z_stream deflateStreams[2];
+    z_stream inflateStreams[2];
+    bool deflateInit[2]{false, false};
+    int deflateLevel[2]{0, 0};
+    bool inflateInit[2]{false, false};
+
+    ~ZlibStreams()
+    {
+        for (int i = 0; i < 2; ++i) {
+            if (deflateInit[i]) {
+                deflateEnd(&deflateStreams[i]);
+            }
+            if (inflateInit[i]) {
+                inflateEnd(&inflateStreams[i]);
+            }
+        }
+    }
+};
+
+static thread_local ZlibStreams tZlibStreams;
+
+ZlibCompressor::ZlibCompressor(bool gzip, int level/* = -1*/)
+    : Compressor(gzip ? COMPRESS_GZIP : COMPRESS_ZLIB, gzip ? "gzip" : "zlib"), gzip_(gzip), level_(level)
+{
+}
+
+bool ZlibCompressor::compress(const char *data, size_t len, std::string &out)
+{
+    int i = gzip_ ? 1 : 0;
+    z_stream &stream = tZlibStreams.deflateStreams[i];
+    if (tZlibStreams.deflateInit[i] && tZlibStreams.deflateLevel[i] != level_) {
+        deflateEnd(&stream);
+        tZlibStreams.deflateInit[i] = false;
+    }
+    if (!tZlibStreams.deflateInit[i]) {
+        memset(&stream, 0, sizeof(stream));
+        // windowBits加16时输出gzip格式
+        if (deflateInit2(&stream, level_, Z_DEFLATED, gzip_ ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            LOG_ERROR << "deflateInit2 error";
+            return false;
+        }
+        tZlibStreams.deflateInit[i] = true;
+        tZlibStreams.deflateLevel[i] = level_;
+    }
+    else {
+        deflateReset(&stream);
+    }
+
+    size_t start = out.size();
+    out.resize(start + deflateBound(&stream, len));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = len;
+    stream.next_out = reinterpret_cast<Bytef *>(&out[start]);
+    stream.avail_out = out.size() - start;
+    int ret = deflate(&stream, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        LOG_ERROR << "deflate error, ret=" << ret;
+        out.resize(start);
+        return false;
+    }
+    out.resize(start + stream.total_out);
+    return true;
+}
+
+bool ZlibCompressor::decompress(const char *data, size_t len, std::string &out, size_t maxLen)
+{
+    int i = gzip_ ? 1 : 0;
+    z_stream &stream = tZlibStreams.inflateStreams[i];
+    if (!tZlibStreams.inflateInit[i]) {
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, gzip_ ? 15 + 16 : 15) != Z_OK) {
+            LOG_ERROR << "inflateInit2 error";
+            return false;
+        }
+        tZlibStreams.inflateInit[i] = true;
+    }
+    else {
+        inflateReset(&stream);
+    }
+
+    size_t start = out.size();
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = len;
+    size_t size = std::min(maxLen, std::max<size_t>(len * 4, 256));
+    while (true) {
+        out.resize(start + size);
+        stream.next_out = reinterpret_cast<Bytef *>(&out[start + stream.total_out]);
+        stream.avail_out = size - stream.total_out;
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            LOG_ERROR << "inflate error, ret=" << ret;
+            out.resize(start);
+            return false;
+        }
+        // 输入已经用完但是没有结束，数据不完整
+        if (stream.avail_out != 0 || size >= maxLen) {
+            LOG_ERROR << "inflate error, data truncated or larger than " << maxLen << " bytes";
+            out.resize(start);
+            return false;
+        }
+        size = std::min(maxLen, size * 2);
+    }
+    out.resize(start + stream.total_out);
+    return true;
+}
+
+#ifdef CORPC_HAVE_ZSTD
+// 每个线程缓存的zstd上下文，所有ZstdCompressor共用
+struct ZstdContexts {
+    ZSTD_CCtx *cctx{nullptr};
+    ZSTD_DCtx *dctx{nullptr};
+
+    ~ZstdContexts()
+    {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+static thread_local ZstdContexts tZstdContexts;
+
+ZstdCompressor::ZstdCompressor(int level/* = 1*/, const std::string &dict/* = ""*/, int type/* = COMPRESS_ZSTD*/, const std::string &name/* = "zstd"*/)
+    : Compressor(type, name), level_(level)
+{
+    if (!dict.empty()) {
+        cdict_ = ZSTD_createCDict(dict.data(), dict.size(), level_);
+        ddict_ = ZSTD_createDDict(dict.data(), dict.size());
+    }
+}
+
+ZstdCompressor::~ZstdCompressor()
+{
+    ZSTD_freeCDict(static_cast<ZSTD_CDict *>(cdict_));
+    ZSTD_freeDDict(static_cast<ZSTD_DDict *>(ddict_));
+}
+
+bool ZstdCompressor::compress(const char *data, size_t len, std::string &out)
+{
+    if (!tZstdContexts.cctx) {
+        tZstdContexts.cctx = ZSTD_createCCtx();
+    }
+    size_t start = out.size();
+    out.resize(start + ZSTD_compressBound(len));
+    size_t ret = 0;
+    if (cdict_) {
+        ret = ZSTD_compress_usingCDict(tZstdContexts.cctx, &out[start], out.size() - start, data, len, static_cast<ZSTD_CDict *>(cdict_));
+    }
+    else {
+        ret = ZSTD_compressCCtx(tZstdContexts.cctx, &out[start], out.size() - start, data, len, level_);
+    }
+    if (ZSTD_isError(ret)) {
+        LOG_ERROR << "zstd compress error, " << ZSTD_getErrorName(ret);
+        out.resize(start);
+        return false;
+    }
+    out.resize(start + ret);
+    return true;
+}
+
+bool ZstdCompressor::decompress(const char *data, size_t len, std::string &out, size_t maxLen)
+{
+    // 压缩时总会写入原始长度
+    unsigned long long size = ZSTD_getFrameContentSize(data, len);
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > maxLen) {
+        LOG_ERROR << "zstd decompress error, invalid content size";
+        return false;
+    }
+    if (!tZstdContexts.dctx) {
+        tZstdContexts.dctx = ZSTD_createDCtx();
+    }
+    size_t start = out.size();
+    out.resize(start + size);
+    size_t ret = 0;
+    if (ddict_) {
+        ret = ZSTD_decompress_usingDDict(tZstdContexts.dctx, &out[start], size, data, len, static_cast<ZSTD_DDict *>(ddict_));
+    }
+    else {
+        ret = ZSTD_decompressDCtx(tZstdContexts.dctx, &out[start], size, data, len);
+    }
+    if (ZSTD_isError(ret) || ret != size) {
+        LOG_ERROR << "zstd decompress error";
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#ifdef CORPC_HAVE_LZ4
+Lz4Compressor::Lz4Compressor() : Compressor(COMPRESS_LZ4, "lz4")
+{
+}
+
+bool Lz4Compressor::compress(const char *data, size_t len, std::string &out)
+{
+    if (len > LZ4_MAX_INPUT_SIZE) {
+        return false;
+    }
+    size_t origin = out.size();
+    putVarint64(out, len);
+    size_t start = out.size();
+    out.resize(start + LZ4_compressBound(len));
+    int ret = LZ4_compress_default(data, &out[start], len, out.size() - start);
+    if (ret <= 0) {
+        LOG_ERROR << "lz4 compress error";
+        out.resize(origin);
+        return false;
+    }
+    out.resize(start + ret);
+    return true;
+}
+
+bool Lz4Compressor::decompress(const char *data, size_t len, std::string &out, size_t maxLen)
+{
+    uint64_t size = 0;
+    int n = getVarint64(data, data + len, size);
+    if (n <= 0 || size > maxLen || size > LZ4_MAX_INPUT_SIZE) {
+        LOG_ERROR << "lz4 decompress error, invalid content size";
+        return false;
+    }
+    size_t start = out.size();
+    out.resize(start + size);
+    int ret = LZ4_decompress_safe(data + n, &out[start], len - n, size);
+    if (ret < 0 || (uint64_t)ret != size) {
+        LOG_ERROR << "lz4 decompress error";
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+#endif
+
+}
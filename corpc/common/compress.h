@@ -0,0 +1,99 @@
+#ifndef CORPC_COMMOM_COMPRESS_H
+#define CORPC_COMMOM_COMPRESS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace corpc {
+
+// 压缩算法的id，写在pb包头中，两端同一个算法必须使用相同的id
+enum CompressType {
+    COMPRESS_NONE = 0,
+    COMPRESS_ZLIB = 1,
+    COMPRESS_GZIP = 2,
+    COMPRESS_ZSTD = 3,          // 编译时找到libzstd才支持
+    COMPRESS_LZ4 = 4,           // 编译时找到liblz4才支持
+    COMPRESS_CUSTOM_BEGIN = 32, // 自定义算法（比如带训练字典的zstd）从这里开始
+    COMPRESS_MAX = 63,
+};
+
+// 压缩算法，实现需要线程安全，压缩上下文可以按线程缓存复用
+class Compressor {
+public:
+    typedef std::shared_ptr<Compressor> ptr;
+
+    Compressor(int type, const std::string &name) : type_(type), name_(name) {}
+    virtual ~Compressor() = default;
+
+    int type() const { return type_; }
+    const std::string &name() const { return name_; }
+
+    // 压缩后追加到out，失败时返回false
+    virtual bool compress(const char *data, size_t len, std::string &out) = 0;
+    // 解压后追加到out，解压后的数据超过maxLen或者数据损坏时返回false
+    virtual bool decompress(const char *data, size_t len, std::string &out, size_t maxLen) = 0;
+
+public:
+    // 注册压缩算法，相同id的算法会被替换，需要在启动服务和发起调用之前注册
+    static bool registerCompressor(Compressor::ptr compressor);
+    // 找不到时返回nullptr
+    static Compressor *get(int type);
+    static Compressor *get(const std::string &name);
+    // http的Content-Encoding对应的算法，deflate对应zlib格式
+    static Compressor *getByContentEncoding(const std::string &encoding);
+    // 已注册的算法名，逗号分隔，用于和对端协商
+    static std::string getNames();
+    // 逗号分隔的算法名中本端也支持的算法，按id组成掩码
+    static uint64_t parseNames(const std::string &names);
+
+private:
+    int type_{COMPRESS_NONE};
+    std::string name_;
+};
+
+// zlib和gzip格式的deflate压缩，http的deflate和gzip编码也使用它
+class ZlibCompressor : public Compressor {
+public:
+    ZlibCompressor(bool gzip, int level = -1);
+
+    bool compress(const char *data, size_t len, std::string &out) override;
+    bool decompress(const char *data, size_t len, std::string &out, size_t maxLen) override;
+
+private:
+    bool gzip_{false};
+    int level_{-1};
+};
+
+#ifdef CORPC_HAVE_ZSTD
+// zstd压缩，带上训练好的字典时用自定义的id注册，两端使用相同的字典
+class ZstdCompressor : public Compressor {
+public:
+    ZstdCompressor(int level = 1, const std::string &dict = "", int type = COMPRESS_ZSTD, const std::string &name = "zstd");
+    ~ZstdCompressor();
+
+    bool compress(const char *data, size_t len, std::string &out) override;
+    bool decompress(const char *data, size_t len, std::string &out, size_t maxLen) override;
+
+private:
+    int level_{1};
+    void *cdict_{nullptr};
+    void *ddict_{nullptr};
+};
+#endif
+
+#ifdef CORPC_HAVE_LZ4
+// lz4块压缩，压缩延迟最低，数据前面带上varint编码的原始长度
+class Lz4Compressor : public Compressor {
+public:
+    Lz4Compressor();
+
+    bool compress(const char *data, size_t len, std::string &out) override;
+    bool decompress(const char *data, size_t len, std::string &out, size_t maxLen) override;
+};
+#endif
+
+}
+
+#endif
@@ -1,10 +1,14 @@
+#include <sched.h>
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <memory>
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include "corpc/common/config.h"
 #include "corpc/common/log.h"
+#include "corpc/common/string_util.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/tcp/tcp_server.h"
 #include "corpc/net/service_register.h"
@@ -14,6 +18,19 @@ namespace corpc {
 extern corpc::Logger::ptr gLogger;
 extern corpc::TcpServer::ptr gTcpServer;
 
+// 解析cpu编号，不是整数或者不在[minCpu, CPU_SETSIZE)范围内时返回false
+static bool parseCpu(const std::string &str, int minCpu, int &cpu)
+{
+    char *end = nullptr;
+    errno = 0;
+    long value = strtol(str.c_str(), &end, 10);
+    if (end == str.c_str() || *end != '\0' || errno != 0 || value < minCpu || value >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu = (int)value;
+    return true;
+}
+
 Config::Config(const std::string &filePath) : filePath_(filePath)
 {
     try {
@@ -138,6 +155,175 @@ void Config::readConf()
     }
     iothreadNum = std::stoi(yamlFile_["iothread_num"].as<std::string>());
 
+    // optional, default 1
+    if (yamlFile_["client_iothread_num"] && yamlFile_["client_iothread_num"].IsScalar()) {
+        clientIothreadNum = std::stoi(yamlFile_["client_iothread_num"].as<std::string>());
+        if (clientIothreadNum <= 0) {
+            clientIothreadNum = 1;
+        }
+    }
+
+    // optional, epoll or io_uring, default epoll
+    if (yamlFile_["reactor"] && yamlFile_["reactor"].IsScalar()) {
+        reactorType = yamlFile_["reactor"].as<std::string>();
+        if (reactorType != "epoll" && reactorType != "io_uring") {
+            printf("start corpc server error! read config file [%s] error, unknown reactor [%s]\n", filePath_.c_str(), reactorType.c_str());
+            exit(0);
+        }
+    }
+
+    // optional, migrate or affinity, default migrate
+    if (yamlFile_["schedule_mode"] && yamlFile_["schedule_mode"].IsScalar()) {
+        scheduleMode = yamlFile_["schedule_mode"].as<std::string>();
+        if (scheduleMode != "migrate" && scheduleMode != "affinity") {
+            printf("start corpc server error! read config file [%s] error, unknown schedule_mode [%s]\n", filePath_.c_str(), scheduleMode.c_str());
+            exit(0);
+        }
+    }
+
+    // optional, default false
+    if (yamlFile_["pb_arena"] && yamlFile_["pb_arena"].IsScalar()) {
+        pbArena = yamlFile_["pb_arena"].as<bool>();
+    }
+
+    // optional, default 2, v2 frames are used only after the peer agrees
+    if (yamlFile_["pb_protocol_version"] && yamlFile_["pb_protocol_version"].IsScalar()) {
+        pbProtocolVersion = std::stoi(yamlFile_["pb_protocol_version"].as<std::string>());
+        if (pbProtocolVersion != 1 && pbProtocolVersion != 2) {
+            printf("start corpc server error! read config file [%s] error, invalid [pb_protocol_version] = %d\n", filePath_.c_str(), pbProtocolVersion);
+            exit(0);
+        }
+    }
+
+    // optional, default false, only works with v2 frames
+    if (yamlFile_["pb_checksum"] && yamlFile_["pb_checksum"].IsScalar()) {
+        pbChecksum = yamlFile_["pb_checksum"].as<bool>();
+    }
+
+    // optional, default 4MB, larger frames are dropped, larger decompressed data fails with ERROR_FAILED_DECOMPRESS
+    if (yamlFile_["pb_max_message_size"] && yamlFile_["pb_max_message_size"].IsScalar()) {
+        pbMaxMessageSize = std::stoi(yamlFile_["pb_max_message_size"].as<std::string>());
+        if (pbMaxMessageSize <= 0) {
+            printf("start corpc server error! read config file [%s] error, invalid [pb_max_message_size] = %d\n", filePath_.c_str(), pbMaxMessageSize);
+            exit(0);
+        }
+    }
+
+    // optional, default 0, pb requests of one connection are processed one by one
+    if (yamlFile_["conn_concurrency"] && yamlFile_["conn_concurrency"].IsScalar()) {
+        connConcurrency = std::stoi(yamlFile_["conn_concurrency"].as<std::string>());
+        if (connConcurrency < 0) {
+            printf("start corpc server error! read config file [%s] error, invalid [conn_concurrency] = %d\n", filePath_.c_str(), connConcurrency);
+            exit(0);
+        }
+    }
+
+    // optional, limits of reply data pending in write buffer of a server connection
+    YAML::Node writeBufferNode = yamlFile_["write_buffer"];
+    if (writeBufferNode && writeBufferNode.IsMap()) {
+        if (writeBufferNode["high_watermark"] && writeBufferNode["high_watermark"].IsScalar()) {
+            writeHighWatermark = std::stoi(writeBufferNode["high_watermark"].as<std::string>());
+        }
+        if (writeBufferNode["low_watermark"] && writeBufferNode["low_watermark"].IsScalar()) {
+            writeLowWatermark = std::stoi(writeBufferNode["low_watermark"].as<std::string>());
+        }
+        if (writeBufferNode["slow_consumer_timeout"] && writeBufferNode["slow_consumer_timeout"].IsScalar()) {
+            slowConsumerTimeout = std::stoi(writeBufferNode["slow_consumer_timeout"].as<std::string>());
+        }
+        if (writeHighWatermark < 0 || writeLowWatermark < 0 || slowConsumerTimeout < 0 || (writeHighWatermark > 0 && writeLowWatermark > writeHighWatermark)) {
+            printf("start corpc server error! read config file [%s] error, invalid [write_buffer]\n", filePath_.c_str());
+            exit(0);
+        }
+    }
+
+    // optional, compression of pb data and http body, default not compress requests
+    YAML::Node compressNode = yamlFile_["compress"];
+    if (compressNode && compressNode.IsMap()) {
+        if (compressNode["type"] && compressNode["type"].IsScalar()) {
+            compressType = compressNode["type"].as<std::string>();
+            if (compressType == "none") {
+                compressType.clear();
+            }
+        }
+        if (compressNode["min_size"] && compressNode["min_size"].IsScalar()) {
+            compressMinSize = std::stoi(compressNode["min_size"].as<std::string>());
+        }
+        if (compressMinSize < 0) {
+            printf("start corpc server error! read config file [%s] error, invalid [compress.min_size] = %d\n", filePath_.c_str(), compressMinSize);
+            exit(0);
+        }
+        YAML::Node methodNode = compressNode["methods"];
+        if (methodNode && methodNode.IsMap()) {
+            for (auto it = methodNode.begin(); it != methodNode.end(); ++it) {
+                compressMethods[it->first.as<std::string>()] = it->second.as<std::string>();
+            }
+        }
+    }
+
+    // optional, admission control of server, default no limit
+    YAML::Node limiterNode = yamlFile_["limiter"];
+    if (limiterNode && limiterNode.IsMap()) {
+        if (limiterNode["adaptive"] && limiterNode["adaptive"].IsScalar()) {
+            limiterAdaptive = limiterNode["adaptive"].as<bool>();
+        }
+        if (limiterNode["max_concurrency"] && limiterNode["max_concurrency"].IsScalar()) {
+            maxConcurrency = std::stoi(limiterNode["max_concurrency"].as<std::string>());
+        }
+        if (limiterNode["ip_max_concurrency"] && limiterNode["ip_max_concurrency"].IsScalar()) {
+            ipMaxConcurrency = std::stoi(limiterNode["ip_max_concurrency"].as<std::string>());
+        }
+        if (maxConcurrency < 0 || ipMaxConcurrency < 0) {
+            printf("start corpc server error! read config file [%s] error, invalid [limiter.max_concurrency] or [limiter.ip_max_concurrency]\n", filePath_.c_str());
+            exit(0);
+        }
+        YAML::Node methodNode = limiterNode["method_max_concurrency"];
+        if (methodNode && methodNode.IsMap()) {
+            for (auto it = methodNode.begin(); it != methodNode.end(); ++it) {
+                methodMaxConcurrency[it->first.as<std::string>()] = std::stoi(it->second.as<std::string>());
+            }
+        }
+    }
+
+    // optional, worker pool for cpu heavy methods, default not create
+    YAML::Node workerNode = yamlFile_["worker_pool"];
+    if (workerNode && workerNode.IsMap()) {
+        if (workerNode["thread_num"] && workerNode["thread_num"].IsScalar()) {
+            workerThreadNum = std::stoi(workerNode["thread_num"].as<std::string>());
+        }
+        if (workerNode["queue_size"] && workerNode["queue_size"].IsScalar()) {
+            workerQueueSize = std::stoi(workerNode["queue_size"].as<std::string>());
+        }
+        if (workerThreadNum < 0 || workerQueueSize <= 0) {
+            printf("start corpc server error! read config file [%s] error, invalid [worker_pool.thread_num] or [worker_pool.queue_size]\n", filePath_.c_str());
+            exit(0);
+        }
+    }
+
+    // optional, cpu of main accept loop, default not bind
+    if (yamlFile_["main_cpu"] && yamlFile_["main_cpu"].IsScalar()) {
+        std::string mainCpuStr = yamlFile_["main_cpu"].as<std::string>();
+        if (!parseCpu(mainCpuStr, -1, mainCpu)) {
+            printf("start corpc server error! read config file [%s] error, invalid [main_cpu] [%s]\n", filePath_.c_str(), mainCpuStr.c_str());
+            exit(0);
+        }
+    }
+
+    // optional, cpus of io threads separated by ',', such as "0,1,2,3", default not bind
+    std::string iothreadCpusStr;
+    if (yamlFile_["iothread_cpus"] && yamlFile_["iothread_cpus"].IsScalar()) {
+        iothreadCpusStr = yamlFile_["iothread_cpus"].as<std::string>();
+        std::vector<std::string> cpus;
+        StringUtil::splitStrToVector(iothreadCpusStr, ",", cpus);
+        for (auto &i : cpus) {
+            int cpu = -1;
+            if (!parseCpu(i, 0, cpu)) {
+                printf("start corpc server error! read config file [%s] error, invalid cpu [%s] in [iothread_cpus]\n", filePath_.c_str(), i.c_str());
+                exit(0);
+            }
+            iothreadCpus.push_back(cpu);
+        }
+    }
+
     YAML::Node serviceRegisterNode = yamlFile_["service_register"];
     if (!serviceRegisterNode || !serviceRegisterNode.IsScalar()) {
         printf("start corpc server error! read config file [%s] error, cannot read [service_register] yaml node\n", filePath_.c_str());
@@ -199,15 +385,15 @@ void Config::readConf()
         gTcpServer = std::make_shared<TcpServer>(addr, Custom_Protocol);
     }
 
-    char buff[1024] = {0};
-    sprintf(buff, "read config from file [%s]: [log_path: %s], [log_prefix: %s], [log_max_size: %d MB], [log_level: %s], [user_log_level: %s], "
+    char buff[2048] = {0};
+    snprintf(buff, sizeof(buff), "read config from file [%s]: [log_path: %s], [log_prefix: %s], [log_max_size: %d MB], [log_level: %s], [user_log_level: %s], "
                     "[coroutine_stack_size: %d KB], [coroutine_pool_size: %d], "
                     "[msg_seq_len: %d], [max_connect_timeout: %d s], "
-                    "[iothread_num: %d], [timewheel_bucket_num: %d], [timewheel_interval: %d s], [server_ip: %s], [server_port: %d], [server_protocol: %s], "
+                    "[iothread_num: %d], [client_iothread_num: %d], [reactor: %s], [schedule_mode: %s], [pb_arena: %d], [pb_protocol_version: %d], [pb_checksum: %d], [pb_max_message_size: %d], [compress_type: %s], [compress_min_size: %d], [compress_method_count: %d], [conn_concurrency: %d], [write_high_watermark: %d], [write_low_watermark: %d], [slow_consumer_timeout: %d ms], [limiter_adaptive: %d], [max_concurrency: %d], [ip_max_concurrency: %d], [method_quota_count: %d], [worker_thread_num: %d], [worker_queue_size: %d], [main_cpu: %d], [iothread_cpus: %s], [timewheel_bucket_num: %d], [timewheel_interval: %d s], [server_ip: %s], [server_port: %d], [server_protocol: %s], "
                     "[service_register: %s], [zk_ip: %s], [zk_port: %d], [zk_timeout: %d]",
             filePath_.c_str(), logPath.c_str(), logPrefix.c_str(), logMaxSize / 1024 / 1024,
             levelToString(logLevel).c_str(), levelToString(userLogLevel).c_str(), corStackSize / 1024, corPoolSize, msgSeqLen,
-            maxConnectTimeout / 1000, iothreadNum, timewheelBucketNum, timewheelInterval, ip.c_str(), port, protocol.c_str(),
+            maxConnectTimeout / 1000, iothreadNum, clientIothreadNum, reactorType.c_str(), scheduleMode.c_str(), pbArena, pbProtocolVersion, pbChecksum, pbMaxMessageSize, compressType.c_str(), compressMinSize, (int)compressMethods.size(), connConcurrency, writeHighWatermark, writeLowWatermark, slowConsumerTimeout, limiterAdaptive, maxConcurrency, ipMaxConcurrency, (int)methodMaxConcurrency.size(), workerThreadNum, workerQueueSize, mainCpu, iothreadCpusStr.c_str(), timewheelBucketNum, timewheelInterval, ip.c_str(), port, protocol.c_str(),
             serviceRegisterStr.c_str(), zkIp.c_str(), zkPort, zkTimeout);
 
     std::string s(buff);
@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
 #include "corpc/common/const.h"
 #include "corpc/net/load_balance.h"
 
@@ -41,6 +42,28 @@ public:
 
     int maxConnectTimeout{0}; // ms
     int iothreadNum{0};
+    int clientIothreadNum{1}; // io threads shared by all client channels
+    std::string reactorType{"epoll"}; // epoll or io_uring
+    std::string scheduleMode{"migrate"}; // migrate or affinity
+    bool pbArena{false};                 // allocate request and response of pb rpc on a per-call arena
+    int pbProtocolVersion{2};            // highest pb frame version to negotiate, 1 disables the compact v2 frame
+    bool pbChecksum{false};              // ask servers to protect v2 frames with crc32c
+    int pbMaxMessageSize{4 * 1024 * 1024}; // max length of a pb frame and of its decompressed pb data
+    std::string compressType;            // algorithm to compress pb requests as a client, empty means not compress
+    int compressMinSize{1024};           // only compress pb data or http body not smaller than it
+    std::map<std::string, std::string> compressMethods; // algorithm of service.method or http path, none means not compress
+    int workerThreadNum{0};              // threads of worker pool, 0 means no worker pool
+    int workerQueueSize{1000};           // max pending tasks of worker pool
+    int connConcurrency{0};              // max concurrent pb requests of one server connection, 0 means one by one
+    int writeHighWatermark{8 * 1024 * 1024}; // stop reading requests of a connection when pending reply bytes exceed it, 0 means no limit
+    int writeLowWatermark{2 * 1024 * 1024};  // resume reading when pending reply bytes drop below it
+    int slowConsumerTimeout{0};          // ms, close connection when peer doesn't read replies for so long, 0 means never
+    bool limiterAdaptive{false};         // adjust maxConcurrency by measured latency, maxConcurrency is the upper bound
+    int maxConcurrency{0};               // max in-flight requests of server, 0 means no limit
+    int ipMaxConcurrency{0};             // max in-flight requests from one client ip, 0 means no limit
+    std::map<std::string, int> methodMaxConcurrency; // max in-flight requests of service.method or http path
+    int mainCpu{-1};                  // cpu of main accept loop, -1 means not bind
+    std::vector<int> iothreadCpus;    // io thread i binds to iothreadCpus[i % size], empty means not bind
 
     int timewheelBucketNum{0};
     int timewheelInterval{0};
@@ -23,7 +23,13 @@ enum class LoadBalanceCategory {
     // 轮询算法
     Round,
     // 一致性哈希
-    ConsistentHash
+    ConsistentHash,
+    // 最少未完成请求
+    LeastOutstanding,
+    // 两次随机选择 + ewma耗时
+    P2C,
+    // 平滑加权轮询
+    WeightedRound
 };
 
 enum class ServiceRegisterCategory {
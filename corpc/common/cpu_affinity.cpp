@@ -0,0 +1,139 @@
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include "corpc/common/cpu_affinity.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+static thread_local int tNumaNode = -1;
+static thread_local int tBindCpu = -1;
+
+// nodemask最多支持64个numa节点
+static const int MAX_NUMA_NODE = 64;
+
+// 第一次绑核之前的cpu集合，取消绑定时恢复成这个集合
+static const cpu_set_t &getProcessCpuSet()
+{
+    static cpu_set_t cpuSet = []() {
+        cpu_set_t s;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(s), &s) != 0) {
+            CPU_ZERO(&s);
+            for (int i = 0; i < CPU_SETSIZE; ++i) {
+                CPU_SET(i, &s);
+            }
+        }
+        return s;
+    }();
+    return cpuSet;
+}
+
+// node < 0 时恢复默认的内存策略
+static void setMemPolicy(int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODE) {
+        syscall(__NR_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+        return;
+    }
+    unsigned long nodeMask = 1UL << node;
+    if (syscall(__NR_set_mempolicy, MPOL_PREFERRED, &nodeMask, MAX_NUMA_NODE + 1) != 0) {
+        // 没有开启numa的内核不支持，不影响绑核
+        LOG_WARN << "set_mempolicy to numa node[" << node << "] error, sys error=" << strerror(errno);
+    }
+}
+
+bool CpuAffinity::bindCurrentThread(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        LOG_ERROR << "bind thread error, invalid cpu[" << cpu << "]";
+        return false;
+    }
+    getProcessCpuSet();
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0) {
+        LOG_ERROR << "bind thread to cpu[" << cpu << "] error, sys error=" << strerror(ret);
+        return false;
+    }
+
+    int node = getNumaNode(cpu);
+    setMemPolicy(node);
+    tNumaNode = node;
+    tBindCpu = cpu;
+    LOG_INFO << "bind thread to cpu[" << cpu << "], numa node[" << node << "]";
+    return true;
+}
+
+int CpuAffinity::getNumaNode(int cpu)
+{
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        return -1;
+    }
+    int node = -1;
+    dirent *entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        // 目录下有一个指向所在节点的链接node<N>
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+int CpuAffinity::getCurrentNumaNode()
+{
+    return tNumaNode;
+}
+
+bool CpuAffinity::bindMemory(void *addr, size_t len, int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODE) {
+        return false;
+    }
+    unsigned long nodeMask = 1UL << node;
+    if (syscall(__NR_mbind, addr, len, MPOL_PREFERRED, &nodeMask, MAX_NUMA_NODE + 1, 0) != 0) {
+        LOG_WARN << "mbind memory to numa node[" << node << "] error, sys error=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+CpuAffinity::ScopedUnbind::ScopedUnbind() : cpu_(tBindCpu)
+{
+    if (cpu_ < 0) {
+        return;
+    }
+    const cpu_set_t &cpuSet = getProcessCpuSet();
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0) {
+        LOG_WARN << "unbind thread from cpu[" << cpu_ << "] error, sys error=" << strerror(ret);
+    }
+    setMemPolicy(-1);
+}
+
+CpuAffinity::ScopedUnbind::~ScopedUnbind()
+{
+    if (cpu_ < 0) {
+        return;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu_, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    setMemPolicy(tNumaNode);
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef CORPC_COMMOM_CPU_AFFINITY_H
+#define CORPC_COMMOM_CPU_AFFINITY_H
+
+#include <cstddef>
+
+namespace corpc {
+
+// 线程绑核和numa节点相关的工具，不依赖libnuma，numa节点从sysfs读取，内存策略直接使用系统调用
+class CpuAffinity {
+public:
+    // 把当前线程绑定到cpu上，成功后当前线程之后分配的内存优先从cpu所在的numa节点分配
+    static bool bindCurrentThread(int cpu);
+
+    // cpu所在的numa节点，未知时返回-1
+    static int getNumaNode(int cpu);
+
+    // 当前线程绑定的numa节点，未绑核或者未知时返回-1
+    static int getCurrentNumaNode();
+
+    // [addr, addr + len)的页面在第一次访问时优先从node分配，addr需要按页对齐
+    static bool bindMemory(void *addr, size_t len, int node);
+
+    // 新线程会继承创建线程的绑核和内存策略，绑核的线程创建辅助线程（客户端io线程、zookeeper线程等）时，
+    // 在作用域内临时恢复成进程原来的cpu集合和默认的内存策略，离开作用域时重新绑定
+    class ScopedUnbind {
+    public:
+        ScopedUnbind();
+        ~ScopedUnbind();
+
+    private:
+        int cpu_{-1};
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include <cstring>
+#include "corpc/common/crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CORPC_CRC32C_X86 1
+#endif
+
+namespace corpc {
+
+static const uint32_t CRC32C_POLY = 0x82F63B78; // 反转后的Castagnoli多项式
+
+// slicing-by-8的查找表，table[k][i]为字节i后面跟k个0字节的crc
+struct Crc32cTable {
+    uint32_t table[8][256];
+
+    Crc32cTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+static uint32_t crc32cTable(const uint8_t *p, size_t len, uint32_t crc)
+{
+    static const Crc32cTable t;
+    while (len >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        // 按小端处理
+        lo ^= crc;
+        crc = t.table[7][lo & 0xff] ^ t.table[6][(lo >> 8) & 0xff] ^ t.table[5][(lo >> 16) & 0xff] ^ t.table[4][lo >> 24]
+            ^ t.table[3][hi & 0xff] ^ t.table[2][(hi >> 8) & 0xff] ^ t.table[1][(hi >> 16) & 0xff] ^ t.table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t.table[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CORPC_CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHw(const uint8_t *p, size_t len, uint32_t crc)
+{
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+static bool hasSse42()
+{
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+uint32_t crc32c(const void *data, size_t len, uint32_t crc/* = 0*/)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    crc = ~crc;
+#ifdef CORPC_CRC32C_X86
+    if (hasSse42()) {
+        return ~crc32cHw(p, len, crc);
+    }
+#endif
+    return ~crc32cTable(p, len, crc);
+}
+
+}
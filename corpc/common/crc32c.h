@@ -0,0 +1,15 @@
+#ifndef CORPC_COMMOM_CRC32C_H
+#define CORPC_COMMOM_CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace corpc {
+
+// CRC32C(Castagnoli)校验，cpu支持SSE4.2时使用crc32指令，否则查表计算
+// crc为之前数据的校验值，可以分段计算
+uint32_t crc32c(const void *data, size_t len, uint32_t crc = 0);
+
+}
+
+#endif
@@ -26,6 +26,11 @@ const int ERROR_METHOD_NOT_FOUND = SYS_ERROR_PREFIX(0009); // not found method
 const int ERROR_PARSE_SERVICE_FULL_NAME = SYS_ERROR_PREFIX(0010);     // not found service name
 const int ERROR_NOT_SET_ASYNC_PRE_CALL = SYS_ERROR_PREFIX(0011); // you didn't set some nessary param before call async rpc
 const int ERROR_CONNECT_SYS_ERR = SYS_ERROR_PREFIX(0012);        // connect sys error
+const int ERROR_RPC_DEADLINE_EXCEEDED = SYS_ERROR_PREFIX(0013);  // client's deadline exceeded before server call method
+const int ERROR_WORKER_QUEUE_FULL = SYS_ERROR_PREFIX(0014);      // queue of server's worker pool is full
+const int ERROR_SERVER_OVERLOADED = SYS_ERROR_PREFIX(0015);      // server rejects request because of concurrency limit
+const int ERROR_CHECKSUM_MISMATCH = SYS_ERROR_PREFIX(0016);      // crc32c of package mismatch, package is corrupted
+const int ERROR_FAILED_DECOMPRESS = SYS_ERROR_PREFIX(0017);      // failed to decompress pb data
 
 }
 
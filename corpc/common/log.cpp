@@ -172,12 +172,12 @@ std::stringstream &LogEvent::getStringStream()
 
     RunTime *runtime = getCurrentRunTime();
     if (runtime) {
-        std::string msgNo = runtime->msgNo_;
+        const std::string &msgNo = runtime->msgNo_;
         if (!msgNo.empty()) {
             ss_ << "[" << msgNo << "] ";
         }
 
-        std::string interfaceName = runtime->interfaceName_;
+        const std::string &interfaceName = runtime->interfaceName_;
         if (!interfaceName.empty()) {
             ss_ << "[" << interfaceName << "] ";
         }
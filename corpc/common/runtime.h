@@ -2,16 +2,52 @@
 #define CORPC_COMMOM_RUNTIME_H
 
 #include <string>
+#include <cstdint>
+#include <memory>
+#include <atomic>
 
 namespace corpc {
 
+// 请求上下文，协程通过引用计数共享，派生的子协程和异步调用直接引用父协程的上下文，不会拷贝
 class RunTime {
 public:
+    typedef std::shared_ptr<RunTime> ptr;
+
     std::string msgNo_;
     std::string interfaceName_;
+    int64_t deadline_{0}; // 当前处理的请求的截止时间（ms），发起下游调用时不会超过它，0表示没有限制
+
+    // 协程局部变量的最大个数，槽位随上下文一起分配，不会扩容，其他线程的读不需要加锁
+    static const size_t MAX_SLOTS = 32;
+
+    // 分配一个协程局部变量的下标，进程内唯一，超过MAX_SLOTS之后分配的下标不能使用
+    static size_t allocSlot()
+    {
+        static std::atomic<size_t> slotCount{0};
+        return slotCount++;
+    }
+
+    void *getSlot(size_t index) const
+    {
+        return index < MAX_SLOTS ? std::atomic_load(&slots_[index]).get() : nullptr;
+    }
+
+    // 下标超出范围时返回false
+    bool setSlot(size_t index, std::shared_ptr<void> value)
+    {
+        if (index >= MAX_SLOTS) {
+            return false;
+        }
+        std::atomic_store(&slots_[index], value);
+        return true;
+    }
+
+private:
+    // 派生的子协程和异步调用可能在其他线程中同时读写，按槽位原子地读写
+    std::shared_ptr<void> slots_[MAX_SLOTS];
 };
 
 }
 
 
-#endif
\ No newline at end of file
+#endif
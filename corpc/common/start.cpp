@@ -50,4 +50,13 @@ void addTimerEvent(TimerEvent::ptr event)
 {
 }
 
+void offload(std::function<void()> cb)
+{
+    WorkerPool::ptr workerPool = gTcpServer->getWorkerPool();
+    if (workerPool && workerPool->run(cb)) {
+        return;
+    }
+    gTcpServer->getIOThreadPool()->offload(cb);
+}
+
 }
\ No newline at end of file
@@ -33,6 +33,9 @@ TcpServer::ptr getServer();
 int getIOThreadPoolSize();
 Config::ptr getConfig();
 void addTimerEvent(TimerEvent::ptr event);
+// 在服务端的工作线程池中执行cb，当前协程挂起直到执行完
+// 没有配置工作线程池（worker_thread_num为0）或者队列已满时，在其他io线程上执行，见IOThreadPool::offload
+void offload(std::function<void()> cb);
 
 }
 
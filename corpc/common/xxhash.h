@@ -0,0 +1,19 @@
+#ifndef CORPC_COMMOM_XXHASH_H
+#define CORPC_COMMOM_XXHASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace corpc {
+
+// XXH64算法实现，非加密哈希，用于负载均衡、方法id等对速度敏感的场景
+uint64_t xxHash64(const void *data, size_t len, uint64_t seed = 0);
+
+inline uint64_t xxHash64(const std::string &str, uint64_t seed = 0) {
+    return xxHash64(str.data(), str.size(), seed);
+}
+
+}
+
+#endif
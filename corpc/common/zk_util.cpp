@@ -1,6 +1,7 @@
 #include "corpc/common/zk_util.h"
 #include "corpc/common/config.h"
 #include "corpc/common/log.h"
+#include "corpc/common/cpu_affinity.h"
 
 namespace corpc {
 
@@ -20,6 +21,14 @@ void ZkClient::globalWatcher(zhandle_t *zh, int type, int state, const char *pat
             LOG_ERROR << "Trying to reconnect zk......";
             ZkClient *cli = (ZkClient*)zoo_get_context(zh);
             cli->start();
+            // 旧会话上的watcher都失效了，缓存的子节点也可能已经过期，清空之后由重连通知重新拉取并设置watcher
+            {
+                std::lock_guard<std::mutex> lock(cli->childrenMutex_);
+                cli->childrenNodesMap_.clear();
+            }
+            if (cli->reconnectListener_) {
+                cli->reconnectListener_();
+            }
         }
     }
 }
@@ -43,17 +52,18 @@ void ZkClient::start()
     网络I/O线程  pthread_create  poll
     watcher回调线程 pthread_create 给客户端通知
     */
+    // 连接成功的通知可能在zookeeper_init返回之前就到达，信号量和context要先准备好
+    sem_init(&sem_, 0, 0);
+    // zookeeper的两个线程不继承当前线程的绑核
+    CpuAffinity::ScopedUnbind unbind;
     // 这是异步的连接
-    zhandle_ = zookeeper_init(connstr_.c_str(), globalWatcher, timeout_, nullptr, nullptr, 0);
+    zhandle_ = zookeeper_init(connstr_.c_str(), globalWatcher, timeout_, nullptr, this, 0);
     // 返回表示句柄创建成功，不代表连接成功了
     if (nullptr == zhandle_) {
         LOG_ERROR << "zookeeper_init error!";
         Exit(0);
     }
 
-    sem_init(&sem_, 0, 0);
-    zoo_set_context(zhandle_, this);
-
     sem_wait(&sem_); // 等待连接
     LOG_INFO << "zookeeper_init success!";
 }
@@ -126,10 +136,14 @@ std::string ZkClient::getData(const char *path)
 // 获取路径对应的子节点
 std::vector<std::string> ZkClient::getChildrenNodes(const std::string &path)
 {
-    auto it = childrenNodesMap_.find(path);
-    if (childrenNodesMap_.find(path) != childrenNodesMap_.end())
-        return it->second;
+    {
+        std::lock_guard<std::mutex> lock(childrenMutex_);
+        auto it = childrenNodesMap_.find(path);
+        if (it != childrenNodesMap_.end())
+            return it->second;
+    }
     std::vector<std::string> result = getChildren(path.c_str());
+    std::lock_guard<std::mutex> lock(childrenMutex_);
     childrenNodesMap_[path] = result;
     return result;
 }
@@ -160,7 +174,13 @@ void ZkClient::serviceWatcher(zhandle_t *zh, int type, int state, const char *pa
     if (type == ZOO_CHILD_EVENT) {
         // zk设置监听watcher只能是一次性的，每次触发后需要重复设置
         std::vector<std::string> result = instance->getChildren(path);
-        instance->childrenNodesMap_[path] = result;
+        {
+            std::lock_guard<std::mutex> lock(instance->childrenMutex_);
+            instance->childrenNodesMap_[path] = result;
+        }
+        if (instance->childrenListener_) {
+            instance->childrenListener_(path, result);
+        }
     }
 }
 
@@ -173,6 +193,7 @@ void ZkClient::closeLog()
 // 心跳机制
 void ZkClient::sendHeartBeat()
 {
+    CpuAffinity::ScopedUnbind unbind;
     std::thread t([&]() {
         while (true) {
             int time = zoo_recv_timeout(zhandle_) * 1.0 / 3; // 默认timeout 30000
@@ -8,12 +8,19 @@
 #include <vector>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <functional>
 
 namespace corpc {
 
 // 封装的zookeeper客户端类
 class ZkClient {
 public:
+    // 子节点变化时的通知，参数为父节点路径和最新的子节点列表，在zk的watcher线程中调用
+    typedef std::function<void(const std::string &path, const std::vector<std::string> &children)> ChildrenListener;
+    // 会话过期重连成功后的通知，此时之前设置的watcher都已经丢失，在zk的watcher线程中调用
+    typedef std::function<void()> ReconnectListener;
+
     ZkClient();
     ZkClient(const std::string &ip, int port, int timeout);
     ~ZkClient();
@@ -44,6 +51,12 @@ public:
 
     // 心跳机制
     void sendHeartBeat();
+
+    // 设置子节点变化的通知
+    void setChildrenListener(ChildrenListener listener) { childrenListener_ = listener; }
+
+    // 设置会话重建的通知，一般用来重新拉取子节点并重新设置watcher
+    void setReconnectListener(ReconnectListener listener) { reconnectListener_ = listener; }
 private:
     // zk的客户端句柄
     zhandle_t *zhandle_;
@@ -56,6 +69,11 @@ private:
 
     // 缓存路径对应的子节点，这样就不用总是遍历文件系统了
     std::unordered_map<std::string, std::vector<std::string>> childrenNodesMap_;
+    // watcher线程和调用线程都会访问childrenNodesMap_
+    std::mutex childrenMutex_;
+
+    ChildrenListener childrenListener_;
+    ReconnectListener reconnectListener_;
 
     // 根据参数指定的znode节点路径，获取znode节点的子节点
     std::vector<std::string> getChildren(const char *path);
@@ -33,6 +33,14 @@ void setCurrentRunTime(RunTime* v)
     tCurrRuntime = v;
 }
 
+RunTime::ptr getCurrentRunTimePtr()
+{
+    if (tCurrCoroutine == nullptr) {
+        return nullptr;
+    }
+    return tCurrCoroutine->getRunTimePtr();
+}
+
 void CoFunction(Coroutine *co)
 {
     if (co != nullptr) {
@@ -96,6 +104,7 @@ bool Coroutine::setCallBack(std::function<void()> cb)
     }
 
     callback_ = cb;
+    runtime_.reset(); // 协程被复用时不能带上之前的请求信息
 
     char *top = stackSp_ + stackSize_;
 
@@ -118,6 +127,20 @@ Coroutine::~Coroutine()
     coroutineCount--;
 }
 
+void Coroutine::setRunTime(RunTime::ptr runtime)
+{
+    runtime_ = runtime;
+    if (this == tCurrCoroutine) {
+        tCurrRuntime = runtime_.get();
+    }
+}
+
+RunTime* Coroutine::resetRunTime()
+{
+    setRunTime(std::make_shared<RunTime>());
+    return runtime_.get();
+}
+
 Coroutine *Coroutine::getCurrentCoroutine()
 {
     if (tCurrCoroutine == nullptr) {
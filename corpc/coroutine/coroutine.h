@@ -12,6 +12,24 @@ namespace corpc {
 int getCoroutineIndex();
 RunTime* getCurrentRunTime();
 void setCurrentRunTime(RunTime *v);
+// 当前协程的上下文，用于在派生的协程中共享
+RunTime::ptr getCurrentRunTimePtr();
+
+class Coroutine;
+class Timer;
+class CoroutinePool;
+
+// 协程定时器节点，嵌入在协程和超时作用域（CoTimeout）中，由io线程的Timer按到期时间组织成堆
+// 加入定时器时不需要分配内存
+struct CoTimerNode {
+    int64_t arriveTime_{0};
+    Coroutine *cor_{nullptr};               // 到期时唤醒的协程
+    void (*onTimeout_)(void *arg){nullptr}; // 到期时在唤醒协程之前执行
+    void *arg_{nullptr};
+    Timer *timer_{nullptr};                 // 所在的定时器，不在定时器中时为nullptr
+    size_t heapIndex_{0};
+    bool isFired_{false};
+};
 
 class Coroutine {
 public:
@@ -31,10 +49,21 @@ public:
     bool getIsInCoFunc() const { return isInCofunc_; }
     void setIndex(int index) { index_ = index; }
     int getIndex() { return index_; }
+    void setPool(CoroutinePool *pool) { pool_ = pool; }
+    // 分配该协程的协程池，不是从协程池中分配时返回nullptr
+    CoroutinePool *getPool() const { return pool_; }
     char *getStackPtr() { return stackSp_; }
     int getStackSize() { return stackSize_; }
     void setCanResume(bool v) { canResume_ = v; }
-    RunTime* getRunTime() { return &runtime_; }
+    // 没有请求上下文时返回nullptr
+    RunTime* getRunTime() { return runtime_.get(); }
+    RunTime::ptr getRunTimePtr() const { return runtime_; }
+    // 共享其他协程的上下文
+    void setRunTime(RunTime::ptr runtime);
+    // 开始处理新的请求时创建新的上下文，之前派生出去的协程仍然引用旧的上下文
+    RunTime* resetRunTime();
+    // 协程自己的定时器节点，用于sleepMs
+    CoTimerNode *getTimerNode() { return &timerNode_; }
 
     static void yield();
     static void resume(Coroutine *cor);
@@ -48,11 +77,13 @@ private:
     int stackSize_{0};        // size of stack memory space
     char *stackSp_{nullptr};     // coroutine's stack memory space, you can malloc or mmap get some memory to init this value
     bool isInCofunc_{false}; // true when call CoFunction, false when CoFunction finished
-    RunTime runtime_;
+    RunTime::ptr runtime_;
+    CoTimerNode timerNode_;
 
     bool canResume_{true};
 
     int index_{-1}; // index in coroutine pool
+    CoroutinePool *pool_{nullptr};
 
 public:
     std::function<void()> callback_;
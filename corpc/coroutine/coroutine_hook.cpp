@@ -2,14 +2,24 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/epoll.h>
 #include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <condition_variable>
 #include "corpc/coroutine/coroutine_hook.h"
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/net/channel.h"
 #include "corpc/net/event_loop.h"
 #include "corpc/net/timer.h"
+#include "corpc/net/coroutine_sync.h"
 #include "corpc/common/log.h"
 #include "corpc/common/config.h"
+#include "corpc/common/cpu_affinity.h"
 
 #define HOOK_SYS_FUNC(name) name##_fun_ptr_t g_sys_##name##_fun = (name##_fun_ptr_t)dlsym(RTLD_NEXT, #name);
 
@@ -18,6 +28,19 @@ HOOK_SYS_FUNC(read);
 HOOK_SYS_FUNC(write);
 HOOK_SYS_FUNC(connect);
 HOOK_SYS_FUNC(sleep);
+HOOK_SYS_FUNC(readv);
+HOOK_SYS_FUNC(writev);
+HOOK_SYS_FUNC(recv);
+HOOK_SYS_FUNC(send);
+HOOK_SYS_FUNC(recvfrom);
+HOOK_SYS_FUNC(sendto);
+HOOK_SYS_FUNC(recvmsg);
+HOOK_SYS_FUNC(sendmsg);
+HOOK_SYS_FUNC(poll);
+HOOK_SYS_FUNC(select);
+HOOK_SYS_FUNC(nanosleep);
+HOOK_SYS_FUNC(usleep);
+HOOK_SYS_FUNC(getaddrinfo);
 
 
 namespace corpc {
@@ -46,6 +69,55 @@ void toEpoll(corpc::Channel::ptr channel, int events)
     }
 }
 
+// 边缘触发模式的channel：确定已经读空/写满时不再发起必然返回EAGAIN的系统调用，直接等待
+// 等待之后只重试一次，被提前唤醒时和原来一样返回EAGAIN；len为0表示长度未知，只在EAGAIN时清除就绪标记
+// 等待期间fd被关闭（channel从事件循环中删除）时返回EBADF，fd可能已经被新的连接复用，不能再读写
+template <class IOFunc>
+static ssize_t edgeIO(corpc::Channel::ptr channel, corpc::IOEvent event, size_t len, IOFunc func)
+{
+    bool isWaited = false;
+    if (!channel->isEdgeReady(event)) {
+        isWaited = true;
+        if (!channel->waitEdgeEvent(event)) {
+            errno = EBADF;
+            return -1;
+        }
+    }
+    ssize_t n = func();
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !isWaited) {
+        if (!channel->waitEdgeEvent(event)) {
+            errno = EBADF;
+            return -1;
+        }
+        n = func();
+    }
+    // 读写的数据比请求的少，说明缓冲区已经读空/写满，之后的就绪事件会重新设置标记
+    if ((n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) || (n >= 0 && static_cast<size_t>(n) < len)) {
+        channel->clearEdgeReady(event);
+    }
+    return n;
+}
+
+// reactor支持直接提交io（io_uring）时由reactor完成这次io，不需要先注册事件、挂起、再重新发起系统调用
+// 不支持、fd不是socket（reactor会记住，之后不再提交）或者返回EAGAIN时返回false，由调用方等待就绪事件
+static bool submitToReactor(corpc::IoOp &op, ssize_t &ret)
+{
+    if (!corpc::EventLoop::getEventLoop()->getReactor()->submitIO(op)) {
+        return false;
+    }
+    if (op.res == -ENOTSOCK || op.res == -EAGAIN) {
+        return false;
+    }
+    if (op.res < 0) {
+        // 被提前唤醒时和等待就绪事件之后重试的结果一致
+        errno = op.res == -ECANCELED ? EAGAIN : -op.res;
+        ret = -1;
+        return true;
+    }
+    ret = op.res;
+    return true;
+}
+
 ssize_t read_hook(int fd, void *buf, size_t count)
 {
     LOG_DEBUG << "this is hook read";
@@ -63,6 +135,16 @@ ssize_t read_hook(int fd, void *buf, size_t count)
 
     channel->setNonBlock();
 
+    corpc::IoOp op(corpc::IoOp::Recv, fd, buf, count);
+    ssize_t ret = 0;
+    if (submitToReactor(op, ret)) {
+        return ret;
+    }
+
+    if (channel->isEdgeMode()) {
+        return edgeIO(channel, corpc::IOEvent::READ, count, [=]() { return g_sys_read_fun(fd, buf, count); });
+    }
+
     // must first register read event on epoll
     // because loop should always care read event when a connection sockfd was created
     // so if first call sys read, and read return success, this fucntion will not register read event and return
@@ -101,6 +183,14 @@ int accept_hook(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
 
     channel->setNonBlock();
 
+    corpc::IoOp op(corpc::IoOp::Accept, sockfd, nullptr, 0);
+    op.addr = addr;
+    op.addrlen = addrlen;
+    ssize_t ret = 0;
+    if (submitToReactor(op, ret)) {
+        return ret;
+    }
+
     int n = g_sys_accept_fun(sockfd, addr, addrlen);
     if (n > 0) {
         return n;
@@ -133,6 +223,16 @@ ssize_t write_hook(int fd, const void *buf, size_t count)
 
     channel->setNonBlock();
 
+    corpc::IoOp op(corpc::IoOp::Send, fd, const_cast<void*>(buf), count);
+    ssize_t ret = 0;
+    if (submitToReactor(op, ret)) {
+        return ret;
+    }
+
+    if (channel->isEdgeMode()) {
+        return edgeIO(channel, corpc::IOEvent::WRITE, count, [=]() { return g_sys_write_fun(fd, buf, count); });
+    }
+
     ssize_t n = g_sys_write_fun(fd, buf, count);
     if (n > 0) {
         return n;
@@ -163,7 +263,6 @@ int connect_hook(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
     if (channel->getEventLoop() == nullptr) {
         channel->setEventLoop(loop);
     }
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine();
 
     channel->setNonBlock();
     int n = g_sys_connect_fun(sockfd, addr, addrlen);
@@ -180,19 +279,8 @@ int connect_hook(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
 
     toEpoll(channel, corpc::IOEvent::WRITE);
 
-    bool isTimeout = false; // 是否超时
-
-    // 超时函数句柄
-    auto timeoutcb = [&isTimeout, curCor]() {
-        // 设置超时标志，然后唤醒协程
-        isTimeout = true;
-        corpc::Coroutine::resume(curCor);
-    };
-
-    corpc::TimerEvent::ptr event = std::make_shared<corpc::TimerEvent>(gConfig->maxConnectTimeout, false, timeoutcb);
-
-    corpc::Timer *timer = loop->getTimer();
-    timer->addTimerEvent(event);
+    // 超时后唤醒协程
+    corpc::CoTimeout timeout(gConfig->maxConnectTimeout);
 
     corpc::Coroutine::yield();
 
@@ -201,7 +289,8 @@ int connect_hook(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
     channel->clearCoroutine();
 
     // 定时器也需要删除
-    timer->delTimerEvent(event);
+    timeout.cancel();
+    bool isTimeout = timeout.isTimeout();
 
     n = g_sys_connect_fun(sockfd, addr, addrlen);
     if ((n < 0 && errno == EISCONN) || n == 0) {
@@ -225,28 +314,413 @@ unsigned int sleep_hook(unsigned int seconds)
         LOG_DEBUG << "hook disable, call sys sleep func";
         return g_sys_sleep_fun(seconds);
     }
+    corpc::sleepMs(1000 * (int64_t)seconds);
+    return 0;
+}
+
+int nanosleep_hook(const struct timespec *req, struct timespec *rem)
+{
+    if (corpc::Coroutine::isMainCoroutine()) {
+        return g_sys_nanosleep_fun(req, rem);
+    }
+    if (req == nullptr || req->tv_nsec < 0 || req->tv_nsec >= 1000000000) {
+        errno = EINVAL;
+        return -1;
+    }
+    // 定时器精度是毫秒，不足1ms的按1ms算
+    int64_t ms = req->tv_sec * 1000 + (req->tv_nsec + 999999) / 1000000;
+    corpc::sleepMs(ms);
+    if (rem) {
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
 
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine();
+int usleep_hook(useconds_t usec)
+{
+    if (corpc::Coroutine::isMainCoroutine()) {
+        return g_sys_usleep_fun(usec);
+    }
+    corpc::sleepMs(((int64_t)usec + 999) / 1000);
+    return 0;
+}
 
-    bool isTimeout = false;
-    auto timeoutcb = [curCor, &isTimeout]() {
-        LOG_DEBUG << "onTime, now resume sleep cor";
-        isTimeout = true;
-        // 设置超时标志，然后唤醒协程
-        corpc::Coroutine::resume(curCor);
-    };
+// 在协程中执行一次非阻塞io，暂时不可读写时把fd注册到epoll并挂起协程，被唤醒后再执行一次
+// 和read_hook一样，超时由调用方的定时器唤醒协程后返回EAGAIN
+template <class IOFunc>
+static ssize_t ioHook(int fd, corpc::IOEvent event, const char *name, IOFunc func)
+{
+    corpc::Channel::ptr channel = corpc::ChannelContainer::getChannelContainer()->getChannel(fd);
+    if (channel->getEventLoop() == nullptr) {
+        channel->setEventLoop(corpc::EventLoop::getEventLoop());
+    }
 
-    corpc::TimerEvent::ptr event = std::make_shared<corpc::TimerEvent>(1000 * seconds, false, timeoutcb);
+    channel->setNonBlock();
 
-    corpc::EventLoop::getEventLoop()->getTimer()->addTimerEvent(event);
+    if (channel->isEdgeMode()) {
+        return edgeIO(channel, event, 0, func);
+    }
 
-    LOG_DEBUG << "now to yield sleep";
-    // beacuse read or write maybe resume this coroutine, so when this cor be resumed, must check is timeout, otherwise should yield again
-    while (!isTimeout) {
-        corpc::Coroutine::yield();
+    ssize_t n = func();
+    if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return n;
     }
 
-    return 0;
+    toEpoll(channel, event);
+
+    LOG_DEBUG << name << " func to yield";
+    corpc::Coroutine::yield();
+
+    channel->delListenEvents(event);
+    channel->clearCoroutine();
+
+    LOG_DEBUG << name << " func yield back, now to call sys " << name;
+    return func();
+}
+
+ssize_t readv_hook(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (corpc::Coroutine::isMainCoroutine()) {
+        return g_sys_readv_fun(fd, iov, iovcnt);
+    }
+    return ioHook(fd, corpc::IOEvent::READ, "readv", [=]() { return g_sys_readv_fun(fd, iov, iovcnt); });
+}
+
+ssize_t writev_hook(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (corpc::Coroutine::isMainCoroutine()) {
+        return g_sys_writev_fun(fd, iov, iovcnt);
+    }
+    return ioHook(fd, corpc::IOEvent::WRITE, "writev", [=]() { return g_sys_writev_fun(fd, iov, iovcnt); });
+}
+
+// 调用方自己指定了MSG_DONTWAIT时不需要挂起
+ssize_t recv_hook(int sockfd, void *buf, size_t len, int flags)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_recv_fun(sockfd, buf, len, flags);
+    }
+    corpc::IoOp op(corpc::IoOp::Recv, sockfd, buf, len, flags);
+    ssize_t ret = 0;
+    if (submitToReactor(op, ret)) {
+        return ret;
+    }
+    return ioHook(sockfd, corpc::IOEvent::READ, "recv", [=]() { return g_sys_recv_fun(sockfd, buf, len, flags); });
+}
+
+ssize_t send_hook(int sockfd, const void *buf, size_t len, int flags)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_send_fun(sockfd, buf, len, flags);
+    }
+    corpc::IoOp op(corpc::IoOp::Send, sockfd, const_cast<void*>(buf), len, flags);
+    ssize_t ret = 0;
+    if (submitToReactor(op, ret)) {
+        return ret;
+    }
+    return ioHook(sockfd, corpc::IOEvent::WRITE, "send", [=]() { return g_sys_send_fun(sockfd, buf, len, flags); });
+}
+
+ssize_t recvfrom_hook(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_recvfrom_fun(sockfd, buf, len, flags, src_addr, addrlen);
+    }
+    return ioHook(sockfd, corpc::IOEvent::READ, "recvfrom", [=]() {
+        return g_sys_recvfrom_fun(sockfd, buf, len, flags, src_addr, addrlen);
+    });
+}
+
+ssize_t sendto_hook(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_sendto_fun(sockfd, buf, len, flags, dest_addr, addrlen);
+    }
+    return ioHook(sockfd, corpc::IOEvent::WRITE, "sendto", [=]() {
+        return g_sys_sendto_fun(sockfd, buf, len, flags, dest_addr, addrlen);
+    });
+}
+
+ssize_t recvmsg_hook(int sockfd, struct msghdr *msg, int flags)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_recvmsg_fun(sockfd, msg, flags);
+    }
+    return ioHook(sockfd, corpc::IOEvent::READ, "recvmsg", [=]() { return g_sys_recvmsg_fun(sockfd, msg, flags); });
+}
+
+ssize_t sendmsg_hook(int sockfd, const struct msghdr *msg, int flags)
+{
+    if (corpc::Coroutine::isMainCoroutine() || (flags & MSG_DONTWAIT)) {
+        return g_sys_sendmsg_fun(sockfd, msg, flags);
+    }
+    return ioHook(sockfd, corpc::IOEvent::WRITE, "sendmsg", [=]() { return g_sys_sendmsg_fun(sockfd, msg, flags); });
+}
+
+// 把pollfd的事件合并注册到一个私有的epoll fd中，失败时返回false
+// 不使用fd自己的channel，不会覆盖连接的回调和监听事件，边缘触发的channel也不受影响
+static bool addPollFds(int epfd, struct pollfd *fds, nfds_t nfds)
+{
+    std::unordered_map<int, uint32_t> merged;
+    for (nfds_t i = 0; i < nfds; i++) {
+        if (fds[i].fd < 0) {
+            continue;
+        }
+        uint32_t events = 0;
+        if (fds[i].events & POLLIN) {
+            events |= EPOLLIN;
+        }
+        if (fds[i].events & POLLPRI) {
+            events |= EPOLLPRI;
+        }
+        if (fds[i].events & POLLOUT) {
+            events |= EPOLLOUT;
+        }
+        if (fds[i].events & POLLRDHUP) {
+            events |= EPOLLRDHUP;
+        }
+        merged[fds[i].fd] |= events;
+    }
+    for (auto &item : merged) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = item.second;
+        event.data.fd = item.first;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, item.first, &event) != 0) {
+            LOG_WARN << "poll add fd:[" << item.first << "] to epoll failed, errno=" << errno << ", error=" << strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 任意一个fd就绪时私有epoll fd变为可读，只把它注册到当前事件循环，通过CoWaiter唤醒协程
+int poll_hook(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if (corpc::Coroutine::isMainCoroutine() || timeout == 0) {
+        return g_sys_poll_fun(fds, nfds, timeout);
+    }
+
+    int n = g_sys_poll_fun(fds, nfds, 0);
+    if (n != 0) {
+        return n;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0 || !addPollFds(epfd, fds, nfds)) {
+        LOG_ERROR << "poll can't wait in coroutine, block the thread instead, errno=" << errno;
+        if (epfd >= 0) {
+            close(epfd);
+        }
+        return g_sys_poll_fun(fds, nfds, timeout);
+    }
+
+    corpc::Channel::ptr channel = corpc::ChannelContainer::getChannelContainer()->getChannel(epfd);
+    channel->setEventLoop(corpc::EventLoop::getEventLoop());
+    int64_t deadline = timeout > 0 ? corpc::getNowMs() + timeout : 0;
+
+    while (true) {
+        // 每轮一个新的等待者，上一轮已经投递的回调不会唤醒这一轮
+        corpc::CoWaiter::ptr waiter = corpc::CoWaiter::current();
+        channel->setCallBack(corpc::IOEvent::READ, [waiter]() { waiter->wake(); });
+        channel->addListenEvents(corpc::IOEvent::READ);
+
+        int64_t rest = deadline > 0 ? deadline - corpc::getNowMs() : 0;
+        LOG_DEBUG << "poll func to yield, nfds=" << nfds;
+        bool isTimeout = !waiter->park(deadline > 0 && rest <= 0 ? 1 : rest);
+
+        n = g_sys_poll_fun(fds, nfds, 0);
+        if (n != 0 || isTimeout) {
+            break;
+        }
+        // 事件被其他人消费掉了，继续等待
+    }
+
+    channel->unregisterFromEventLoop();
+    close(epfd);
+    return n;
+}
+
+// 转换成poll，fd_set的大小限制仍然由调用方保证
+int select_hook(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    if (corpc::Coroutine::isMainCoroutine()) {
+        return g_sys_select_fun(nfds, readfds, writefds, exceptfds, timeout);
+    }
+
+    std::vector<struct pollfd> fds;
+    for (int fd = 0; fd < nfds; fd++) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds)) {
+            events |= POLLIN;
+        }
+        if (writefds && FD_ISSET(fd, writefds)) {
+            events |= POLLOUT;
+        }
+        if (exceptfds && FD_ISSET(fd, exceptfds)) {
+            events |= POLLPRI;
+        }
+        if (events) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = events;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+    }
+
+    int timeoutMs = -1;
+    if (timeout) {
+        timeoutMs = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+    }
+
+    int n = poll_hook(fds.data(), fds.size(), timeoutMs);
+    if (n < 0) {
+        return n;
+    }
+
+    if (readfds) {
+        FD_ZERO(readfds);
+    }
+    if (writefds) {
+        FD_ZERO(writefds);
+    }
+    if (exceptfds) {
+        FD_ZERO(exceptfds);
+    }
+    int count = 0;
+    for (auto &pfd : fds) {
+        if (readfds && (pfd.events & POLLIN) && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            FD_SET(pfd.fd, readfds);
+            count++;
+        }
+        if (writefds && (pfd.events & POLLOUT) && (pfd.revents & (POLLOUT | POLLERR))) {
+            FD_SET(pfd.fd, writefds);
+            count++;
+        }
+        if (exceptfds && (pfd.events & POLLPRI) && (pfd.revents & POLLPRI)) {
+            FD_SET(pfd.fd, exceptfds);
+            count++;
+        }
+    }
+    if (n == 0 && timeout) {
+        timeout->tv_sec = 0;
+        timeout->tv_usec = 0;
+    }
+    return count;
+}
+
+// getaddrinfo没有非阻塞的版本，放到后台线程池中执行，不阻塞io线程
+// 一个解析慢（比如dns超时）时其他线程仍然可以处理别的解析，排队太多时直接失败
+static const int GETADDRINFO_THREAD_NUM = 4;
+static const size_t GETADDRINFO_MAX_PENDING = 1024;
+// 协程最多等待的时间，ms，超时后后台线程的结果直接丢弃
+static const int64_t GETADDRINFO_TIMEOUT_MS = 10000;
+
+// 一次解析请求，等待的协程超时返回之后后台线程仍然会访问它
+struct AddrInfoCall {
+    typedef std::shared_ptr<AddrInfoCall> ptr;
+    std::string node;
+    std::string service;
+    bool hasNode{false};
+    bool hasService{false};
+    bool hasHints{false};
+    struct addrinfo hints;
+    int ret{0};
+    int savedErrno{0};
+    struct addrinfo *res{nullptr};
+    corpc::CoWaiter::ptr waiter;
+};
+
+struct AddrInfoPool {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<AddrInfoCall::ptr> calls;
+};
+
+// 进程退出时不析构，后台线程可能还在使用
+static AddrInfoPool *gAddrInfoPool = nullptr;
+static std::once_flag gAddrInfoPoolOnce;
+
+static void addrInfoThreadFunc()
+{
+    while (true) {
+        AddrInfoCall::ptr call;
+        {
+            std::unique_lock<std::mutex> lock(gAddrInfoPool->mutex);
+            gAddrInfoPool->cond.wait(lock, []() { return !gAddrInfoPool->calls.empty(); });
+            call = gAddrInfoPool->calls.front();
+            gAddrInfoPool->calls.pop_front();
+        }
+        call->ret = g_sys_getaddrinfo_fun(call->hasNode ? call->node.c_str() : nullptr, call->hasService ? call->service.c_str() : nullptr,
+                                          call->hasHints ? &call->hints : nullptr, &call->res);
+        call->savedErrno = errno;
+        if (!call->waiter->wake() && call->ret == 0) {
+            // 等待的协程已经超时返回，没有人会再使用结果
+            freeaddrinfo(call->res);
+            call->res = nullptr;
+        }
+    }
+}
+
+// 放入线程池排队，队列已满时返回false
+static bool submitAddrInfoCall(AddrInfoCall::ptr call)
+{
+    std::call_once(gAddrInfoPoolOnce, []() {
+        gAddrInfoPool = new AddrInfoPool();
+        CpuAffinity::ScopedUnbind unbind;
+        for (int i = 0; i < GETADDRINFO_THREAD_NUM; ++i) {
+            std::thread(addrInfoThreadFunc).detach();
+        }
+    });
+    {
+        std::unique_lock<std::mutex> lock(gAddrInfoPool->mutex);
+        if (gAddrInfoPool->calls.size() >= GETADDRINFO_MAX_PENDING) {
+            return false;
+        }
+        gAddrInfoPool->calls.push_back(call);
+    }
+    gAddrInfoPool->cond.notify_one();
+    return true;
+}
+
+int getaddrinfo_hook(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+    corpc::CoWaiter::ptr waiter = corpc::CoWaiter::current();
+    if (!waiter) {
+        return g_sys_getaddrinfo_fun(node, service, hints, res);
+    }
+
+    // 超时返回之后调用方的参数可能失效，后台线程使用拷贝
+    AddrInfoCall::ptr call = std::make_shared<AddrInfoCall>();
+    call->hasNode = node != nullptr;
+    call->node = node ? node : "";
+    call->hasService = service != nullptr;
+    call->service = service ? service : "";
+    if (hints) {
+        call->hasHints = true;
+        memset(&call->hints, 0, sizeof(call->hints));
+        call->hints.ai_flags = hints->ai_flags;
+        call->hints.ai_family = hints->ai_family;
+        call->hints.ai_socktype = hints->ai_socktype;
+        call->hints.ai_protocol = hints->ai_protocol;
+    }
+    call->waiter = waiter;
+
+    if (!submitAddrInfoCall(call)) {
+        LOG_ERROR << "getaddrinfo error, too many pending calls";
+        return EAI_AGAIN;
+    }
+
+    LOG_DEBUG << "getaddrinfo func to yield";
+    if (!waiter->park(GETADDRINFO_TIMEOUT_MS)) {
+        LOG_ERROR << "getaddrinfo error, timeout after " << GETADDRINFO_TIMEOUT_MS << " ms";
+        return EAI_AGAIN;
+    }
+    errno = call->savedErrno;
+    *res = call->res;
+    return call->ret;
 }
 
 }
@@ -303,4 +777,134 @@ unsigned int sleep(unsigned int seconds)
     }
 }
 
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (!corpc::gHook) {
+        return g_sys_readv_fun(fd, iov, iovcnt);
+    }
+    else {
+        return corpc::readv_hook(fd, iov, iovcnt);
+    }
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (!corpc::gHook) {
+        return g_sys_writev_fun(fd, iov, iovcnt);
+    }
+    else {
+        return corpc::writev_hook(fd, iov, iovcnt);
+    }
+}
+
+ssize_t recv(int sockfd, void *buf, size_t len, int flags)
+{
+    if (!corpc::gHook) {
+        return g_sys_recv_fun(sockfd, buf, len, flags);
+    }
+    else {
+        return corpc::recv_hook(sockfd, buf, len, flags);
+    }
+}
+
+ssize_t send(int sockfd, const void *buf, size_t len, int flags)
+{
+    if (!corpc::gHook) {
+        return g_sys_send_fun(sockfd, buf, len, flags);
+    }
+    else {
+        return corpc::send_hook(sockfd, buf, len, flags);
+    }
+}
+
+ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen)
+{
+    if (!corpc::gHook) {
+        return g_sys_recvfrom_fun(sockfd, buf, len, flags, src_addr, addrlen);
+    }
+    else {
+        return corpc::recvfrom_hook(sockfd, buf, len, flags, src_addr, addrlen);
+    }
+}
+
+ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+    if (!corpc::gHook) {
+        return g_sys_sendto_fun(sockfd, buf, len, flags, dest_addr, addrlen);
+    }
+    else {
+        return corpc::sendto_hook(sockfd, buf, len, flags, dest_addr, addrlen);
+    }
+}
+
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
+{
+    if (!corpc::gHook) {
+        return g_sys_recvmsg_fun(sockfd, msg, flags);
+    }
+    else {
+        return corpc::recvmsg_hook(sockfd, msg, flags);
+    }
+}
+
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags)
+{
+    if (!corpc::gHook) {
+        return g_sys_sendmsg_fun(sockfd, msg, flags);
+    }
+    else {
+        return corpc::sendmsg_hook(sockfd, msg, flags);
+    }
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if (!corpc::gHook) {
+        return g_sys_poll_fun(fds, nfds, timeout);
+    }
+    else {
+        return corpc::poll_hook(fds, nfds, timeout);
+    }
+}
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    if (!corpc::gHook) {
+        return g_sys_select_fun(nfds, readfds, writefds, exceptfds, timeout);
+    }
+    else {
+        return corpc::select_hook(nfds, readfds, writefds, exceptfds, timeout);
+    }
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    if (!corpc::gHook) {
+        return g_sys_nanosleep_fun(req, rem);
+    }
+    else {
+        return corpc::nanosleep_hook(req, rem);
+    }
+}
+
+int usleep(useconds_t usec)
+{
+    if (!corpc::gHook) {
+        return g_sys_usleep_fun(usec);
+    }
+    else {
+        return corpc::usleep_hook(usec);
+    }
+}
+
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+    if (!corpc::gHook) {
+        return g_sys_getaddrinfo_fun(node, service, hints, res);
+    }
+    else {
+        return corpc::getaddrinfo_hook(node, service, hints, res);
+    }
+}
+
 }
\ No newline at end of file
@@ -2,8 +2,13 @@
 #define CORPC_COROUTINE_COUROUTINE_HOOK_H
 
 #include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <ctime>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/select.h>
 
 typedef ssize_t (*read_fun_ptr_t)(int fd, void *buf, size_t count);
 typedef ssize_t (*write_fun_ptr_t)(int fd, const void *buf, size_t count);
@@ -11,6 +16,19 @@ typedef int (*connect_fun_ptr_t)(int sockfd, const struct sockaddr *addr, sockle
 typedef int (*accept_fun_ptr_t)(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
 typedef int (*socket_fun_ptr_t)(int domain, int type, int protocol);
 typedef int (*sleep_fun_ptr_t)(unsigned int seconds);
+typedef ssize_t (*readv_fun_ptr_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*writev_fun_ptr_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*recv_fun_ptr_t)(int sockfd, void *buf, size_t len, int flags);
+typedef ssize_t (*send_fun_ptr_t)(int sockfd, const void *buf, size_t len, int flags);
+typedef ssize_t (*recvfrom_fun_ptr_t)(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen);
+typedef ssize_t (*sendto_fun_ptr_t)(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen);
+typedef ssize_t (*recvmsg_fun_ptr_t)(int sockfd, struct msghdr *msg, int flags);
+typedef ssize_t (*sendmsg_fun_ptr_t)(int sockfd, const struct msghdr *msg, int flags);
+typedef int (*poll_fun_ptr_t)(struct pollfd *fds, nfds_t nfds, int timeout);
+typedef int (*select_fun_ptr_t)(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+typedef int (*nanosleep_fun_ptr_t)(const struct timespec *req, struct timespec *rem);
+typedef int (*usleep_fun_ptr_t)(useconds_t usec);
+typedef int (*getaddrinfo_fun_ptr_t)(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res);
 
 
 namespace corpc {
@@ -20,6 +38,19 @@ ssize_t read_hook(int fd, void *buf, size_t count);
 ssize_t write_hook(int fd, const void *buf, size_t count);
 int connect_hook(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 unsigned int sleep_hook(unsigned int seconds);
+ssize_t readv_hook(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev_hook(int fd, const struct iovec *iov, int iovcnt);
+ssize_t recv_hook(int sockfd, void *buf, size_t len, int flags);
+ssize_t send_hook(int sockfd, const void *buf, size_t len, int flags);
+ssize_t recvfrom_hook(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen);
+ssize_t sendto_hook(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen);
+ssize_t recvmsg_hook(int sockfd, struct msghdr *msg, int flags);
+ssize_t sendmsg_hook(int sockfd, const struct msghdr *msg, int flags);
+int poll_hook(struct pollfd *fds, nfds_t nfds, int timeout);
+int select_hook(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+int nanosleep_hook(const struct timespec *req, struct timespec *rem);
+int usleep_hook(useconds_t usec);
+int getaddrinfo_hook(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res);
 void setHook(bool);
 
 }
@@ -31,6 +62,19 @@ ssize_t read(int fd, void *buf, size_t count);
 ssize_t write(int fd, const void *buf, size_t count);
 int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 unsigned int sleep(unsigned int seconds);
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t recv(int sockfd, void *buf, size_t len, int flags);
+ssize_t send(int sockfd, const void *buf, size_t len, int flags);
+ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen);
+ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen);
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags);
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags);
+int poll(struct pollfd *fds, nfds_t nfds, int timeout);
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+int nanosleep(const struct timespec *req, struct timespec *rem);
+int usleep(useconds_t usec);
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res);
 
 }
 
@@ -0,0 +1,57 @@
+#ifndef CORPC_COROUTINE_COROUTINE_LOCAL_H
+#define CORPC_COROUTINE_COROUTINE_LOCAL_H
+
+#include <memory>
+#include "corpc/coroutine/coroutine.h"
+#include "corpc/common/runtime.h"
+
+namespace corpc {
+
+// 协程局部变量，值保存在当前请求的上下文（RunTime）中
+// 构造时分配固定的下标，读写直接按下标访问，不需要查表
+// 通过EventLoop::runInCoroutine、IOThreadPool、客户端channel等派生的协程共享同一份上下文，能读到父协程设置的值
+// 应该在派生子协程之前设置好值，比如：
+// static corpc::CoroutineLocal<std::string> gUserId;
+// gUserId.set(std::make_shared<std::string>("user"));
+template <class T>
+class CoroutineLocal {
+public:
+    CoroutineLocal() : index_(RunTime::allocSlot()) {}
+    ~CoroutineLocal() = default;
+
+    // 没有设置过或者当前不在请求上下文中时返回nullptr
+    T *get() const
+    {
+        RunTime *runtime = getCurrentRunTime();
+        if (!runtime) {
+            return nullptr;
+        }
+        return static_cast<T *>(runtime->getSlot(index_));
+    }
+
+    // 当前协程还没有上下文时创建一个，在主协程中调用或者局部变量超过RunTime::MAX_SLOTS个时返回false
+    bool set(std::shared_ptr<T> value)
+    {
+        RunTime *runtime = getCurrentRunTime();
+        if (!runtime) {
+            if (Coroutine::isMainCoroutine()) {
+                return false;
+            }
+            runtime = Coroutine::getCurrentCoroutine()->resetRunTime();
+        }
+        return runtime->setSlot(index_, value);
+    }
+
+    T *operator->() const { return get(); }
+
+private:
+    CoroutineLocal(const CoroutineLocal &) = delete;
+    CoroutineLocal &operator=(const CoroutineLocal &) = delete;
+
+private:
+    const size_t index_;
+};
+
+}
+
+#endif
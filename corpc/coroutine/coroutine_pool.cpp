@@ -2,6 +2,7 @@
 #include <sys/mman.h>
 #include "corpc/common/config.h"
 #include "corpc/common/log.h"
+#include "corpc/common/cpu_affinity.h"
 #include "corpc/coroutine/coroutine_pool.h"
 #include "corpc/coroutine/coroutine.h"
 
@@ -9,8 +10,17 @@ namespace corpc {
 
 extern corpc::Config::ptr gConfig;
 static CoroutinePool *tCoroutineContainerPtr = nullptr;
+static thread_local CoroutinePool *tLocalCoroutinePool = nullptr;
 
 CoroutinePool *getCoroutinePool()
+{
+    if (tLocalCoroutinePool) {
+        return tLocalCoroutinePool;
+    }
+    return getSharedCoroutinePool();
+}
+
+CoroutinePool *getSharedCoroutinePool()
 {
     if (!tCoroutineContainerPtr) {
         tCoroutineContainerPtr = new CoroutinePool(gConfig->corPoolSize, gConfig->corStackSize);
@@ -18,11 +28,19 @@ CoroutinePool *getCoroutinePool()
     return tCoroutineContainerPtr;
 }
 
-CoroutinePool::CoroutinePool(int poolSize, int stackSize /*= 1024 * 128 B*/) : poolSize_(poolSize), stackSize_(stackSize)
+CoroutinePool *initLocalCoroutinePool(int poolSize /* = 0*/)
+{
+    if (!tLocalCoroutinePool) {
+        tLocalCoroutinePool = new CoroutinePool(poolSize > 0 ? poolSize : gConfig->corPoolSize, gConfig->corStackSize, CpuAffinity::getCurrentNumaNode());
+    }
+    return tLocalCoroutinePool;
+}
+
+CoroutinePool::CoroutinePool(int poolSize, int stackSize /*= 1024 * 128 B*/, int numaNode /* = -1*/) : poolSize_(poolSize), stackSize_(stackSize), numaNode_(numaNode)
 {
     // set main coroutine first
     Coroutine::getCurrentCoroutine(); // 如果主协程未设置，先设置主协程
-    memoryPool_.push_back(std::make_shared<Memory>(stackSize, poolSize));
+    memoryPool_.push_back(std::make_shared<Memory>(stackSize, poolSize, numaNode));
     Memory::ptr temp = memoryPool_[0];
 
     // 预先分配一部分堆内存，协程优先使用预分配的堆内存，如果用完了再额外申请/释放
@@ -30,6 +48,7 @@ CoroutinePool::CoroutinePool(int poolSize, int stackSize /*= 1024 * 128 B*/) : p
     for (int i = 0; i < poolSize; ++i) {
         Coroutine::ptr cor = std::make_shared<Coroutine>(stackSize, temp->getBlock());
         cor->setIndex(i);
+        cor->setPool(this);
         freeCors_.push_back(std::make_pair(cor, false));
     }
 }
@@ -54,15 +73,23 @@ Coroutine::ptr CoroutinePool::getCoroutineInstanse()
         char *temp = memoryPool_[i]->getBlock();
         if (temp) {
             Coroutine::ptr cor = std::make_shared<Coroutine>(stackSize_, temp);
+            cor->setPool(this);
             return cor;
         }
     }
-    memoryPool_.push_back(std::make_shared<Memory>(stackSize_, poolSize_));
-    return std::make_shared<Coroutine>(stackSize_, memoryPool_[memoryPool_.size() - 1]->getBlock());
+    memoryPool_.push_back(std::make_shared<Memory>(stackSize_, poolSize_, numaNode_));
+    Coroutine::ptr cor = std::make_shared<Coroutine>(stackSize_, memoryPool_[memoryPool_.size() - 1]->getBlock());
+    cor->setPool(this);
+    return cor;
 }
 
 void CoroutinePool::returnCoroutine(Coroutine::ptr cor)
 {
+    if (cor->getPool() && cor->getPool() != this) {
+        cor->getPool()->returnCoroutine(cor);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
     int i = cor->getIndex();
     if (i >= 0 && i < poolSize_) {
         freeCors_[i].second = false;
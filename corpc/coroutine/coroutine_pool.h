@@ -11,15 +11,18 @@ namespace corpc {
 class CoroutinePool {
 
 public:
-    CoroutinePool(int poolSize, int stackSize = 1024 * 128);
+    // numaNode >= 0 时协程栈优先从该numa节点分配
+    CoroutinePool(int poolSize, int stackSize = 1024 * 128, int numaNode = -1);
     ~CoroutinePool();
 
     Coroutine::ptr getCoroutineInstanse();
+    // 可以在任意线程归还，不属于这个协程池的协程会归还给分配它的协程池
     void returnCoroutine(Coroutine::ptr cor);
 
 private:
     int poolSize_{0};
     int stackSize_{0};
+    int numaNode_{-1};
 
     // first--ptr of cor
     // second
@@ -32,8 +35,16 @@ private:
     std::vector<Memory::ptr> memoryPool_;
 };
 
+// 当前线程使用的协程池，绑核的线程使用自己的协程池，其他线程共享同一个协程池
 CoroutinePool *getCoroutinePool();
 
+// 所有没有绑核的线程共享的协程池
+CoroutinePool *getSharedCoroutinePool();
+
+// 为当前线程创建自己的协程池，协程栈从线程绑定的numa节点分配，需要在绑核之后调用
+// poolSize <= 0 时使用配置的cor_pool_size
+CoroutinePool *initLocalCoroutinePool(int poolSize = 0);
+
 }
 
 #endif
\ No newline at end of file
@@ -3,16 +3,25 @@
 #include <cassert>
 #include <cstdlib>
 #include "corpc/common/log.h"
+#include "corpc/common/cpu_affinity.h"
 #include "corpc/coroutine/memory.h"
 
 namespace corpc {
 
-Memory::Memory(int blockSize, int blockCount) : blockSize_(blockSize), blockCount_(blockCount)
+Memory::Memory(int blockSize, int blockCount, int numaNode /* = -1*/) : blockSize_(blockSize), blockCount_(blockCount), numaNode_(numaNode)
 {
     size_ = blockCount_ * blockSize_;
-    start_ = (char *)malloc(size_);
-    assert(start_ != (void *)-1);
-    LOG_INFO << "succ mmap " << size_ << " bytes memory";
+    if (numaNode_ >= 0) {
+        // 页面在协程第一次使用栈时才分配，mbind保证无论在哪个线程上访问都优先落在该节点上
+        start_ = (char *)mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(start_ != (void *)-1);
+        CpuAffinity::bindMemory(start_, size_, numaNode_);
+    }
+    else {
+        start_ = (char *)malloc(size_);
+        assert(start_ != (void *)-1);
+    }
+    LOG_INFO << "succ mmap " << size_ << " bytes memory, numa node[" << numaNode_ << "]";
     end_ = start_ + size_;
     blocks_.resize(blockCount_);
     for (size_t i = 0; i < blocks_.size(); ++i) {
@@ -26,7 +35,12 @@ Memory::~Memory()
     if (!start_ || start_ == (void *)-1) {
         return;
     }
-    free(start_);
+    if (numaNode_ >= 0) {
+        munmap(start_, size_);
+    }
+    else {
+        free(start_);
+    }
     LOG_INFO << "~succ free munmap " << size_ << " bytes memory";
     start_ = end_ = nullptr;
     refCounts_ = 0;
@@ -8,12 +8,12 @@
 
 namespace corpc {
 
-/** 协程使用的栈空间，来源于malloc分配的堆内存 */
+/** 协程使用的栈空间，来源于malloc分配的堆内存，指定numa节点时使用mmap分配并优先放在该节点上 */
 class Memory {
 public:
     typedef std::shared_ptr<Memory> ptr;
 
-    Memory(int blockSize, int blockCount);
+    Memory(int blockSize, int blockCount, int numaNode = -1);
     ~Memory();
     int getRefCount();
     char *getStart();
@@ -27,6 +27,7 @@ private:
     int blockCount_{0};
 
     int size_{0};
+    int numaNode_{-1};
     char *start_{nullptr};
     char *end_{nullptr};
 
@@ -10,6 +10,9 @@
 #include "corpc/common/start.h"
 #include "corpc/common/string_util.h"
 #include "corpc/common/md5.h"
+#include "corpc/common/xxhash.h"
+#include "corpc/common/crc32c.h"
+#include "corpc/common/compress.h"
 #include "corpc/common/noncopyable.h"
 #include "corpc/common/zk_util.h"
 
@@ -17,6 +20,7 @@
 #include "corpc/coroutine/coroutine_hook.h"
 #include "corpc/coroutine/coroutine_pool.h"
 #include "corpc/coroutine/coroutine.h"
+#include "corpc/coroutine/coroutine_local.h"
 #include "corpc/coroutine/memory.h"
 
 #include "corpc/net/abstract_codec.h"
@@ -26,11 +30,16 @@
 #include "corpc/net/channel.h"
 #include "corpc/net/event_loop.h"
 #include "corpc/net/mutex.h"
+#include "corpc/net/coroutine_sync.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/timer.h"
 #include "corpc/net/load_balance.h"
+#include "corpc/net/endpoint_stats.h"
+#include "corpc/net/outlier_detector.h"
+#include "corpc/net/latency_histogram.h"
 #include "corpc/net/abstract_service_register.h"
 #include "corpc/net/service_register.h"
+#include "corpc/net/service_discovery.h"
 
 #include "corpc/net/http/http_codec.h"
 #include "corpc/net/http/http_define.h"
@@ -47,11 +56,13 @@
 #include "corpc/net/pb/pb_rpc_client_channel.h"
 #include "corpc/net/pb/pb_rpc_client_block_channel.h"
 #include "corpc/net/pb/pb_rpc_client_async_channel.h"
+#include "corpc/net/pb/pb_rpc_future.h"
 #include "corpc/net/pb/pb_rpc_closure.h"
 #include "corpc/net/pb/pb_rpc_dispatcher.h"
 
 #include "corpc/net/tcp/abstract_slot.h"
 #include "corpc/net/tcp/io_thread.h"
+#include "corpc/net/tcp/client_runtime.h"
 #include "corpc/net/tcp/tcp_client.h"
 #include "corpc/net/tcp/tcp_connection.h"
 #include "corpc/net/tcp/tcp_server.h"
@@ -1,6 +1,8 @@
 #ifndef CORPC_NET_ABSTRACT_DATA_H
 #define CORPC_NET_ABSTRACT_DATA_H
 
+#include <cstdint>
+
 namespace corpc {
 
 class AbstractData {
@@ -10,6 +12,7 @@ public:
 
     bool decodeSucc_{false};
     bool encodeSucc_{false};
+    int64_t recvTime_{0}; // 服务端收到这个请求的时间（ms），截止时间从这里开始算
 };
 
 }
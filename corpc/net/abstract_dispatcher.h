@@ -4,6 +4,7 @@
 #include <memory>
 #include "corpc/net/abstract_data.h"
 #include "corpc/net/tcp/tcp_connection.h"
+#include "corpc/net/concurrency_limiter.h"
 
 namespace corpc {
 
@@ -15,6 +16,11 @@ public:
     virtual ~AbstractDispatcher() {}
 
     virtual void dispatch(AbstractData *data, const TcpConnection::ptr &conn) = 0;
+
+    void setLimiter(ConcurrencyLimiter::ptr limiter) { limiter_ = limiter; }
+
+protected:
+    ConcurrencyLimiter::ptr limiter_; // 为空时不限制
 };
 
 }
@@ -7,6 +7,7 @@
 #include <google/protobuf/service.h>
 #include "corpc/net/net_address.h"
 #include "corpc/net/custom/custom_service.h"
+#include "corpc/net/service_discovery.h"
 
 namespace corpc {
 
@@ -20,6 +21,13 @@ public:
     virtual void registerService(std::shared_ptr<google::protobuf::Service> service, NetAddress::ptr addr) = 0;
     virtual void registerService(std::shared_ptr<CustomService> service, NetAddress::ptr addr) = 0;
     virtual std::vector<NetAddress::ptr> discoverService(const std::string &serviceName) = 0;
+    // 订阅服务地址，返回的缓存可以长期持有，每次调用前取快照即可拿到最新地址
+    // 默认实现只拉取一次地址，不会自动刷新
+    virtual ServiceEndpoints::ptr subscribeService(const std::string &serviceName) {
+        ServiceEndpoints::ptr endpoints = std::make_shared<ServiceEndpoints>(serviceName);
+        endpoints->update(discoverService(serviceName));
+        return endpoints;
+    }
     virtual void clear() = 0;
 };
 
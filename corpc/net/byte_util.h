@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <string>
 #include <arpa/inet.h>
 
 namespace corpc {
@@ -14,6 +15,49 @@ inline int32_t getInt32FromNetByte(const char *buf)
     return ntohl(temp);
 }
 
+inline uint64_t getUint64FromNetByte(const char *buf)
+{
+    uint64_t temp = 0;
+    for (int i = 0; i < 8; ++i) {
+        temp = (temp << 8) | (uint8_t)buf[i];
+    }
+    return temp;
+}
+
+inline void putUint64ToNetByte(std::string &out, uint64_t v)
+{
+    for (int i = 7; i >= 0; --i) {
+        out.push_back((char)(v >> (i * 8)));
+    }
+}
+
+// varint编码，每个字节的低7位存数据，最高位为1表示后面还有字节，小的数字只占一个字节
+inline void putVarint64(std::string &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+// 从[p, end)解析一个varint，返回占用的字节数，数据不完整时返回0，超过10个字节时返回-1
+inline int getVarint64(const char *p, const char *end, uint64_t &v)
+{
+    v = 0;
+    for (int i = 0; i < 10; ++i) {
+        if (p + i >= end) {
+            return 0;
+        }
+        uint8_t byte = (uint8_t)p[i];
+        v |= (uint64_t)(byte & 0x7f) << (7 * i);
+        if (!(byte & 0x80)) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -90,10 +90,24 @@ void Channel::unregisterFromEventLoop()
     if (!loop_) {
         loop_ = corpc::EventLoop::getEventLoop();
     }
+    // 协程迁移之后可能注册在其他事件循环中
+    EventLoop *edgeLoop = edgeLoop_.exchange(nullptr);
+    if (edgeLoop && edgeLoop != loop_) {
+        edgeLoop->delEvent(fd_);
+    }
     loop_->delEvent(fd_);
     listenEvents_ = 0;
     readCallback_ = nullptr;
     writeCallback_ = nullptr;
+    isEdgeMode_ = false;
+    readReady_ = true;
+    writeReady_ = true;
+    // 还在等待的协程不会再收到就绪事件，唤醒之后由hook返回错误
+    edgeGen_++;
+    // 当前线程不是事件循环的线程时传入nullptr，所有等待者都投递到各自的事件循环中唤醒
+    for (std::atomic<EdgeWaiter*> *slot : {&edgeReadWaiter_, &edgeWriteWaiter_}) {
+        takeEdgeWaiter(*slot, nullptr);
+    }
 }
 
 int Channel::getFd() const
@@ -166,6 +180,102 @@ Coroutine* Channel::getCoroutine()
     return coroutine_;
 }
 
+bool Channel::isEdgeReady(IOEvent event) const
+{
+    if (!edgeLoop_) {
+        return true;
+    }
+    return event == READ ? readReady_.load() : writeReady_.load();
+}
+
+void Channel::clearEdgeReady(IOEvent event)
+{
+    if (event == READ) {
+        readReady_ = false;
+    }
+    else if (event == WRITE) {
+        writeReady_ = false;
+    }
+}
+
+Coroutine *Channel::takeEdgeWaiter(std::atomic<EdgeWaiter*> &slot, EventLoop *current)
+{
+    // 只有一方能取走等待者，不会重复唤醒
+    EdgeWaiter *waiter = slot.exchange(nullptr);
+    if (!waiter) {
+        return nullptr;
+    }
+    if (waiter->loop == current) {
+        waiter->resumed = true;
+        return waiter->cor;
+    }
+    // 在等待者的事件循环中恢复，等待者挂起之前这个任务不会执行
+    waiter->loop->addTask([waiter]() {
+        waiter->resumed = true;
+        Coroutine::resume(waiter->cor);
+    }, true);
+    return nullptr;
+}
+
+bool Channel::waitEdgeEvent(IOEvent event)
+{
+    uint32_t gen = edgeGen_;
+    EventLoop *loop = EventLoop::getEventLoop();
+    EventLoop *edgeLoop = edgeLoop_;
+    if (edgeLoop != loop) {
+        // 协程被迁移到了其他线程，注册也要跟着迁移，这是唯一需要修改注册的情况
+        if (edgeLoop) {
+            edgeLoop->delEvent(fd_);
+        }
+        loop_ = loop;
+        edgeLoop_ = loop;
+        listenEvents_ = READ | WRITE | ETModel;
+        epoll_event ev;
+        ev.events = listenEvents_;
+        ev.data.ptr = this;
+        // 注册时已经就绪的事件也会返回
+        loop->addEvent(fd_, ev);
+    }
+
+    std::atomic<bool> &ready = event == READ ? readReady_ : writeReady_;
+    std::atomic<EdgeWaiter*> &slot = event == READ ? edgeReadWaiter_ : edgeWriteWaiter_;
+    EdgeWaiter waiter;
+    waiter.cor = Coroutine::getCurrentCoroutine();
+    waiter.loop = loop;
+    ready = false;
+    slot = &waiter;
+    // 先登记再检查就绪标记，和onEdgeEvent先设置标记再取等待者对应，两边至少有一方能看到对方
+    EdgeWaiter *expected = &waiter;
+    if (ready && slot.compare_exchange_strong(expected, nullptr)) {
+        return gen == edgeGen_;
+    }
+    Coroutine::yield();
+    if (!waiter.resumed) {
+        // 被其他原因（比如超时）提前唤醒，收回登记；已经被取走时等待投递的恢复任务，避免它之后错误地恢复当前协程
+        expected = &waiter;
+        if (!slot.compare_exchange_strong(expected, nullptr)) {
+            while (!waiter.resumed) {
+                Coroutine::yield();
+            }
+        }
+    }
+    return gen == edgeGen_;
+}
+
+void Channel::onEdgeEvent(uint32_t events, Coroutine *&readCor, Coroutine *&writeCor)
+{
+    // 出错和挂断时读写都会立即返回错误，当作就绪
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        readReady_ = true;
+    }
+    if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        writeReady_ = true;
+    }
+    EventLoop *loop = EventLoop::getEventLoop();
+    readCor = readReady_ ? takeEdgeWaiter(edgeReadWaiter_, loop) : nullptr;
+    writeCor = writeReady_ ? takeEdgeWaiter(edgeWriteWaiter_, loop) : nullptr;
+}
+
 Channel::ptr ChannelContainer::getChannel(int fd) {
     RWMutex::ReadLock rlock(mutex_);
     if (fd < static_cast<int>(fds_.size())) {
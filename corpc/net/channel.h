@@ -7,6 +7,7 @@
 #include <sys/epoll.h>
 #include <cassert>
 #include <mutex>
+#include <atomic>
 #include "corpc/common/log.h"
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/net/mutex.h"
@@ -65,6 +66,29 @@ public:
 
     void clearCoroutine();
 
+    // 边缘触发模式（连接使用）：fd只在第一次等待时以 EPOLLIN | EPOLLOUT | EPOLLET 注册一次，之后不再调用epoll_ctl
+    // 就绪事件只更新就绪标记并唤醒等待的协程，从事件循环中删除时退出该模式
+    void setEdgeMode(bool v) { isEdgeMode_ = v; }
+
+    bool isEdgeMode() const { return isEdgeMode_; }
+
+    // 以边缘触发注册到的事件循环，没有注册时为nullptr
+    EventLoop *getEdgeLoop() const { return edgeLoop_; }
+
+    // 为false时说明已经读空/写满，并且之后没有收到就绪事件，可以不发起系统调用直接等待
+    bool isEdgeReady(IOEvent event) const;
+
+    void clearEdgeReady(IOEvent event);
+
+    // 挂起当前协程直到事件就绪或者被提前唤醒（比如超时），需要时把fd注册到当前事件循环
+    // 读和写可以分别有一个协程在等待，比如连接的协程在等待读的同时其他协程在发送回包
+    // 等待期间channel被从事件循环中删除（fd被关闭）时返回false
+    bool waitEdgeEvent(IOEvent event);
+
+    // 事件循环收到就绪事件时调用，返回需要在当前线程直接唤醒的读协程和写协程，没有时为nullptr
+    // 等待者属于其他事件循环（协程迁移之后旧的注册还没有删除）时投递到它自己的事件循环中唤醒
+    void onEdgeEvent(uint32_t events, Coroutine *&readCor, Coroutine *&writeCor);
+
 public:
     std::mutex mutex_;
 
@@ -78,6 +102,25 @@ protected:
     EventLoop *loop_{nullptr};
 
     Coroutine *coroutine_{nullptr};
+
+    // 等待就绪事件的协程，放在等待者的栈上，被唤醒之前不会释放
+    struct EdgeWaiter {
+        Coroutine *cor{nullptr};
+        EventLoop *loop{nullptr}; // 等待者所在的事件循环，只在这个线程中恢复它
+        bool resumed{false};      // 已经被就绪事件或者删除事件恢复，只在loop的线程中访问
+    };
+
+    // 取走等待者并唤醒，等待者属于当前事件循环时返回它由调用方直接恢复，否则投递到它的事件循环
+    static Coroutine *takeEdgeWaiter(std::atomic<EdgeWaiter*> &slot, EventLoop *current);
+
+    bool isEdgeMode_{false};
+    std::atomic<EventLoop*> edgeLoop_{nullptr};
+    // 就绪标记和等待者会被事件循环线程和迁移之后的协程所在线程同时访问
+    std::atomic<bool> readReady_{true};
+    std::atomic<bool> writeReady_{true};
+    std::atomic<EdgeWaiter*> edgeReadWaiter_{nullptr};  // 等待读就绪的协程
+    std::atomic<EdgeWaiter*> edgeWriteWaiter_{nullptr}; // 等待写就绪的协程
+    std::atomic<uint32_t> edgeGen_{0};  // 每次从事件循环中删除时加1
 };
 
 class ChannelContainer {
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include "corpc/net/concurrency_limiter.h"
+#include "corpc/net/timer.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+// 自适应模式下并发上限的最小值
+static const int MIN_LIMIT = 4;
+// 采样窗口，窗口时间和样本数都达到要求才更新一次上限
+static const int64_t SAMPLE_WINDOW_US = 100 * 1000;
+static const int64_t MIN_SAMPLE_COUNT = 20;
+// 平均耗时在空载耗时的1.5倍以内认为没有排队，上限只增不减
+static const double LATENCY_TOLERANCE = 1.5;
+// 新上限的平滑系数
+static const double SMOOTHING = 0.2;
+// 每隔多少个采样窗口重新测量一次空载耗时
+static const int64_t PROBE_INTERVAL_WINDOWS = 100;
+// 拒绝日志的最小间隔，过载时每个请求都打日志会进一步拖慢服务
+static const int64_t REJECT_LOG_INTERVAL_US = 1000 * 1000;
+
+ConcurrencyLimiter::ConcurrencyLimiter(bool adaptive, int maxConcurrency, int ipMaxConcurrency, const std::map<std::string, int> &methodMaxConcurrency)
+    : adaptive_(adaptive), maxConcurrency_(maxConcurrency), ipMaxConcurrency_(ipMaxConcurrency), limit_(maxConcurrency)
+{
+    for (auto &i : methodMaxConcurrency) {
+        std::unique_ptr<MethodQuota> quota(new MethodQuota());
+        quota->maxConcurrency = i.second;
+        methodQuotas_[i.first] = std::move(quota);
+    }
+    windowStartUs_ = getNowUs();
+    LOG_INFO << "succ create concurrency limiter, adaptive=" << adaptive_ << ", max concurrency=" << maxConcurrency_
+             << ", ip max concurrency=" << ipMaxConcurrency_ << ", method quota count=" << methodQuotas_.size();
+}
+
+bool ConcurrencyLimiter::onRequest(const std::string &method, const std::string &ip)
+{
+    int inflight = ++inflight_;
+    if (maxConcurrency_ > 0 && inflight > limit_) {
+        inflight_--;
+        onRejected(method, ip, "concurrency limit", limit_);
+        return false;
+    }
+
+    MethodQuota *quota = nullptr;
+    auto it = methodQuotas_.find(method);
+    if (it != methodQuotas_.end() && it->second->maxConcurrency > 0) {
+        quota = it->second.get();
+        if (++quota->inflight > quota->maxConcurrency) {
+            quota->inflight--;
+            inflight_--;
+            onRejected(method, ip, "method quota", quota->maxConcurrency);
+            return false;
+        }
+    }
+
+    if (ipMaxConcurrency_ > 0) {
+        std::unique_lock<std::mutex> lock(ipMutex_);
+        int &count = ipInflight_[ip];
+        if (count >= ipMaxConcurrency_) {
+            lock.unlock();
+            if (quota) {
+                quota->inflight--;
+            }
+            inflight_--;
+            onRejected(method, ip, "ip quota", ipMaxConcurrency_);
+            return false;
+        }
+        count++;
+    }
+    return true;
+}
+
+void ConcurrencyLimiter::onRejected(const std::string &method, const std::string &ip, const char *reason, int quota)
+{
+    int64_t total = ++rejected_;
+    int64_t now = getNowUs();
+    int64_t last = lastRejectLogUs_;
+    // 每个间隔只有抢到时间戳的线程打一条日志，带上这段时间内的拒绝数
+    if (now - last < REJECT_LOG_INTERVAL_US || !lastRejectLogUs_.compare_exchange_strong(last, now)) {
+        return;
+    }
+    int64_t count = total - loggedRejected_.exchange(total);
+    LOG_WARN << "rejected " << count << " requests since last report, total rejected=" << total << ", last rejected request of ["
+             << method << "] from [" << ip << "], " << reason << "=" << quota << ", inflight=" << inflight_;
+}
+
+void ConcurrencyLimiter::onFinish(const std::string &method, const std::string &ip, int64_t latencyUs, bool succ)
+{
+    inflight_--;
+    auto it = methodQuotas_.find(method);
+    if (it != methodQuotas_.end() && it->second->maxConcurrency > 0) {
+        it->second->inflight--;
+    }
+    if (ipMaxConcurrency_ > 0) {
+        std::unique_lock<std::mutex> lock(ipMutex_);
+        auto ipIt = ipInflight_.find(ip);
+        if (ipIt != ipInflight_.end() && --ipIt->second <= 0) {
+            ipInflight_.erase(ipIt);
+        }
+    }
+
+    if (!adaptive_ || maxConcurrency_ <= 0 || !succ) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(sampleMutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    sampleCount_++;
+    sampleTotalUs_ += latencyUs;
+    int64_t now = getNowUs();
+    if (now - windowStartUs_ < SAMPLE_WINDOW_US) {
+        return;
+    }
+    if (sampleCount_ >= MIN_SAMPLE_COUNT) {
+        updateLimit(sampleTotalUs_ / sampleCount_);
+    }
+    // 请求太少的窗口不能反映负载，直接丢弃
+    windowStartUs_ = now;
+    sampleCount_ = 0;
+    sampleTotalUs_ = 0;
+}
+
+void ConcurrencyLimiter::updateLimit(int64_t avgLatencyUs)
+{
+    double avg = avgLatencyUs > 0 ? (double)avgLatencyUs : 1.0;
+    if (probing_) {
+        // 并发减半的窗口里排队最少，用它的耗时作为新的空载耗时，业务本身变快或者变慢都能跟上
+        probing_ = false;
+        noLoadLatencyUs_ = avg;
+        limit_ = probeSavedLimit_;
+        LOG_DEBUG << "remeasure no load latency=" << avgLatencyUs << " us, restore concurrency limit to " << limit_;
+        return;
+    }
+    if (noLoadLatencyUs_ <= 0 || avg < noLoadLatencyUs_) {
+        noLoadLatencyUs_ = avg;
+    }
+
+    double gradient = noLoadLatencyUs_ * LATENCY_TOLERANCE / avg;
+    gradient = std::max(0.5, std::min(1.0, gradient));
+
+    double limit = limit_;
+    // 留出sqrt(limit)的排队空间，耗时稳定时上限慢慢增长
+    double newLimit = limit * gradient + std::sqrt(limit);
+    newLimit = limit * (1 - SMOOTHING) + newLimit * SMOOTHING;
+
+    int minLimit = std::min(MIN_LIMIT, maxConcurrency_);
+    int result = std::max(minLimit, std::min(maxConcurrency_, (int)std::ceil(newLimit)));
+    if (result != limit_) {
+        LOG_DEBUG << "update concurrency limit from " << limit_ << " to " << result << ", avg latency=" << avgLatencyUs
+                  << " us, no load latency=" << (int64_t)noLoadLatencyUs_ << " us";
+    }
+    limit_ = result;
+
+    // 一直满载时测不到空载耗时，定期把上限减半一个窗口重新测量
+    if (++windowCount_ % PROBE_INTERVAL_WINDOWS == 0) {
+        probing_ = true;
+        probeSavedLimit_ = result;
+        limit_ = std::max(minLimit, result / 2);
+    }
+}
+
+std::string ConcurrencyLimiter::getClientIP(NetAddress::ptr addr)
+{
+    if (!addr) {
+        return "";
+    }
+    std::shared_ptr<IPAddress> ipAddr = std::dynamic_pointer_cast<IPAddress>(addr);
+    return ipAddr ? ipAddr->getIP() : addr->toString();
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef CORPC_NET_CONCURRENCY_LIMITER_H
+#define CORPC_NET_CONCURRENCY_LIMITER_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "corpc/net/net_address.h"
+
+namespace corpc {
+
+// 服务端的准入控制，限制正在处理的请求数，超过限制的请求直接拒绝，不再占用协程
+// 三种限制同时生效：全局并发、每个方法的并发、每个客户端ip的并发
+// 自适应模式下全局并发上限随处理耗时调整：耗时接近空载耗时时慢慢放大，耗时变长时按比例缩小
+// 空载耗时取采样窗口平均耗时的最小值，每隔一段时间把上限减半一个窗口重新测量
+class ConcurrencyLimiter {
+public:
+    typedef std::shared_ptr<ConcurrencyLimiter> ptr;
+
+    // maxConcurrency为0时不限制全局并发，ipMaxConcurrency为0时不限制每个ip的并发
+    ConcurrencyLimiter(bool adaptive, int maxConcurrency, int ipMaxConcurrency, const std::map<std::string, int> &methodMaxConcurrency);
+    ~ConcurrencyLimiter() = default;
+
+    // 请求开始处理前调用，返回false时拒绝请求，返回true时处理完必须调用onFinish
+    bool onRequest(const std::string &method, const std::string &ip);
+
+    // 请求处理完成，latencyUs为处理耗时，只有成功的请求用来调整并发上限
+    void onFinish(const std::string &method, const std::string &ip, int64_t latencyUs, bool succ);
+
+    // 当前的全局并发上限，不限制时返回0
+    int getMaxConcurrency() const { return limit_; }
+    int getInflight() const { return inflight_; }
+    int64_t getRejectedCount() const { return rejected_; }
+
+    // 用于ip限制的客户端地址，ip地址只取ip，不区分端口
+    static std::string getClientIP(NetAddress::ptr addr);
+
+private:
+    struct MethodQuota {
+        int maxConcurrency{0};
+        std::atomic<int> inflight{0};
+    };
+
+    // 记录一次拒绝，日志按时间间隔汇总，避免过载时刷屏
+    void onRejected(const std::string &method, const std::string &ip, const char *reason, int quota);
+
+    // 一个采样窗口结束时更新并发上限
+    void updateLimit(int64_t avgLatencyUs);
+
+private:
+    bool adaptive_{false};
+    int maxConcurrency_{0};
+    int ipMaxConcurrency_{0};
+
+    std::atomic<int> limit_{0};
+    std::atomic<int> inflight_{0};
+    std::atomic<int64_t> rejected_{0};
+    std::atomic<int64_t> loggedRejected_{0};  // 上次打日志时的拒绝总数
+    std::atomic<int64_t> lastRejectLogUs_{0}; // 上次打拒绝日志的时间
+
+    // 构造之后只读，不需要加锁
+    std::unordered_map<std::string, std::unique_ptr<MethodQuota>> methodQuotas_;
+
+    std::mutex ipMutex_;
+    std::unordered_map<std::string, int> ipInflight_;
+
+    // 采样窗口，只在拿到锁的线程中更新，拿不到锁的样本直接丢弃
+    std::mutex sampleMutex_;
+    int64_t windowStartUs_{0};
+    int64_t sampleCount_{0};
+    int64_t sampleTotalUs_{0};
+    double noLoadLatencyUs_{0}; // 空载耗时，取窗口平均耗时的最小值，定期重新测量
+    int64_t windowCount_{0};
+    bool probing_{false};       // 当前窗口上限减半，用来重新测量空载耗时
+    int probeSavedLimit_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "corpc/net/coroutine_sync.h"
+#include "corpc/net/event_loop.h"
+#include "corpc/net/timer.h"
+#include "corpc/coroutine/coroutine.h"
+
+namespace corpc {
+
+CoWaiter::ptr CoWaiter::current()
+{
+    if (Coroutine::isMainCoroutine()) {
+        return nullptr;
+    }
+    CoWaiter::ptr waiter = std::make_shared<CoWaiter>();
+    waiter->cor = Coroutine::getCurrentCoroutine();
+    waiter->loop = EventLoop::getEventLoop();
+    return waiter;
+}
+
+CoWaiter::ptr CoWaiter::currentOrThread()
+{
+    CoWaiter::ptr waiter = current();
+    if (!waiter) {
+        waiter = std::make_shared<CoWaiter>();
+        waiter->thread.reset(new ThreadSignal());
+    }
+    return waiter;
+}
+
+bool CoWaiter::wake()
+{
+    bool expected = false;
+    if (!notified.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+    if (thread) {
+        std::unique_lock<std::mutex> lock(thread->mutex);
+        thread->woken = true;
+        thread->cond.notify_one();
+        return true;
+    }
+    // 在等待者自己的事件循环中恢复，唤醒者可能在其他io线程
+    Coroutine *waitCor = cor;
+    loop->addTask([waitCor]() { Coroutine::resume(waitCor); }, true);
+    return true;
+}
+
+bool CoWaiter::park(int64_t timeoutMs/* = 0*/)
+{
+    if (thread) {
+        std::unique_lock<std::mutex> lock(thread->mutex);
+        if (timeoutMs > 0) {
+            thread->cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return thread->woken; });
+            bool expected = false;
+            if (!thread->woken && notified.compare_exchange_strong(expected, true)) {
+                isTimeout = true;
+                return false;
+            }
+        }
+        // 超时的同时已经被唤醒时，等唤醒者设置完标记
+        thread->cond.wait(lock, [this]() { return thread->woken; });
+        return true;
+    }
+
+    CoTimeout timeout(timeoutMs);
+    Coroutine::yield();
+    if (timeout.isTimeout()) {
+        bool expected = false;
+        if (notified.compare_exchange_strong(expected, true)) {
+            isTimeout = true;
+        }
+        else {
+            // 超时的同时已经被唤醒，等待已经投递的唤醒任务，避免它之后错误地恢复当前协程
+            Coroutine::yield();
+        }
+    }
+    return !isTimeout;
+}
+
+bool CoWaitQueue::wakeOne()
+{
+    while (!waiters_.empty()) {
+        CoWaiter::ptr waiter = waiters_.front();
+        waiters_.pop_front();
+        if (waiter->wake()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CoWaitQueue::wakeAll()
+{
+    size_t count = 0;
+    while (wakeOne()) {
+        count++;
+    }
+    return count;
+}
+
+bool CoCondVar::wait(CoroutineMutex &mutex, int64_t timeoutMs/* = 0*/)
+{
+    CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+    {
+        // 先入队再释放mutex，释放之后的notify不会丢失
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.push(waiter);
+    }
+    mutex.unlock();
+    bool ret = waiter->park(timeoutMs);
+    mutex.lock();
+    return ret;
+}
+
+void CoCondVar::notifyOne()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.wakeOne();
+}
+
+void CoCondVar::notifyAll()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.wakeAll();
+}
+
+bool CoSemaphore::acquire(int64_t timeoutMs/* = 0*/)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (count_ > 0) {
+        count_--;
+        return true;
+    }
+    CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+    waiters_.push(waiter);
+    lock.unlock();
+    // 被唤醒时release已经把许可交给了当前协程
+    return waiter->park(timeoutMs);
+}
+
+bool CoSemaphore::tryAcquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (count_ > 0) {
+        count_--;
+        return true;
+    }
+    return false;
+}
+
+void CoSemaphore::release(size_t count/* = 1*/)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count; i++) {
+        if (!waiters_.wakeOne()) {
+            count_++;
+        }
+    }
+}
+
+void CoRWMutex::rdlock()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!writer_ && waiters_.empty()) {
+        readers_++;
+        return;
+    }
+    CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+    waiters_.push_back(RWWaiter{waiter, false});
+    lock.unlock();
+    waiter->park();
+}
+
+void CoRWMutex::wrlock()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!writer_ && readers_ == 0) {
+        writer_ = true;
+        return;
+    }
+    CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+    waiters_.push_back(RWWaiter{waiter, true});
+    lock.unlock();
+    waiter->park();
+}
+
+void CoRWMutex::unlock()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (writer_) {
+        writer_ = false;
+    }
+    else if (readers_ > 0) {
+        readers_--;
+    }
+    if (readers_ == 0) {
+        wakeWaiters();
+    }
+}
+
+void CoRWMutex::wakeWaiters()
+{
+    if (!waiters_.empty() && waiters_.front().isWriter) {
+        writer_ = true;
+        waiters_.front().waiter->wake();
+        waiters_.pop_front();
+        return;
+    }
+    while (!waiters_.empty() && !waiters_.front().isWriter) {
+        readers_++;
+        waiters_.front().waiter->wake();
+        waiters_.pop_front();
+    }
+}
+
+void WaitGroup::add(int count/* = 1*/)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    count_ += count;
+    if (count_ <= 0) {
+        count_ = 0;
+        waiters_.wakeAll();
+    }
+}
+
+void WaitGroup::done()
+{
+    add(-1);
+}
+
+bool WaitGroup::wait(int64_t timeoutMs/* = 0*/)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (count_ == 0) {
+        return true;
+    }
+    CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+    waiters_.push(waiter);
+    lock.unlock();
+    return waiter->park(timeoutMs);
+}
+
+}
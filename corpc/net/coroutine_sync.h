@@ -0,0 +1,247 @@
+#ifndef CORPC_NET_COROUTINE_SYNC_H
+#define CORPC_NET_COROUTINE_SYNC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "corpc/net/mutex.h"
+#include "corpc/common/log.h"
+
+// 协程同步原语，可以在多个io线程的协程之间使用
+// 等待的协程挂起，被唤醒时回到它所在io线程的事件循环中恢复执行，不会阻塞io线程
+// 不在协程中（主协程）调用时阻塞当前线程等待，不要在io线程的主协程中等待，会卡住该线程的事件循环
+
+namespace corpc {
+
+class Coroutine;
+class EventLoop;
+
+// 一个挂起的协程（或者阻塞的线程），唤醒和超时只有一个能生效
+struct CoWaiter {
+    typedef std::shared_ptr<CoWaiter> ptr;
+
+    // 不在协程中等待时用来阻塞线程
+    struct ThreadSignal {
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool woken{false};
+    };
+
+    Coroutine *cor{nullptr};
+    EventLoop *loop{nullptr};
+    std::unique_ptr<ThreadSignal> thread;
+    std::atomic<bool> notified{false};
+    bool isTimeout{false};
+
+    // 当前协程对应的等待者，在主协程中调用时返回nullptr
+    static CoWaiter::ptr current();
+
+    // 同current，在主协程中调用时返回阻塞当前线程的等待者
+    static CoWaiter::ptr currentOrThread();
+
+    // 唤醒等待者，已经被唤醒或者已经超时返回false
+    bool wake();
+
+    // 挂起当前协程直到被唤醒，timeoutMs <= 0 时一直等待，超时返回false
+    // 调用前必须已经把自己放入等待队列
+    bool park(int64_t timeoutMs = 0);
+};
+
+// 等待队列，本身不加锁，由使用者的锁保护
+class CoWaitQueue {
+public:
+    void push(CoWaiter::ptr waiter) { waiters_.push_back(waiter); }
+
+    bool empty() const { return waiters_.empty(); }
+
+    // 唤醒一个还在等待的协程，跳过已经超时的
+    bool wakeOne();
+
+    // 唤醒所有等待的协程，返回唤醒的个数
+    size_t wakeAll();
+
+private:
+    std::deque<CoWaiter::ptr> waiters_;
+};
+
+// 条件变量，配合CoroutineMutex使用
+class CoCondVar {
+public:
+    CoCondVar() = default;
+    ~CoCondVar() = default;
+
+    // 释放mutex并挂起，被唤醒后重新获取mutex，超时返回false
+    bool wait(CoroutineMutex &mutex, int64_t timeoutMs = 0);
+
+    void notifyOne();
+    void notifyAll();
+
+private:
+    std::mutex mutex_;
+    CoWaitQueue waiters_;
+};
+
+// 计数信号量，释放时直接把许可交给等待的协程
+class CoSemaphore {
+public:
+    explicit CoSemaphore(size_t count = 0) : count_(count) {}
+    ~CoSemaphore() = default;
+
+    // 超时返回false
+    bool acquire(int64_t timeoutMs = 0);
+    bool tryAcquire();
+    void release(size_t count = 1);
+
+private:
+    std::mutex mutex_;
+    size_t count_{0};
+    CoWaitQueue waiters_;
+};
+
+// 读写锁，按申请的顺序获取，有写者在等待时后来的读者也要等待，避免写者饿死
+class CoRWMutex {
+public:
+    typedef ReadScopedLockImpl<CoRWMutex> ReadLock;
+    typedef WriteScopedLockImpl<CoRWMutex> WriteLock;
+
+    CoRWMutex() = default;
+    ~CoRWMutex() = default;
+
+    void rdlock();
+    void wrlock();
+    void unlock();
+
+private:
+    // 把锁交给队列头部的等待者，连续的读者一起唤醒
+    void wakeWaiters();
+
+private:
+    struct RWWaiter {
+        CoWaiter::ptr waiter;
+        bool isWriter;
+    };
+
+    std::mutex mutex_;
+    int readers_{0};
+    bool writer_{false};
+    std::deque<RWWaiter> waiters_;
+};
+
+// 等待一组任务全部完成
+class WaitGroup {
+public:
+    WaitGroup() = default;
+    ~WaitGroup() = default;
+
+    void add(int count = 1);
+    void done();
+
+    // 等待计数归零，超时返回false
+    bool wait(int64_t timeoutMs = 0);
+
+private:
+    std::mutex mutex_;
+    int count_{0};
+    CoWaitQueue waiters_;
+};
+
+// 有界的多生产者多消费者队列，队列满时push挂起，队列空时pop挂起
+// close之后不能再push，pop取完剩余的数据后返回false
+template <class T>
+class CoChannel {
+public:
+    typedef std::shared_ptr<CoChannel<T>> ptr;
+
+    explicit CoChannel(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+    ~CoChannel() = default;
+
+    bool push(const T &value)
+    {
+        CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!closed_ && buffer_.size() >= capacity_) {
+            senders_.push(waiter);
+            lock.unlock();
+            waiter->park();
+            waiter = CoWaiter::currentOrThread();
+            lock.lock();
+        }
+        if (closed_) {
+            return false;
+        }
+        buffer_.push_back(value);
+        receivers_.wakeOne();
+        return true;
+    }
+
+    bool tryPush(const T &value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_ || buffer_.size() >= capacity_) {
+            return false;
+        }
+        buffer_.push_back(value);
+        receivers_.wakeOne();
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        CoWaiter::ptr waiter = CoWaiter::currentOrThread();
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!closed_ && buffer_.empty()) {
+            receivers_.push(waiter);
+            lock.unlock();
+            waiter->park();
+            waiter = CoWaiter::currentOrThread();
+            lock.lock();
+        }
+        if (buffer_.empty()) {
+            return false;
+        }
+        value = buffer_.front();
+        buffer_.pop_front();
+        senders_.wakeOne();
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (buffer_.empty()) {
+            return false;
+        }
+        value = buffer_.front();
+        buffer_.pop_front();
+        senders_.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closed_ = true;
+        senders_.wakeAll();
+        receivers_.wakeAll();
+    }
+
+    size_t size()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return buffer_.size();
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::deque<T> buffer_;
+    bool closed_{false};
+    CoWaitQueue senders_;
+    CoWaitQueue receivers_;
+};
+
+}
+
+#endif
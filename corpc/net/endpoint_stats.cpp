@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "corpc/net/endpoint_stats.h"
+#include "corpc/common/xxhash.h"
+
+namespace corpc {
+
+RWMutex EndpointStatsRegistry::s_mutex;
+std::unordered_map<uint64_t, EndpointStats::ptr> EndpointStatsRegistry::s_stats;
+
+// ewma耗时的上限，us，超过任何合理的rpc超时时间，避免失败惩罚无限放大后溢出
+static const int64_t MAX_EWMA_LATENCY_US = 60LL * 1000 * 1000;
+
+void EndpointStats::onStart()
+{
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EndpointStats::onFinish(int64_t latencyUs, bool success)
+{
+    inflight_.fetch_sub(1, std::memory_order_relaxed);
+    int64_t old = ewmaLatencyUs_.load(std::memory_order_relaxed);
+    latencyUs = std::min(latencyUs, MAX_EWMA_LATENCY_US);
+    if (success) {
+        consecutiveErrors_.store(0, std::memory_order_relaxed);
+        int expected = static_cast<int>(EndpointHealth::HalfOpen);
+        if (health_.compare_exchange_strong(expected, static_cast<int>(EndpointHealth::Closed))) {
+            // 探测成功，节点恢复，之前的耗时统计已经没有参考价值
+            ejectionTimes_.store(0, std::memory_order_relaxed);
+            ewmaLatencyUs_.store(latencyUs > 0 ? latencyUs : 1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    else {
+        consecutiveErrors_.fetch_add(1, std::memory_order_relaxed);
+        // 连接被拒绝之类的失败耗时很短，不能让失败的节点看起来更快，按至少翻倍的耗时计入，不超过上限
+        latencyUs = std::min(std::max(latencyUs, old * 2), MAX_EWMA_LATENCY_US);
+    }
+    // ewma = ewma * 3/4 + latency * 1/4，统计值允许并发更新时丢失少量样本
+    int64_t now = old == 0 ? latencyUs : old + (latencyUs - old) / 4;
+    ewmaLatencyUs_.store(now > 0 ? now : 1, std::memory_order_relaxed);
+}
+
+bool EndpointStats::tryAcquire(int64_t nowMs, int64_t probeTimeoutMs)
+{
+    if (health_.load(std::memory_order_acquire) == static_cast<int>(EndpointHealth::Closed)) {
+        return true;
+    }
+    int64_t until = ejectedUntilMs_.load(std::memory_order_relaxed);
+    if (nowMs < until) {
+        return false;
+    }
+    // 只有CAS成功的调用者去探测，同时把时间推后，探测期间其他调用者不会再选中它
+    if (!ejectedUntilMs_.compare_exchange_strong(until, nowMs + probeTimeoutMs)) {
+        return false;
+    }
+    health_.store(static_cast<int>(EndpointHealth::HalfOpen), std::memory_order_release);
+    return true;
+}
+
+void EndpointStats::eject(int64_t nowMs, int64_t baseEjectionMs, int64_t maxEjectionMs)
+{
+    int times = ejectionTimes_.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t duration = std::min(baseEjectionMs * times, maxEjectionMs);
+    ejectedUntilMs_.store(nowMs + duration, std::memory_order_relaxed);
+    consecutiveErrors_.store(0, std::memory_order_relaxed);
+    health_.store(static_cast<int>(EndpointHealth::Open), std::memory_order_release);
+}
+
+EndpointStats::ptr EndpointStatsRegistry::get(const NetAddress::ptr &addr)
+{
+    uint64_t key = keyOf(addr);
+    RWMutex::ReadLock rlock(s_mutex);
+    auto it = s_stats.find(key);
+    if (it != s_stats.end()) {
+        return it->second;
+    }
+    rlock.unlock();
+
+    RWMutex::WriteLock wlock(s_mutex);
+    EndpointStats::ptr &stats = s_stats[key];
+    if (!stats) {
+        stats = std::make_shared<EndpointStats>();
+    }
+    return stats;
+}
+
+// ipv4地址直接用ip和端口拼成key，不需要构造字符串
+uint64_t EndpointStatsRegistry::keyOf(const NetAddress::ptr &addr)
+{
+    if (addr->getFamily() == AF_INET) {
+        sockaddr_in *sin = reinterpret_cast<sockaddr_in *>(addr->getSockAddr());
+        return ((uint64_t)sin->sin_addr.s_addr << 16) | sin->sin_port;
+    }
+    // 其他类型的地址最高位置1，避免和ipv4的key冲突
+    return xxHash64(addr->toString()) | (1ULL << 63);
+}
+
+}
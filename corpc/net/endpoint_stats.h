@@ -0,0 +1,96 @@
+#ifndef CORPC_NET_ENDPOINT_STATS_H
+#define CORPC_NET_ENDPOINT_STATS_H
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include "corpc/net/net_address.h"
+#include "corpc/net/mutex.h"
+
+namespace corpc {
+
+// 节点的健康状态（熔断器）
+enum class EndpointHealth {
+    // 正常
+    Closed = 0,
+    // 已被摘除，摘除时间到之前不会被选中
+    Open = 1,
+    // 摘除时间已到，只放行一个探测请求，成功则恢复，失败则再次摘除
+    HalfOpen = 2,
+};
+
+// 单个服务节点的调用统计和健康状态，由PbRpcChannel在每次调用时记录，供负载均衡策略和异常检测使用
+class EndpointStats {
+public:
+    typedef std::shared_ptr<EndpointStats> ptr;
+
+    EndpointStats() = default;
+    ~EndpointStats() = default;
+
+    // 发出请求
+    void onStart();
+
+    // 请求结束，latencyUs为本次调用耗时
+    void onFinish(int64_t latencyUs, bool success);
+
+    // 正在进行中的请求数
+    int inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+    // 耗时的指数加权移动平均，us，还没有调用过时为0，最大60s
+    int64_t ewmaLatencyUs() const { return ewmaLatencyUs_.load(std::memory_order_relaxed); }
+
+    // 权重，用于加权轮询，默认为1
+    int weight() const { return weight_.load(std::memory_order_relaxed); }
+    void setWeight(int weight) { weight_.store(weight > 0 ? weight : 1, std::memory_order_relaxed); }
+
+    // 节点支持的pb帧格式版本，服务端在回包中确认之前为1
+    int protoVersion() const { return protoVersion_.load(std::memory_order_relaxed); }
+    void setProtoVersion(int version) { protoVersion_.store(version, std::memory_order_relaxed); }
+    // 节点是否同意v2的包带上crc32c校验
+    bool checksum() const { return checksum_.load(std::memory_order_relaxed); }
+    void setChecksum(bool checksum) { checksum_.store(checksum, std::memory_order_relaxed); }
+    // 节点支持的压缩算法，按CompressType组成的掩码
+    uint64_t compressMask() const { return compressMask_.load(std::memory_order_relaxed); }
+    void setCompressMask(uint64_t mask) { compressMask_.store(mask, std::memory_order_relaxed); }
+
+    EndpointHealth health() const { return static_cast<EndpointHealth>(health_.load(std::memory_order_acquire)); }
+
+    int consecutiveErrors() const { return consecutiveErrors_.load(std::memory_order_relaxed); }
+
+    // 当前是否可以向该节点发请求，摘除时间到了之后只有一个调用者能拿到探测的机会
+    // 探测超过probeTimeoutMs还没有结果时，允许再次探测
+    bool tryAcquire(int64_t nowMs, int64_t probeTimeoutMs);
+
+    // 摘除节点，摘除时长随连续被摘除的次数增加
+    void eject(int64_t nowMs, int64_t baseEjectionMs, int64_t maxEjectionMs);
+
+private:
+    std::atomic<int> inflight_{0};
+    std::atomic<int64_t> ewmaLatencyUs_{0};
+    std::atomic<int> weight_{1};
+    std::atomic<int> protoVersion_{1};
+    std::atomic<bool> checksum_{false};
+    std::atomic<uint64_t> compressMask_{0};
+
+    std::atomic<int> health_{static_cast<int>(EndpointHealth::Closed)};
+    std::atomic<int> consecutiveErrors_{0};
+    // 连续被摘除的次数，恢复后清零
+    std::atomic<int> ejectionTimes_{0};
+    std::atomic<int64_t> ejectedUntilMs_{0};
+};
+
+// 进程内所有节点的统计，多个channel访问同一节点时共享同一份统计
+class EndpointStatsRegistry {
+public:
+    static EndpointStats::ptr get(const NetAddress::ptr &addr);
+
+private:
+    static uint64_t keyOf(const NetAddress::ptr &addr);
+
+    static RWMutex s_mutex;
+    static std::unordered_map<uint64_t, EndpointStats::ptr> s_stats;
+};
+
+}
+
+#endif
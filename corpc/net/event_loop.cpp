@@ -11,6 +11,7 @@
 #include "corpc/net/timer.h"
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/coroutine/coroutine_hook.h"
+#include "corpc/coroutine/coroutine_pool.h"
 
 extern read_fun_ptr_t g_sys_read_fun;   // sys read func
 extern write_fun_ptr_t g_sys_write_fun; // sys write func
@@ -35,13 +36,9 @@ EventLoop::EventLoop()
     LOG_DEBUG << "thread[" << tid_ << "] succ create a loop object";
     tLoopPtr = this;
 
-    if ((epfd_ = epoll_create(1)) <= 0) {
-        LOG_FATAL << "start server error. epoll_create error, sys error=" << strerror(errno);
-    }
-    else {
-        LOG_DEBUG << "epfd_ = " << epfd_;
-    }
-    // assert(epfd_ > 0);
+    reactor_ = Reactor::create(gConfig && gConfig->reactorType == "io_uring");
+    LOG_DEBUG << "thread[" << tid_ << "] use reactor " << reactor_->name();
+    isAffinity_ = gConfig && gConfig->scheduleMode == "affinity";
 
     if ((wakefd_ = eventfd(0, EFD_NONBLOCK)) <= 0) {
         LOG_FATAL << "start server error. event_fd error, sys error=" << strerror(errno);
@@ -54,11 +51,12 @@ EventLoop::EventLoop()
 EventLoop::~EventLoop()
 {
     LOG_DEBUG << "~EventLoop";
-    close(epfd_);
     if (timer_ != nullptr) {
         delete timer_;
         timer_ = nullptr;
     }
+    delete reactor_;
+    reactor_ = nullptr;
     tLoopPtr = nullptr;
 }
 
@@ -139,12 +137,11 @@ bool EventLoop::isLoopThread() const
 
 void EventLoop::addWakeupFd()
 {
-    int op = EPOLL_CTL_ADD;
     epoll_event event;
     event.data.fd = wakefd_;
     event.events = EPOLLIN;
-    if ((epoll_ctl(epfd_, op, wakefd_, &event)) != 0) {
-        LOG_ERROR << "epoo_ctl error, fd[" << wakefd_ << "], errno=" << errno << ", err=" << strerror(errno);
+    if (!reactor_->addEvent(wakefd_, event, false)) {
+        LOG_ERROR << "add wakeup fd[" << wakefd_ << "] error";
     }
     fds_.push_back(wakefd_);
 }
@@ -154,16 +151,13 @@ void EventLoop::addEventInLoopThread(int fd, epoll_event event)
 {
     assert(isLoopThread());
 
-    int op = EPOLL_CTL_ADD;
     bool isAdd = true;
     auto it = find(fds_.begin(), fds_.end(), fd);
     if (it != fds_.end()) {
         isAdd = false;
-        op = EPOLL_CTL_MOD;
     }
 
-    if (epoll_ctl(epfd_, op, fd, &event) != 0) {
-        LOG_ERROR << "epoll_ctl error, fd[" << fd << "], sys errinfo = " << strerror(errno);
+    if (!reactor_->addEvent(fd, event, !isAdd)) {
         return;
     }
     if (isAdd) {
@@ -182,11 +176,7 @@ void EventLoop::delEventInLoopThread(int fd)
         LOG_DEBUG << "fd[" << fd << "] not in this loop";
         return;
     }
-    int op = EPOLL_CTL_DEL;
-
-    if ((epoll_ctl(epfd_, op, fd, nullptr)) != 0) {
-        LOG_ERROR << "epoll_ctl error, fd[" << fd << "], sys errinfo = " << strerror(errno);
-    }
+    reactor_->delEvent(fd);
 
     fds_.erase(it);
     LOG_DEBUG << "del succ, fd[" << fd << "]";
@@ -208,16 +198,14 @@ void EventLoop::loop()
     Coroutine *firstCoroutine = nullptr;
 
     while (!stopFlag_) {
-        const int MAX_EVENTS = 10;
-        epoll_event reEvents[MAX_EVENTS + 1];
-
         if (firstCoroutine) {
             corpc::Coroutine::resume(firstCoroutine);
             firstCoroutine = nullptr;
         }
 
         // main loop need't to resume coroutine in global CoroutineTaskQueue, only io thread do this work
-        if (loopType_ != MainLoop) {
+        // 亲和模式下没有协程会放到CoroutineTaskQueue中，不需要每轮加锁检查
+        if (loopType_ != MainLoop && !isAffinity_) {
             Channel *ptr = nullptr;
             while (true) {
                 ptr = CoroutineTaskQueue::getCoroutineTaskQueue()->pop();
@@ -242,14 +230,12 @@ void EventLoop::loop()
             }
         }
 
-        int ret = epoll_wait(epfd_, reEvents, MAX_EVENTS, tMaxEpollTimeout);
+        // io_uring时直接提交的io在这里完成，对应的协程会在wait中恢复
+        int ret = reactor_->wait(activeEvents_, tMaxEpollTimeout);
 
-        if (ret < 0) {
-            LOG_ERROR << "epoll_wait error, skip, errno=" << strerror(errno);
-        }
-        else {
+        if (ret >= 0) {
             for (int i = 0; i < ret; ++i) {
-                epoll_event oneEvent = reEvents[i];
+                epoll_event oneEvent = activeEvents_[i];
 
                 // 如果是eventfd的读事件，那就是其他线程唤醒了当前线程
                 if (oneEvent.data.fd == wakefd_ && (oneEvent.events & READ)) {
@@ -263,7 +249,20 @@ void EventLoop::loop()
                 }
                 else {
                     Channel *ptr = (Channel*)oneEvent.data.ptr;
-                    if (ptr != nullptr) {
+                    if (ptr != nullptr && ptr->getEdgeLoop() == this) {
+                        // 边缘触发的channel只更新就绪标记，等待的协程直接在当前线程恢复
+                        // 不放到CoroutineTaskQueue中迁移，迁移需要修改注册
+                        Coroutine *readCor = nullptr;
+                        Coroutine *writeCor = nullptr;
+                        ptr->onEdgeEvent(oneEvent.events, readCor, writeCor);
+                        if (readCor) {
+                            corpc::Coroutine::resume(readCor);
+                        }
+                        if (writeCor) {
+                            corpc::Coroutine::resume(writeCor);
+                        }
+                    }
+                    else if (ptr != nullptr) {
                         int fd = ptr->getFd();
 
                         if ((!(oneEvent.events & EPOLLIN)) && (!(oneEvent.events & EPOLLOUT))) {
@@ -279,7 +278,11 @@ void EventLoop::loop()
                                     firstCoroutine = ptr->getCoroutine();
                                     continue;
                                 }
-                                if (loopType_ == SubLoop) {
+                                if (loopType_ == SubLoop && isAffinity_) {
+                                    // 连接的缓冲区和编解码状态一直留在所属线程的cache中，需要迁移时显式调用IOThreadPool::offload
+                                    corpc::Coroutine::resume(ptr->getCoroutine());
+                                }
+                                else if (loopType_ == SubLoop) {
                                     delEventInLoopThread(fd);
                                     ptr->setEventLoop(nullptr);
                                     CoroutineTaskQueue::getCoroutineTaskQueue()->push(ptr);
@@ -382,6 +385,22 @@ void EventLoop::addCoroutine(corpc::Coroutine::ptr cor, bool isWakeup /*=true*/)
     addTask(func, isWakeup);
 }
 
+void EventLoop::runInCoroutine(std::function<void()> cb, bool isWakeup /*=true*/)
+{
+    Coroutine::ptr cor = getCoroutinePool()->getCoroutineInstanse();
+    cor->setCallBack([this, cb, cor]() {
+        cb();
+        // 协程执行完之后才能归还给协程池
+        addTask([cor]() {
+            cor->callback_ = nullptr;
+            cor->setRunTime(nullptr);
+            getCoroutinePool()->returnCoroutine(cor);
+        });
+    });
+    cor->setRunTime(getCurrentRunTimePtr());
+    addCoroutine(cor, isWakeup);
+}
+
 Timer *EventLoop::getTimer()
 {
     if (!timer_) {
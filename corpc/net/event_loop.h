@@ -11,6 +11,7 @@
 #include <mutex>
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/net/channel.h"
+#include "corpc/net/reactor.h"
 
 namespace corpc {
 
@@ -32,10 +33,13 @@ public:
     void addTask(std::function<void()> task, bool isWakeup = true);
     void addTask(std::vector<std::function<void()>> task, bool isWakeup = true);
     void addCoroutine(corpc::Coroutine::ptr cor, bool isWakeup = true);
+    // 在该事件循环的新协程中执行cb，协程继承当前协程的RunTime，执行完之后自动归还给协程池
+    void runInCoroutine(std::function<void()> cb, bool isWakeup = true);
     void wakeup();
     void loop();
     void stop();
     Timer *getTimer();
+    Reactor *getReactor() { return reactor_; }
     pid_t getTid();
     void setEventLoopType(EventLoopType type);
     bool isLooping() const { return isLooping_; }
@@ -50,12 +54,14 @@ private:
     void delEventInLoopThread(int fd);
 
 private:
-    int epfd_{-1};
+    Reactor *reactor_{nullptr};
+    std::vector<epoll_event> activeEvents_;
     int wakefd_{-1};
     int timerfd_{-1};
     bool stopFlag_{false};
     bool isLooping_{false};
     bool isInitTimer_{false};
+    bool isAffinity_{false}; // 协程只在所属的io线程上执行，不通过CoroutineTaskQueue迁移
     pid_t tid_{0};
 
     std::mutex mutex_;
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <cstdlib>
+#include <vector>
 #include <sstream>
 #include "corpc/net/http/http_codec.h"
 #include "corpc/common/log.h"
@@ -7,9 +9,23 @@
 #include "corpc/net/abstract_codec.h"
 #include "corpc/net/http/http_request.h"
 #include "corpc/net/http/http_response.h"
+#include "corpc/common/compress.h"
 
 namespace corpc {
 
+// 解压后的请求体最大长度
+static const size_t MAX_DECOMPRESSED_BODY_SIZE = 64 * 1024 * 1024;
+
+static std::string trimSpace(const std::string &str)
+{
+    size_t begin = str.find_first_not_of(" \t");
+    if (begin == str.npos) {
+        return "";
+    }
+    size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
 HttpCodeC::HttpCodeC()
 {
 }
@@ -25,6 +41,19 @@ void HttpCodeC::encode(TcpBuffer *buf, AbstractData *data)
     HttpResponse *response = dynamic_cast<HttpResponse *>(data);
     response->encodeSucc_ = false;
 
+    if (!response->contentEncoding_.empty()) {
+        Compressor *compressor = Compressor::getByContentEncoding(response->contentEncoding_);
+        std::string body;
+        // 压缩之后没有变小时发送原始数据
+        if (compressor && compressor->compress(response->responseBody_.data(), response->responseBody_.size(), body)
+            && body.size() < response->responseBody_.size()) {
+            response->responseBody_.swap(body);
+            response->responseHeader_.maps_["Content-Encoding"] = response->contentEncoding_;
+            response->responseHeader_.maps_["Content-Length"] = std::to_string(response->responseBody_.size());
+            response->responseHeader_.maps_["Vary"] = "Accept-Encoding";
+        }
+    }
+
     std::stringstream ss;
     ss << response->responseVersion_ << " " << response->responseCode_ << " "
         << response->responseInfo_ << gCRLF
@@ -134,6 +163,29 @@ void HttpCodeC::decode(TcpBuffer *buf, AbstractData *data)
         }
     }
 
+    auto it = request->requestHeader_.maps_.find("Content-Encoding");
+    if (it != request->requestHeader_.maps_.end()) {
+        std::string encoding = trimSpace(it->second);
+        if (!encoding.empty() && encoding != "identity") {
+            // 请求已经从缓冲区中取出，解不出来时也要回复客户端，不支持的压缩格式回复415，数据损坏回复400
+            Compressor *compressor = Compressor::getByContentEncoding(encoding);
+            std::string body;
+            if (!compressor) {
+                LOG_ERROR << "unsupported Content-Encoding of http request: " << encoding;
+                request->decodeErrCode_ = HTTP_UNSUPPORTEDMEDIATYPE;
+                request->requestBody_.clear();
+            }
+            else if (!compressor->decompress(request->requestBody_.data(), request->requestBody_.size(), body, MAX_DECOMPRESSED_BODY_SIZE)) {
+                LOG_ERROR << "decompress http request body error, Content-Encoding: " << encoding;
+                request->decodeErrCode_ = HTTP_BADREQUEST;
+                request->requestBody_.clear();
+            }
+            else {
+                request->requestBody_.swap(body);
+            }
+        }
+    }
+
     request->decodeSucc_ = true;
     data = request;
 
@@ -226,6 +278,33 @@ bool HttpCodeC::parseHttpRequestContent(HttpRequest *requset, const std::string
     return true;
 }
 
+std::string HttpCodeC::selectContentEncoding(const std::string &acceptEncoding)
+{
+    std::vector<std::string> items;
+    StringUtil::splitStrToVector(acceptEncoding, ",", items);
+    for (auto &item : items) {
+        std::string encoding = item;
+        size_t i = encoding.find(';');
+        if (i != encoding.npos) {
+            // q=0表示不接受
+            std::string q = trimSpace(encoding.substr(i + 1));
+            if (q.size() >= 2 && q.substr(0, 2) == "q=" && std::atof(q.c_str() + 2) <= 0) {
+                continue;
+            }
+            encoding = encoding.substr(0, i);
+        }
+        encoding = trimSpace(encoding);
+        std::transform(encoding.begin(), encoding.end(), encoding.begin(), tolower);
+        if (encoding.empty() || encoding == "identity" || encoding == "*") {
+            continue;
+        }
+        if (Compressor::getByContentEncoding(encoding)) {
+            return encoding;
+        }
+    }
+    return "";
+}
+
 ProtocolType HttpCodeC::getProtocolType()
 {
     return Http_Protocol;
@@ -18,6 +18,9 @@ public:
     void decode(TcpBuffer *buf, AbstractData *data) override;
     ProtocolType getProtocolType() override;
 
+    // 从请求的Accept-Encoding中选出支持的压缩算法，都不支持时返回空
+    static std::string selectContentEncoding(const std::string &acceptEncoding);
+
 private:
     bool parseHttpRequestLine(HttpRequest *requset, const std::string &temp);
     bool parseHttpRequestHeader(HttpRequest *requset, const std::string &temp);
@@ -25,9 +25,15 @@ const char *httpCodeToString(const int code)
     case HTTP_NOTFOUND:
         return "Not Found";
 
+    case HTTP_UNSUPPORTEDMEDIATYPE:
+        return "Unsupported Media Type";
+
     case HTTP_INTERNALSERVERERROR:
         return "Internal Server Error";
 
+    case HTTP_SERVICEUNAVAILABLE:
+        return "Service Unavailable";
+
     default:
         return "Unknown code";
     }
@@ -22,7 +22,9 @@ enum HttpCode {
     HTTP_BADREQUEST = 400,
     HTTP_FORBIDDEN = 403,
     HTTP_NOTFOUND = 404,
+    HTTP_UNSUPPORTEDMEDIATYPE = 415,
     HTTP_INTERNALSERVERERROR = 500,
+    HTTP_SERVICEUNAVAILABLE = 503,
 };
 
 const char *httpCodeToString(const int code);
@@ -5,38 +5,82 @@
 #include "corpc/common/log.h"
 #include "corpc/common/msg_seq.h"
 #include "corpc/net/tcp/tcp_connection.h"
+#include "corpc/net/timer.h"
+#include "corpc/net/http/http_codec.h"
+#include "corpc/common/config.h"
 
 namespace corpc {
 
+extern corpc::Config::ptr gConfig;
+
 void HttpDispacther::dispatch(AbstractData *data, const TcpConnection::ptr &conn)
 {
     HttpRequest *request = dynamic_cast<HttpRequest *>(data);
     HttpResponse response;
-    Coroutine::getCurrentCoroutine()->getRunTime()->msgNo_ = MsgSeqUtil::genMsgNumber();
-    setCurrentRunTime(Coroutine::getCurrentCoroutine()->getRunTime());
+    RunTime *runtime = Coroutine::getCurrentCoroutine()->resetRunTime();
+    runtime->msgNo_ = MsgSeqUtil::genMsgNumber();
+
+    LOG_INFO << "begin to dispatch client http request, msgno=" << runtime->msgNo_;
 
-    LOG_INFO << "begin to dispatch client http request, msgno=" << Coroutine::getCurrentCoroutine()->getRunTime()->msgNo_;
+    if (request->decodeErrCode_ != 0) {
+        LOG_ERROR << request->decodeErrCode_ << ", failed to decode http request body, url path{ " << request->requestPath_ << "}, msgno=" << runtime->msgNo_;
+        NotFoundHttpServlet servlet;
+        servlet.setCommParam(request, &response);
+        servlet.handleError(request, &response, request->decodeErrCode_);
+        conn->getCodec()->encode(conn->getOutBuffer(), &response);
+        return;
+    }
 
     std::string urlPath_ = request->requestPath_;
+    std::string clientIP;
+    int64_t startUs = 0;
+    if (limiter_ && !urlPath_.empty()) {
+        clientIP = ConcurrencyLimiter::getClientIP(conn->getPeerAddr());
+        if (!limiter_->onRequest(urlPath_, clientIP)) {
+            // 拒绝日志由limiter按间隔汇总
+            LOG_DEBUG << "503, server overloaded, url path{ " << urlPath_ << "}, msgno=" << runtime->msgNo_;
+            NotFoundHttpServlet servlet;
+            servlet.setCommParam(request, &response);
+            servlet.handleOverloaded(request, &response);
+            conn->getCodec()->encode(conn->getOutBuffer(), &response);
+            return;
+        }
+        startUs = getNowUs();
+    }
+
     if (!urlPath_.empty()) {
         auto it = servlets_.find(urlPath_);
         if (it == servlets_.end()) {
-            LOG_ERROR << "404, url path{ " << urlPath_ << "}, msgno=" << Coroutine::getCurrentCoroutine()->getRunTime()->msgNo_;
+            LOG_ERROR << "404, url path{ " << urlPath_ << "}, msgno=" << runtime->msgNo_;
             NotFoundHttpServlet servlet;
-            Coroutine::getCurrentCoroutine()->getRunTime()->interfaceName_ = servlet.getServletName();
+            runtime->interfaceName_ = servlet.getServletName();
             servlet.setCommParam(request, &response);
             servlet.handle(request, &response);
         }
         else {
-            Coroutine::getCurrentCoroutine()->getRunTime()->interfaceName_ = it->second->getServletName();
+            runtime->interfaceName_ = it->second->getServletName();
             it->second->setCommParam(request, &response);
             it->second->handle(request, &response);
         }
     }
 
+    if (startUs > 0) {
+        limiter_->onFinish(urlPath_, clientIP, getNowUs() - startUs, response.responseCode_ == HTTP_OK);
+    }
+
+    // 响应体足够大并且客户端接受压缩时压缩，可以按路径关闭，业务自己设置了Content-Encoding时不再压缩
+    auto acceptIt = request->requestHeader_.maps_.find("Accept-Encoding");
+    if (acceptIt != request->requestHeader_.maps_.end() && (int)response.responseBody_.size() >= gConfig->compressMinSize
+        && response.responseHeader_.maps_.find("Content-Encoding") == response.responseHeader_.maps_.end()) {
+        auto it = gConfig->compressMethods.find(urlPath_);
+        if (it == gConfig->compressMethods.end() || it->second != "none") {
+            response.contentEncoding_ = HttpCodeC::selectContentEncoding(acceptIt->second);
+        }
+    }
+
     conn->getCodec()->encode(conn->getOutBuffer(), &response);
 
-    LOG_INFO << "end dispatch client http request, msgno=" << Coroutine::getCurrentCoroutine()->getRunTime()->msgNo_;
+    LOG_INFO << "end dispatch client http request, msgno=" << runtime->msgNo_;
 }
 
 void HttpDispacther::registerServlet(const std::string &path, HttpServlet::ptr servlet)
@@ -23,6 +23,9 @@ public:
     std::string requestBody_;
 
     std::map<std::string, std::string> queryMaps_;
+
+    // 请求已经完整收到但是不能处理时的http状态码，比如请求体的压缩格式不支持或者解压失败，由dispatcher直接回复
+    int decodeErrCode_{0};
 };
 
 }
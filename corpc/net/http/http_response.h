@@ -19,6 +19,8 @@ public:
     std::string responseInfo_;
     HttpResponseHeader responseHeader_;
     std::string responseBody_;
+    // 编码时用这个Content-Encoding压缩响应体，为空时不压缩
+    std::string contentEncoding_;
 };
 
 }
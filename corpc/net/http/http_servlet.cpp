@@ -32,6 +32,26 @@ void HttpServlet::handleNotFound(HttpRequest *req, HttpResponse *res)
     setHttpBody(res, std::string(buf));
 }
 
+void HttpServlet::handleOverloaded(HttpRequest *req, HttpResponse *res)
+{
+    LOG_DEBUG << "return 503 html";
+    setHttpCode(res, HTTP_SERVICEUNAVAILABLE);
+    char buf[1024] = {0};
+    sprintf(buf, defaultHtmlTemplate, std::to_string(HTTP_SERVICEUNAVAILABLE).c_str(), httpCodeToString(HTTP_SERVICEUNAVAILABLE));
+    setHttpContentType(res, contentTypeText);
+    setHttpBody(res, std::string(buf));
+}
+
+void HttpServlet::handleError(HttpRequest *req, HttpResponse *res, const int code)
+{
+    LOG_DEBUG << "return " << code << " html";
+    setHttpCode(res, code);
+    char buf[1024] = {0};
+    sprintf(buf, defaultHtmlTemplate, std::to_string(code).c_str(), httpCodeToString(code));
+    setHttpContentType(res, contentTypeText);
+    setHttpBody(res, std::string(buf));
+}
+
 void HttpServlet::setHttpCode(HttpResponse *res, const int code)
 {
     res->responseCode_ = code;
@@ -17,6 +17,9 @@ public:
     virtual void handle(HttpRequest *req, HttpResponse *res) = 0;
     virtual std::string getServletName() = 0;
     void handleNotFound(HttpRequest *req, HttpResponse *res);
+    void handleOverloaded(HttpRequest *req, HttpResponse *res);
+    // 请求本身有问题时回复对应的错误码，比如400、415
+    void handleError(HttpRequest *req, HttpResponse *res, const int code);
     void setHttpCode(HttpResponse *res, const int code);
     void setHttpContentType(HttpResponse *res, const std::string &contentType);
     void setHttpBody(HttpResponse *res, const std::string &body);
@@ -0,0 +1,410 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/time_types.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include "corpc/net/io_uring_reactor.h"
+#include "corpc/coroutine/coroutine.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+IoUringReactor::~IoUringReactor()
+{
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_) {
+        munmap(sqRing_, sqRingSize_);
+    }
+    if (ringFd_ != -1) {
+        close(ringFd_);
+    }
+}
+
+bool IoUringReactor::init(unsigned entries/* = 256*/)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if (ringFd_ < 0) {
+        ringFd_ = -1;
+        LOG_WARN << "io_uring_setup error, sys error=" << strerror(errno);
+        return false;
+    }
+    // 等待时的超时参数需要IORING_FEAT_EXT_ARG（5.11）
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        LOG_WARN << "io_uring of this kernel doesn't support IORING_FEAT_EXT_ARG";
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    void *ptr = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) {
+        LOG_WARN << "mmap io_uring sq ring error, sys error=" << strerror(errno);
+        return false;
+    }
+    sqRing_ = ptr;
+    if (singleMmap) {
+        cqRing_ = sqRing_;
+    }
+    else {
+        ptr = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (ptr == MAP_FAILED) {
+            LOG_WARN << "mmap io_uring cq ring error, sys error=" << strerror(errno);
+            return false;
+        }
+        cqRing_ = ptr;
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    ptr = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+        LOG_WARN << "mmap io_uring sqes error, sys error=" << strerror(errno);
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(ptr);
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    if (!probe()) {
+        return false;
+    }
+
+    LOG_DEBUG << "io_uring reactor init succ, fd=" << ringFd_ << ", sq entries=" << params.sq_entries << ", cq entries=" << params.cq_entries << ", direct io=" << directIO_;
+    return true;
+}
+
+io_uring_sqe *IoUringReactor::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_) {
+        enter(0, 0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= sqEntries_) {
+            LOG_ERROR << "io_uring submission queue is full";
+            return nullptr;
+        }
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    sqLocalTail_++;
+    return sqe;
+}
+
+int IoUringReactor::enter(unsigned minComplete, int timeoutMs)
+{
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (toSubmit == 0 && minComplete == 0) {
+        return 0;
+    }
+
+    unsigned flags = 0;
+    void *arg = nullptr;
+    size_t argSize = 0;
+    __kernel_timespec ts;
+    io_uring_getevents_arg eventsArg;
+    if (minComplete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+            memset(&eventsArg, 0, sizeof(eventsArg));
+            eventsArg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &eventsArg;
+            argSize = sizeof(eventsArg);
+        }
+    }
+    int ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        LOG_ERROR << "io_uring_enter error, sys error=" << strerror(errno);
+    }
+    return ret;
+}
+
+bool IoUringReactor::probe()
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) != 0) {
+        LOG_WARN << "io_uring probe socketpair error, sys error=" << strerror(errno);
+        return false;
+    }
+    // 版本号为0的poll请求不会对应任何注册，之后收到的完成事件都会被wait忽略
+    uint64_t recvData = pollUserData(sv[0], 0);
+    uint64_t pollData = pollUserData(sv[1], 0);
+    // recv没有完成时可能在返回之后才写入，不能使用栈上的缓冲区
+    static char buf = 0;
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sv[0];
+    sqe->addr = reinterpret_cast<uint64_t>(&buf);
+    sqe->len = 1;
+    sqe->user_data = recvData;
+    sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = sv[1];
+    sqe->poll32_events = EPOLLIN | EPOLLET;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = pollData;
+    enter(0, 0);
+    // 先提交再写入数据，recv被挂起等待时才能收到数据
+    write(sv[1], "x", 1);
+    write(sv[0], "x", 1);
+
+    int recvRes = 1;
+    int pollRes = 0;
+    bool hasMore = false;
+    bool recvDone = false;
+    bool pollDone = false;
+    for (int i = 0; i < 3 && !(recvDone && pollDone); ++i) {
+        enter(1, 100);
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            io_uring_cqe &cqe = cqes_[head & cqMask_];
+            if (cqe.user_data == recvData) {
+                recvDone = true;
+                recvRes = cqe.res;
+            }
+            else if (cqe.user_data == pollData) {
+                pollDone = true;
+                pollRes = cqe.res;
+                hasMore = cqe.flags & IORING_CQE_F_MORE;
+            }
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+
+    sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = pollData;
+    sqe->user_data = 0;
+    if (!recvDone) {
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = recvData;
+        sqe->user_data = 0;
+    }
+    enter(0, 0);
+    close(sv[0]);
+    close(sv[1]);
+
+    if (!pollDone || pollRes < 0 || !hasMore) {
+        // 5.13之前的内核不支持多路poll，单次poll每次重新注册时会丢掉边缘触发的语义
+        LOG_WARN << "io_uring of this kernel doesn't support multishot poll, result=" << pollRes;
+        return false;
+    }
+    if (recvRes == -EAGAIN) {
+        LOG_WARN << "io_uring of this kernel returns EAGAIN for nonblocking sockets, don't submit io directly";
+        directIO_ = false;
+    }
+    return true;
+}
+
+void IoUringReactor::armPoll(int fd, PollEntry &entry)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe) {
+        entry.active = false;
+        return;
+    }
+    entry.gen++;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // 边缘触发的channel只在状态变化时返回事件，和epoll一致
+    sqe->poll32_events = entry.event.events & (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET);
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = pollUserData(fd, entry.gen);
+}
+
+void IoUringReactor::removePoll(int fd, PollEntry &entry)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe) {
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = pollUserData(fd, entry.gen);
+        sqe->user_data = 0;
+    }
+    // 之后收到的旧版本的事件都会被忽略
+    entry.gen++;
+    entry.active = false;
+}
+
+bool IoUringReactor::addEvent(int fd, epoll_event event, bool isMod)
+{
+    if (fd >= static_cast<int>(polls_.size())) {
+        polls_.resize(fd + 1);
+    }
+    PollEntry &entry = polls_[fd];
+    if (entry.active) {
+        removePoll(fd, entry);
+    }
+    entry.event = event;
+    entry.active = true;
+    armPoll(fd, entry);
+    return entry.active;
+}
+
+bool IoUringReactor::delEvent(int fd)
+{
+    if (fd < static_cast<int>(notSocket_.size())) {
+        notSocket_[fd] = false;
+    }
+    if (fd >= static_cast<int>(polls_.size()) || !polls_[fd].active) {
+        return false;
+    }
+    removePoll(fd, polls_[fd]);
+    return true;
+}
+
+int IoUringReactor::wait(std::vector<epoll_event> &events, int timeoutMs)
+{
+    events.clear();
+    int ret = enter(1, timeoutMs);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        return -1;
+    }
+
+    // 先把完成事件全部取出来，恢复的协程可能会提交新的请求
+    reaped_.clear();
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        reaped_.push_back(cqes_[head & cqMask_]);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    finished_.clear();
+    for (auto &cqe : reaped_) {
+        if (cqe.user_data == 0) {
+            continue;
+        }
+        if (!(cqe.user_data & 1)) {
+            IoOp *op = reinterpret_cast<IoOp*>(cqe.user_data);
+            op->res = cqe.res;
+            op->done = true;
+            finished_.push_back(op);
+            continue;
+        }
+
+        int fd = static_cast<int>((cqe.user_data & 0xffffffff) >> 1);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32);
+        if (fd >= static_cast<int>(polls_.size())) {
+            continue;
+        }
+        PollEntry &entry = polls_[fd];
+        if (!entry.active || entry.gen != gen) {
+            continue;
+        }
+        if (cqe.res < 0) {
+            LOG_ERROR << "io_uring poll fd[" << fd << "] error, sys error=" << strerror(-cqe.res);
+            entry.active = false;
+            continue;
+        }
+        epoll_event event;
+        event.events = cqe.res;
+        event.data = entry.event.data;
+        events.push_back(event);
+        // 内核结束了多路poll（比如完成队列溢出）时重新注册
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            armPoll(fd, entry);
+        }
+    }
+
+    for (auto op : finished_) {
+        Coroutine::resume(op->cor);
+    }
+    return events.size();
+}
+
+bool IoUringReactor::submitIO(IoOp &op)
+{
+    if (Coroutine::isMainCoroutine() || !directIO_) {
+        return false;
+    }
+    if (op.fd < static_cast<int>(notSocket_.size()) && notSocket_[op.fd]) {
+        return false;
+    }
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->fd = op.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(op.buf);
+    sqe->len = op.len;
+    switch (op.type) {
+    case IoOp::Recv:
+        sqe->opcode = IORING_OP_RECV;
+        sqe->msg_flags = op.flags;
+        break;
+    case IoOp::Send:
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = op.flags;
+        break;
+    case IoOp::Accept:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = reinterpret_cast<uint64_t>(op.addr);
+        sqe->addr2 = reinterpret_cast<uint64_t>(op.addrlen);
+        sqe->len = 0;
+        sqe->accept_flags = op.flags;
+        break;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(&op);
+    op.cor = Coroutine::getCurrentCoroutine();
+    op.done = false;
+
+    bool isCanceled = false;
+    while (!op.done) {
+        Coroutine::yield();
+        if (op.done || isCanceled) {
+            continue;
+        }
+        // 被提前唤醒，内核可能还在使用缓冲区，取消之后等待完成事件
+        io_uring_sqe *cancel = getSqe();
+        if (cancel) {
+            cancel->opcode = IORING_OP_ASYNC_CANCEL;
+            cancel->addr = reinterpret_cast<uint64_t>(&op);
+            cancel->user_data = 0;
+            isCanceled = true;
+        }
+    }
+    if (op.res == -ENOTSOCK) {
+        if (op.fd >= static_cast<int>(notSocket_.size())) {
+            notSocket_.resize(op.fd + 1);
+        }
+        notSocket_[op.fd] = true;
+    }
+    else if (op.type == IoOp::Accept && op.res >= 0 && op.res < static_cast<int>(notSocket_.size())) {
+        notSocket_[op.res] = false;
+    }
+    return true;
+}
+
+}
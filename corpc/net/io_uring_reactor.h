@@ -0,0 +1,79 @@
+#ifndef CORPC_NET_IO_URING_REACTOR_H
+#define CORPC_NET_IO_URING_REACTOR_H
+
+#include <linux/io_uring.h>
+#include <vector>
+#include "corpc/net/reactor.h"
+
+namespace corpc {
+
+// 基于io_uring的reactor，不依赖liburing，直接使用系统调用和共享的环形队列
+// 1. fd的就绪事件使用多路的poll请求（IORING_POLL_ADD_MULTI），注册一次持续返回事件，保留EPOLLET
+// 2. 协程的读写和accept直接提交给内核，完成后唤醒协程，不需要先注册事件再重新发起系统调用
+// 创建时探测一次内核的行为：不支持边缘触发的多路poll时创建失败，对非阻塞的fd直接返回EAGAIN时不直接提交io
+// 一轮事件循环中产生的所有请求在下一次io_uring_enter中一起提交，同时等待完成事件
+class IoUringReactor : public Reactor {
+public:
+    IoUringReactor() = default;
+    ~IoUringReactor();
+
+    // 内核不支持时返回false
+    bool init(unsigned entries = 256);
+
+    bool addEvent(int fd, epoll_event event, bool isMod) override;
+    bool delEvent(int fd) override;
+    int wait(std::vector<epoll_event> &events, int timeoutMs) override;
+    bool submitIO(IoOp &op) override;
+    const char *name() const override { return "io_uring"; }
+
+private:
+    struct PollEntry {
+        bool active{false};
+        uint32_t gen{0};
+        epoll_event event;
+    };
+
+    // 队列满时先提交已有的请求
+    io_uring_sqe *getSqe();
+    // 提交请求，minComplete > 0 时最多等待timeoutMs
+    int enter(unsigned minComplete, int timeoutMs);
+    void armPoll(int fd, PollEntry &entry);
+    void removePoll(int fd, PollEntry &entry);
+    // 用一对socket探测多路poll和直接提交的recv，不支持多路poll时返回false
+    bool probe();
+
+    // user_data的最低位为1时是poll请求，编码了fd和版本号，为0时忽略，其他情况为IoOp的地址
+    static uint64_t pollUserData(int fd, uint32_t gen) { return (static_cast<uint64_t>(gen) << 32) | (static_cast<uint64_t>(fd) << 1) | 1; }
+
+private:
+    int ringFd_{-1};
+    bool directIO_{true}; // 内核对非阻塞的fd直接返回EAGAIN时为false，每次直接提交都会多一次往返
+
+    void *sqRing_{nullptr};
+    size_t sqRingSize_{0};
+    void *cqRing_{nullptr};
+    size_t cqRingSize_{0};
+    io_uring_sqe *sqes_{nullptr};
+    size_t sqesSize_{0};
+
+    unsigned *sqHead_{nullptr};
+    unsigned *sqTail_{nullptr};
+    unsigned *sqArray_{nullptr};
+    unsigned sqMask_{0};
+    unsigned sqEntries_{0};
+    unsigned sqLocalTail_{0}; // 还没有提交给内核的尾部
+
+    unsigned *cqHead_{nullptr};
+    unsigned *cqTail_{nullptr};
+    unsigned cqMask_{0};
+    io_uring_cqe *cqes_{nullptr};
+
+    std::vector<PollEntry> polls_; // 以fd为下标
+    std::vector<bool> notSocket_;  // 以fd为下标，返回过ENOTSOCK的fd不再直接提交，fd被删除或者被accept复用时清除
+    std::vector<io_uring_cqe> reaped_;
+    std::vector<IoOp*> finished_;
+};
+
+}
+
+#endif
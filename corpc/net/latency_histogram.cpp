@@ -0,0 +1,84 @@
+#include "corpc/net/latency_histogram.h"
+
+namespace corpc {
+
+RWMutex LatencyHistogram::s_mutex;
+std::unordered_map<std::string, LatencyHistogram::ptr> LatencyHistogram::s_histograms;
+
+// 桶号 = 最高位 * 4 + 最高位之后的两位，小于4us的耗时直接用耗时做桶号
+int LatencyHistogram::bucketOf(int64_t latencyUs)
+{
+    if (latencyUs < 4) {
+        return latencyUs > 0 ? (int)latencyUs : 0;
+    }
+    int msb = 63 - __builtin_clzll((uint64_t)latencyUs);
+    int bucket = msb * 4 + (int)((latencyUs >> (msb - 2)) & 3);
+    return bucket < BUCKET_NUM ? bucket : BUCKET_NUM - 1;
+}
+
+int64_t LatencyHistogram::upperBoundOf(int bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+    int msb = bucket / 4;
+    int64_t base = 1LL << msb;
+    return base + (base >> 2) * (bucket % 4 + 1);
+}
+
+void LatencyHistogram::record(int64_t latencyUs)
+{
+    buckets_[bucketOf(latencyUs)].fetch_add(1, std::memory_order_relaxed);
+    if (count_.fetch_add(1, std::memory_order_relaxed) + 1 < MAX_SAMPLES) {
+        return;
+    }
+    // 衰减，并发记录时丢失少量样本不影响分位数
+    int64_t total = 0;
+    for (int i = 0; i < BUCKET_NUM; ++i) {
+        int64_t half = buckets_[i].load(std::memory_order_relaxed) / 2;
+        buckets_[i].store(half, std::memory_order_relaxed);
+        total += half;
+    }
+    count_.store(total, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::percentile(double p, int64_t minSamples/* = 20*/) const
+{
+    int64_t counts[BUCKET_NUM];
+    int64_t total = 0;
+    for (int i = 0; i < BUCKET_NUM; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0 || total < minSamples) {
+        return 0;
+    }
+    int64_t target = (int64_t)(total * p);
+    int64_t sum = 0;
+    for (int i = 0; i < BUCKET_NUM; ++i) {
+        sum += counts[i];
+        if (sum > target) {
+            return upperBoundOf(i);
+        }
+    }
+    return upperBoundOf(BUCKET_NUM - 1);
+}
+
+LatencyHistogram::ptr LatencyHistogram::get(const std::string &name)
+{
+    RWMutex::ReadLock rlock(s_mutex);
+    auto it = s_histograms.find(name);
+    if (it != s_histograms.end()) {
+        return it->second;
+    }
+    rlock.unlock();
+
+    RWMutex::WriteLock wlock(s_mutex);
+    LatencyHistogram::ptr &histogram = s_histograms[name];
+    if (!histogram) {
+        histogram = std::make_shared<LatencyHistogram>();
+    }
+    return histogram;
+}
+
+}
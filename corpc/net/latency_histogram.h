@@ -0,0 +1,46 @@
+#ifndef CORPC_NET_LATENCY_HISTOGRAM_H
+#define CORPC_NET_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "corpc/net/mutex.h"
+
+namespace corpc {
+
+// 耗时直方图，按对数分桶（每个2的幂区间分4个桶，误差不超过19%），只用原子计数，记录时不加锁
+// 样本数达到上限后所有桶减半，让分位数跟上耗时的变化
+class LatencyHistogram {
+public:
+    typedef std::shared_ptr<LatencyHistogram> ptr;
+
+    LatencyHistogram() = default;
+    ~LatencyHistogram() = default;
+
+    void record(int64_t latencyUs);
+
+    // 返回分位数对应的耗时（所在桶的上界），us，样本数少于minSamples时返回0
+    int64_t percentile(double p, int64_t minSamples = 20) const;
+
+    // 按调用的方法名获取共享的直方图
+    static LatencyHistogram::ptr get(const std::string &name);
+
+private:
+    static int bucketOf(int64_t latencyUs);
+    static int64_t upperBoundOf(int bucket);
+
+private:
+    static const int BUCKET_NUM = 4 * 40;
+    static const int64_t MAX_SAMPLES = 1 << 16;
+
+    std::atomic<int64_t> buckets_[BUCKET_NUM]{};
+    std::atomic<int64_t> count_{0};
+
+    static RWMutex s_mutex;
+    static std::unordered_map<std::string, LatencyHistogram::ptr> s_histograms;
+};
+
+}
+
+#endif
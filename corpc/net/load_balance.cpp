@@ -1,12 +1,391 @@
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <random>
+#include <thread>
 #include "corpc/net/load_balance.h"
+#include "corpc/common/xxhash.h"
 
 namespace corpc {
 
 LoadBalanceStrategy::ptr LoadBalance::s_randomStrategy = std::make_shared<RandomLoadBalanceStrategy>();
 LoadBalanceStrategy::ptr LoadBalance::s_RoundStrategy = std::make_shared<RoundLoadBalanceStrategy>();
 LoadBalanceStrategy::ptr LoadBalance::s_consistentHashStrategy = std::make_shared<ConsistentHashLoadBalanceStrategy>();
+LoadBalanceStrategy::ptr LoadBalance::s_leastOutstandingStrategy = std::make_shared<LeastOutstandingLoadBalanceStrategy>();
+LoadBalanceStrategy::ptr LoadBalance::s_p2cStrategy = std::make_shared<P2CLoadBalanceStrategy>();
+LoadBalanceStrategy::ptr LoadBalance::s_weightedRoundStrategy = std::make_shared<WeightedRoundLoadBalanceStrategy>();
+
+size_t RandomLoadBalanceStrategy::randomIndex(size_t n)
+{
+    static thread_local std::mt19937 engine(std::random_device{}() ^ std::hash<std::thread::id>()(std::this_thread::get_id()));
+    return engine() % n;
+}
+
+EndpointStatsState::EndpointStatsState(const std::vector<NetAddress::ptr> &addrs)
+{
+    stats.reserve(addrs.size());
+    for (const auto &addr : addrs) {
+        stats[addr.get()] = EndpointStatsRegistry::get(addr);
+    }
+}
+
+EndpointStats *EndpointStatsState::get(const NetAddress::ptr &addr) const
+{
+    auto it = stats.find(addr.get());
+    if (it != stats.end()) {
+        return it->second.get();
+    }
+    // 全局的统计表不会删除节点，返回的指针一直有效
+    return EndpointStatsRegistry::get(addr).get();
+}
+
+// state为空（没有prepare的数据）时查全局的统计表
+static EndpointStats *statsOf(const EndpointStatsState *state, const NetAddress::ptr &addr)
+{
+    return state ? state->get(addr) : EndpointStatsRegistry::get(addr).get();
+}
+
+NetAddress::ptr LeastOutstandingLoadBalanceStrategy::select(std::vector<NetAddress::ptr> &addrs, const PbStruct &)
+{
+    return selectWithStats(nullptr, addrs);
+}
+
+LoadBalanceState::ptr LeastOutstandingLoadBalanceStrategy::prepare(const std::vector<NetAddress::ptr> &addrs)
+{
+    return std::make_shared<EndpointStatsState>(addrs);
+}
+
+NetAddress::ptr LeastOutstandingLoadBalanceStrategy::selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &)
+{
+    return selectWithStats(dynamic_cast<const EndpointStatsState *>(state.get()), addrs);
+}
+
+NetAddress::ptr LeastOutstandingLoadBalanceStrategy::selectWithStats(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs)
+{
+    size_t n = addrs.size();
+    size_t start = RandomLoadBalanceStrategy::randomIndex(n);
+    size_t best = start;
+    int bestInflight = statsOf(state, addrs[start])->inflight();
+    for (size_t i = 1; i < n && bestInflight > 0; i++) {
+        size_t index = (start + i) % n;
+        int inflight = statsOf(state, addrs[index])->inflight();
+        if (inflight < bestInflight) {
+            best = index;
+            bestInflight = inflight;
+        }
+    }
+    return addrs[best];
+}
+
+NetAddress::ptr P2CLoadBalanceStrategy::select(std::vector<NetAddress::ptr> &addrs, const PbStruct &)
+{
+    return selectWithStats(nullptr, addrs);
+}
+
+LoadBalanceState::ptr P2CLoadBalanceStrategy::prepare(const std::vector<NetAddress::ptr> &addrs)
+{
+    return std::make_shared<EndpointStatsState>(addrs);
+}
+
+NetAddress::ptr P2CLoadBalanceStrategy::selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &)
+{
+    return selectWithStats(dynamic_cast<const EndpointStatsState *>(state.get()), addrs);
+}
+
+NetAddress::ptr P2CLoadBalanceStrategy::selectWithStats(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs)
+{
+    size_t n = addrs.size();
+    if (n == 1) {
+        return addrs[0];
+    }
+    size_t a = RandomLoadBalanceStrategy::randomIndex(n);
+    size_t b = RandomLoadBalanceStrategy::randomIndex(n - 1);
+    if (b >= a) {
+        b++; // 保证两次选到不同的节点
+    }
+    EndpointStats *statsA = statsOf(state, addrs[a]);
+    EndpointStats *statsB = statsOf(state, addrs[b]);
+    int64_t costA = statsA->ewmaLatencyUs() * (statsA->inflight() + 1);
+    int64_t costB = statsB->ewmaLatencyUs() * (statsB->inflight() + 1);
+    return costA <= costB ? addrs[a] : addrs[b];
+}
+
+NetAddress::ptr WeightedRoundLoadBalanceStrategy::select(std::vector<NetAddress::ptr> &addrs, const PbStruct &)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    NetAddress::ptr addr = selectByWeight(nullptr, addrs, currentWeights_);
+    // 地址集合变小了，去掉已经不在其中的节点
+    if (currentWeights_.size() > addrs.size()) {
+        std::unordered_map<EndpointStats *, int> weights;
+        for (const auto &i : addrs) {
+            EndpointStats *stats = statsOf(nullptr, i);
+            weights[stats] = currentWeights_[stats];
+        }
+        currentWeights_.swap(weights);
+    }
+    return addr;
+}
+
+LoadBalanceState::ptr WeightedRoundLoadBalanceStrategy::prepare(const std::vector<NetAddress::ptr> &addrs)
+{
+    return std::make_shared<State>(addrs);
+}
+
+NetAddress::ptr WeightedRoundLoadBalanceStrategy::selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation)
+{
+    const State *weighted = dynamic_cast<const State *>(state.get());
+    if (!weighted) {
+        return select(addrs, invocation);
+    }
+    std::lock_guard<std::mutex> lock(weighted->mutex);
+    return selectByWeight(weighted, addrs, weighted->currentWeights);
+}
+
+NetAddress::ptr WeightedRoundLoadBalanceStrategy::selectByWeight(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs, std::unordered_map<EndpointStats *, int> &currentWeights)
+{
+    if (addrs.empty()) {
+        return nullptr;
+    }
+    // 每次所有节点的当前权重加上各自的权重，选出当前权重最大的节点，再减去总权重
+    int total = 0;
+    size_t best = 0;
+    int bestWeight = 0;
+    int *bestCurrent = nullptr;
+    for (size_t i = 0; i < addrs.size(); i++) {
+        EndpointStats *stats = statsOf(state, addrs[i]);
+        int weight = stats->weight();
+        int &current = currentWeights[stats];
+        current += weight;
+        total += weight;
+        if (i == 0 || current > bestWeight) {
+            best = i;
+            bestWeight = current;
+            bestCurrent = &current;
+        }
+    }
+    *bestCurrent -= total;
+    return addrs[best];
+}
+
+// 缓存的地址集合数量上限，超过之后清空重新构建，避免地址不断变化时无限增长
+static const size_t MAX_CACHED_RINGS = 64;
+
+ConsistentHashLoadBalanceStrategy::ConsistentHashLoadBalanceStrategy() : extractor_(methodAndBodyKey()), replicaNumber_(160) {}
+
+ConsistentHashLoadBalanceStrategy::ConsistentHashLoadBalanceStrategy(KeyExtractor extractor, int replicaNumber/* = 160*/)
+    : extractor_(extractor), replicaNumber_(replicaNumber) {}
+
+NetAddress::ptr ConsistentHashLoadBalanceStrategy::select(std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation)
+{
+    if (addrs.empty()) {
+        return nullptr;
+    }
+    return selectInRing(*getRing(addrs), addrs, invocation);
+}
+
+LoadBalanceState::ptr ConsistentHashLoadBalanceStrategy::prepare(const std::vector<NetAddress::ptr> &addrs)
+{
+    return getRing(addrs);
+}
+
+NetAddress::ptr ConsistentHashLoadBalanceStrategy::selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation)
+{
+    if (addrs.empty()) {
+        return nullptr;
+    }
+    const Ring *ring = dynamic_cast<const Ring *>(state.get());
+    if (!ring) {
+        return select(addrs, invocation);
+    }
+    return selectInRing(*ring, addrs, invocation);
+}
+
+NetAddress::ptr ConsistentHashLoadBalanceStrategy::selectInRing(const Ring &ring, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation)
+{
+    // 虚拟节点数不大于0时没有环，退化为随机
+    if (ring.points.empty()) {
+        return addrs[RandomLoadBalanceStrategy::randomIndex(addrs.size())];
+    }
+
+    // 标记可选节点在环中的下标，所有节点都可选时不需要标记
+    std::vector<bool> available;
+    if (addrs.size() != ring.addrs.size()) {
+        available.resize(ring.addrs.size(), false);
+        bool found = false;
+        for (const auto &addr : addrs) {
+            auto it = ring.indexes.find(addr->toString());
+            if (it != ring.indexes.end()) {
+                available[it->second] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            // 可选节点都不在环中（环已经过期），用这些节点自己的环，新环包含所有可选节点，不会再走到这里
+            return selectInRing(*getRing(addrs), addrs, invocation);
+        }
+    }
+
+    uint64_t key = extractor_(invocation);
+    auto it = std::lower_bound(ring.points.begin(), ring.points.end(), std::make_pair(key, (uint32_t)0));
+    for (size_t i = 0; i < ring.points.size(); i++, it++) {
+        if (it == ring.points.end()) {
+            it = ring.points.begin();
+        }
+        if (available.empty() || available[it->second]) {
+            return ring.addrs[it->second];
+        }
+    }
+    return addrs[0];
+}
+
+std::shared_ptr<const ConsistentHashLoadBalanceStrategy::Ring> ConsistentHashLoadBalanceStrategy::getRing(const std::vector<NetAddress::ptr> &addrs)
+{
+    // 地址集合与顺序无关，排序之后计算哈希值
+    std::vector<std::string> names;
+    names.reserve(addrs.size());
+    for (const auto &addr : addrs) {
+        names.push_back(addr->toString());
+    }
+    std::sort(names.begin(), names.end());
+    uint64_t hash = 0;
+    for (const auto &name : names) {
+        hash = xxHash64(name.data(), name.size(), hash);
+    }
+
+    std::unique_lock<std::mutex> lock(ringsMutex_);
+    auto it = rings_.find(hash);
+    if (it != rings_.end() && it->second->addrs.size() == names.size()) {
+        bool same = true;
+        for (const auto &name : names) {
+            if (it->second->indexes.find(name) == it->second->indexes.end()) {
+                same = false;
+                break;
+            }
+        }
+        if (same) {
+            return it->second;
+        }
+    }
+    lock.unlock();
+
+    // 构建不在锁内进行，并发构建同一个环时后放入的覆盖先放入的，结果相同
+    std::shared_ptr<const Ring> ring = buildRing(addrs);
+    lock.lock();
+    if (rings_.size() >= MAX_CACHED_RINGS) {
+        rings_.clear();
+    }
+    rings_[hash] = ring;
+    return ring;
+}
+
+std::shared_ptr<const ConsistentHashLoadBalanceStrategy::Ring> ConsistentHashLoadBalanceStrategy::buildRing(const std::vector<NetAddress::ptr> &addrs) const
+{
+    std::shared_ptr<Ring> ring = std::make_shared<Ring>();
+    ring->addrs = addrs;
+    ring->points.reserve(addrs.size() * std::max(replicaNumber_, 0));
+    for (uint32_t i = 0; i < addrs.size(); i++) {
+        // 每个实际节点扩展为replicaNumber_个虚拟节点
+        std::string addr = addrs[i]->toString();
+        ring->indexes[addr] = i;
+        uint64_t seed = xxHash64(addr);
+        for (int j = 0; j < replicaNumber_; j++) {
+            ring->points.push_back(std::make_pair(xxHash64(&j, sizeof(j), seed), i));
+        }
+    }
+    std::sort(ring->points.begin(), ring->points.end());
+    return ring;
+}
+
+ConsistentHashLoadBalanceStrategy::KeyExtractor ConsistentHashLoadBalanceStrategy::methodAndBodyKey()
+{
+    return [](const PbStruct &invocation) {
+        uint64_t seed = xxHash64(invocation.serviceFullName);
+        return xxHash64(invocation.pbData.data(), invocation.pbData.size(), seed);
+    };
+}
+
+ConsistentHashLoadBalanceStrategy::KeyExtractor ConsistentHashLoadBalanceStrategy::methodAndPrefixKey(size_t prefixLen/* = 64*/)
+{
+    return [prefixLen](const PbStruct &invocation) {
+        uint64_t seed = xxHash64(invocation.serviceFullName);
+        return xxHash64(invocation.pbData.data(), std::min(prefixLen, invocation.pbData.size()), seed);
+    };
+}
+
+// 读取varint，失败返回false
+static bool readVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 在序列化后的protobuf数据中查找最外层的某个字段，返回字段值的原始字节
+static bool findPbField(const std::string &data, int fieldNumber, const uint8_t *&valueBegin, size_t &valueLen)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data());
+    const uint8_t *end = p + data.size();
+    while (p < end) {
+        uint64_t tag;
+        if (!readVarint(p, end, tag)) {
+            return false;
+        }
+        int number = tag >> 3;
+        int wireType = tag & 0x7;
+        const uint8_t *begin = p;
+        uint64_t len = 0;
+        switch (wireType) {
+            case 0: // varint
+                if (!readVarint(p, end, len)) {
+                    return false;
+                }
+                break;
+            case 1: // fixed64
+                p += 8;
+                break;
+            case 2: // length-delimited
+                if (!readVarint(p, end, len) || len > (uint64_t)(end - p)) {
+                    return false;
+                }
+                begin = p;
+                p += len;
+                break;
+            case 5: // fixed32
+                p += 4;
+                break;
+            default: // group等已废弃的类型不支持
+                return false;
+        }
+        if (p > end) {
+            return false;
+        }
+        if (number == fieldNumber) {
+            valueBegin = begin;
+            valueLen = p - begin;
+            return true;
+        }
+    }
+    return false;
+}
+
+ConsistentHashLoadBalanceStrategy::KeyExtractor ConsistentHashLoadBalanceStrategy::fieldKey(int fieldNumber)
+{
+    return [fieldNumber](const PbStruct &invocation) {
+        uint64_t seed = xxHash64(invocation.serviceFullName);
+        const uint8_t *value = nullptr;
+        size_t len = 0;
+        if (!findPbField(invocation.pbData, fieldNumber, value, len)) {
+            return seed;
+        }
+        return xxHash64(value, len, seed);
+    };
+}
 
 LoadBalanceStrategy::ptr LoadBalance::queryStrategy(LoadBalanceCategory category)
 {
@@ -17,6 +396,12 @@ LoadBalanceStrategy::ptr LoadBalance::queryStrategy(LoadBalanceCategory category
             return s_RoundStrategy;
         case LoadBalanceCategory::ConsistentHash:
             return s_consistentHashStrategy;
+        case LoadBalanceCategory::LeastOutstanding:
+            return s_leastOutstandingStrategy;
+        case LoadBalanceCategory::P2C:
+            return s_p2cStrategy;
+        case LoadBalanceCategory::WeightedRound:
+            return s_weightedRoundStrategy;
         default:
             return s_randomStrategy;
     }
@@ -31,6 +416,12 @@ std::string LoadBalance::strategy2Str(LoadBalanceCategory category)
             return "Round";
         case LoadBalanceCategory::ConsistentHash:
             return "ConsistentHash";
+        case LoadBalanceCategory::LeastOutstanding:
+            return "LeastOutstanding";
+        case LoadBalanceCategory::P2C:
+            return "P2C";
+        case LoadBalanceCategory::WeightedRound:
+            return "WeightedRound";
         default:
             return "Random";
     }
@@ -44,6 +435,12 @@ LoadBalanceCategory LoadBalance::str2Strategy(const std::string &str)
         return LoadBalanceCategory::Round;
     else if (strTemp == "consistenthash")
         return LoadBalanceCategory::ConsistentHash;
+    else if (strTemp == "leastoutstanding")
+        return LoadBalanceCategory::LeastOutstanding;
+    else if (strTemp == "p2c")
+        return LoadBalanceCategory::P2C;
+    else if (strTemp == "weightedround")
+        return LoadBalanceCategory::WeightedRound;
     return LoadBalanceCategory::Random;
 }
 
@@ -2,20 +2,36 @@
 #define CORPC_NET_LOAD_BALANCE_H
 
 #include <memory>
-#include <ctime>
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <map>
+#include <functional>
 #include <iostream>
-#include "corpc/common/md5.h"
 #include "corpc/common/const.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/pb/pb_data.h"
+#include "corpc/net/endpoint_stats.h"
 
 namespace corpc {
 
+// 负载均衡器针对某个地址集合预先计算的数据（比如一致性哈希环），地址集合变化时由调用方重新构建
+struct LoadBalanceState {
+    typedef std::shared_ptr<const LoadBalanceState> ptr;
+    virtual ~LoadBalanceState() {}
+};
+
+// 地址集合中各节点的统计，prepare时取出，选择时不需要每次都查全局的统计表（要加读锁）
+struct EndpointStatsState : public LoadBalanceState {
+    explicit EndpointStatsState(const std::vector<NetAddress::ptr> &addrs);
+
+    // 可选节点来自prepare时的地址集合，按地址对象查找，找不到时查全局的统计表
+    EndpointStats *get(const NetAddress::ptr &addr) const;
+
+    std::unordered_map<const NetAddress *, EndpointStats::ptr> stats;
+};
+
 class LoadBalanceStrategy {
 public:
     using ptr = std::shared_ptr<LoadBalanceStrategy>;
@@ -23,119 +39,132 @@ public:
 
     // 选择节点（一致性哈希需要用到请求的服务名和参数信息，其他方法不需要）
     virtual NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation) = 0;
+
+    // 地址集合变化时调用一次，返回的数据在selectPrepared时传回，默认不需要预先计算
+    virtual LoadBalanceState::ptr prepare(const std::vector<NetAddress::ptr> &addrs) { return nullptr; }
+
+    // addrs为prepare时的地址集合中当前可选的节点（已去掉摘除和排除的节点）
+    virtual NetAddress::ptr selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation) {
+        return select(addrs, invocation);
+    }
 };
 
 // 随机策略
 class RandomLoadBalanceStrategy : public LoadBalanceStrategy {
 public:
     NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &) {
-        srand((unsigned)time(nullptr));
-        return addrs[rand() % addrs.size()];
+        return addrs[randomIndex(addrs.size())];
     }
+
+    // 每个线程独立的随机数引擎，不需要每次都重新设置种子
+    static size_t randomIndex(size_t n);
 };
 
 // 轮询策略
 class RoundLoadBalanceStrategy : public LoadBalanceStrategy {
 public:
     NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &) {
-        // 由于涉及到多个不同的线程操作下标index_，因此需要加锁
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (index_ >= (int)addrs.size()) {
-            index_ = 0;
-        }
-        return addrs[index_++];
+        // 多个线程共用下标，用原子变量代替加锁
+        return addrs[index_.fetch_add(1, std::memory_order_relaxed) % addrs.size()];
     }
 private:
-    int index_ = 0;
+    std::atomic<size_t> index_{0};
+};
+
+// 最少未完成请求：选择当前进行中的请求最少的节点，相同时从随机位置开始选，避免都打到第一个节点上
+class LeastOutstandingLoadBalanceStrategy : public LoadBalanceStrategy {
+public:
+    NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+    LoadBalanceState::ptr prepare(const std::vector<NetAddress::ptr> &addrs);
+    NetAddress::ptr selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+private:
+    // state为空时查全局的统计表
+    NetAddress::ptr selectWithStats(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs);
+};
+
+// 两次随机选择（power of two choices）：随机选两个节点，选 ewma耗时 * (进行中的请求数 + 1) 较小的那个
+// 还没有统计数据的节点耗时为0，会被优先选到，相当于探测新节点
+class P2CLoadBalanceStrategy : public LoadBalanceStrategy {
+public:
+    NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+    LoadBalanceState::ptr prepare(const std::vector<NetAddress::ptr> &addrs);
+    NetAddress::ptr selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+private:
+    NetAddress::ptr selectWithStats(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs);
+};
+
+// 平滑加权轮询（同nginx），权重通过 EndpointStatsRegistry::get(addr)->setWeight() 设置
+// 各节点当前的权重放在prepare的数据中，地址集合变化时随之重建，不会保留已经删除的节点
+class WeightedRoundLoadBalanceStrategy : public LoadBalanceStrategy {
+public:
+    NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+    LoadBalanceState::ptr prepare(const std::vector<NetAddress::ptr> &addrs);
+    NetAddress::ptr selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &);
+private:
+    struct State : public EndpointStatsState {
+        explicit State(const std::vector<NetAddress::ptr> &addrs) : EndpointStatsState(addrs) {}
+        mutable std::mutex mutex;
+        mutable std::unordered_map<EndpointStats *, int> currentWeights;
+    };
+
+    // 调用方持有mutex
+    static NetAddress::ptr selectByWeight(const EndpointStatsState *state, std::vector<NetAddress::ptr> &addrs, std::unordered_map<EndpointStats *, int> &currentWeights);
+
+    // 没有prepare的数据时使用，传入的地址集合变化时去掉其中没有的节点
     std::mutex mutex_;
+    std::unordered_map<EndpointStats *, int> currentWeights_;
 };
 
 // 一致性哈希
+// 哈希环在地址集合变化时通过prepare构建成有序数组，查找时二分，之后顺时针跳过不可选的节点
+// 这样节点被摘除或者重试排除节点时不需要重新构建，其余key的落点也不变
+// 相同地址集合的环只构建一次，每次调用都新建的通道也共用同一个环
 class ConsistentHashLoadBalanceStrategy : public LoadBalanceStrategy {
 public:
-    NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation) {
-        size_t identityHashCode = hashCode(addrs);
-        std::lock_guard<std::mutex> lock(mutex_); // C++的map不是线程安全的
-
-        size_t index = invocation.serviceFullName.find('.');
-        std::string serviceName = invocation.serviceFullName.substr(0, index);
-        std::string methodName = invocation.serviceFullName.substr(index);
-
-        auto it = selectors_.find(serviceName); // 对每个服务创建一个选择器
-        std::shared_ptr<ConsistentHashSelector> selector;
-        // check for updates
-        // 检查invokers列表是否扩容或者缩容，如果不存在对应选择器，或者出现了扩缩容（会导致服务器列表的hash值不一致）则初始化选择器
-        if (it == selectors_.end() || it->second->identityHashCode != identityHashCode) {
-            selectors_[serviceName] = std::make_shared<ConsistentHashSelector>(addrs, 160, identityHashCode);
-            selector = selectors_[serviceName];
-        }
-        else {
-            selector = it->second;
-        }
-        return selector->select(methodName + invocation.pbData); // 同一个方法和参数，请求会打到同一个虚拟节点上
-    }
+    // 从请求中提取用于选择节点的哈希值，相同的值总是落到同一个节点上
+    typedef std::function<uint64_t(const PbStruct &invocation)> KeyExtractor;
+
+    ConsistentHashLoadBalanceStrategy();
+    ConsistentHashLoadBalanceStrategy(KeyExtractor extractor, int replicaNumber = 160);
+
+    // 没有预先构建的环时使用该地址集合缓存的环，addrs为空时返回nullptr
+    NetAddress::ptr select(std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation);
+
+    LoadBalanceState::ptr prepare(const std::vector<NetAddress::ptr> &addrs);
+
+    NetAddress::ptr selectPrepared(const LoadBalanceState::ptr &state, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation);
+
+    // 默认的key：方法名 + 整个请求体，同一个方法和参数的请求总是落到同一个节点上
+    static KeyExtractor methodAndBodyKey();
+
+    // 方法名 + 请求体的前prefixLen个字节，开销与请求大小无关，需要显式指定
+    // 前缀相同而后面不同的请求会落到同一个节点上，只适合key在请求体开头的场景
+    static KeyExtractor methodAndPrefixKey(size_t prefixLen = 64);
+
+    // 方法名 + 请求中某个字段（protobuf的字段编号）的原始值，只扫描到该字段为止，不需要反序列化
+    // 找不到该字段时只使用方法名
+    static KeyExtractor fieldKey(int fieldNumber);
+
 private:
-    class ConsistentHashSelector {
-    public:
-        ConsistentHashSelector(std::vector<NetAddress::ptr> &invokers, int replicaNumber, int identityHashCode) : identityHashCode(identityHashCode) {
-            // 创建ConsistentHashSelector时会生成所有虚拟节点，
-            for (const auto &invoker : invokers) {
-                // 每个实际节点扩展为160个虚拟节点，每4个为一组
-                for (int i = 0; i < replicaNumber / 4; i++) {
-                    // 同组的虚拟节点的md5相同
-                    std::vector<uint8_t> digest = md5(invoker->toString() + std::to_string(i));
-                    // 根据md5算法为每4个结点生成一个消息摘要，摘要长为16字节128位。 md5就是一个长16字节占128位的bit数组
-                    // md5共16字节，这一个组里的每个虚拟节点占用生成的md5数组中的4个字节
-                    for (int h = 0; h < 4; h++) {
-                        // hash运算，分别对0—3,4—7,8—11,12—15的字节进行位运算。
-                        size_t m = hash(digest, h);
-                        virtualInvokers[m] = invoker;
-                    }
-                }
-            }
-        }
-
-        std::map<size_t, NetAddress::ptr> virtualInvokers;
-        const size_t identityHashCode;
-
-        static size_t hash(const std::vector<uint8_t> &digest, int number) {
-            return (((size_t) (digest[3 + number * 4] & 0xFF) << 24)
-                    | ((size_t) (digest[2 + number * 4] & 0xFF) << 16)
-                    | ((size_t) (digest[1 + number * 4] & 0xFF) << 8)
-                    | (digest[number * 4] & 0xFF))
-                    & 0xFFFFFFFFL;
-        }
-
-        static std::vector<uint8_t> md5(const std::string &key) {
-            MD5 obj;
-            return obj.digest(key);
-        }
-
-        NetAddress::ptr select(const std::string &rpcServiceKey) {
-            std::vector<uint8_t> digest = md5(rpcServiceKey);
-            return selectForKey(hash(digest, 0));
-        }
-
-        NetAddress::ptr selectForKey(size_t hashCode) {
-            auto it = virtualInvokers.lower_bound(hashCode);
-            if (it == virtualInvokers.end()) {
-                it = virtualInvokers.begin();
-            }
-            return it->second;
-        }
+    struct Ring : public LoadBalanceState {
+        std::vector<NetAddress::ptr> addrs;
+        // 按地址字符串查找下标，不同通道里的地址对象不同，但是地址相同
+        std::unordered_map<std::string, uint32_t> indexes;
+        // 虚拟节点，按哈希值有序，second为addrs中的下标
+        std::vector<std::pair<uint64_t, uint32_t>> points;
     };
 
-    // 计算vector的hashCode
-    size_t hashCode(const std::vector<NetAddress::ptr> &addrs) {
-        size_t result = 1;
-        for (auto & item : addrs) {
-            result = 31 * result + std::hash<std::string>()(item->toString());
-        }
-        return result;
-    }
+    // 返回该地址集合的环，缓存中没有时构建并放入缓存
+    std::shared_ptr<const Ring> getRing(const std::vector<NetAddress::ptr> &addrs);
+    std::shared_ptr<const Ring> buildRing(const std::vector<NetAddress::ptr> &addrs) const;
+    NetAddress::ptr selectInRing(const Ring &ring, std::vector<NetAddress::ptr> &addrs, const PbStruct &invocation);
 
-    std::unordered_map<std::string, std::shared_ptr<ConsistentHashSelector>> selectors_;
-    std::mutex mutex_;
+    KeyExtractor extractor_;
+    int replicaNumber_;
+
+    // 地址集合的哈希值 -> 环，只在地址集合变化（prepare）或者没有预先构建的环时访问
+    std::mutex ringsMutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<const Ring>> rings_;
 };
 
 class LoadBalance {
@@ -147,6 +176,9 @@ private:
     static LoadBalanceStrategy::ptr s_randomStrategy;
     static LoadBalanceStrategy::ptr s_RoundStrategy;
     static LoadBalanceStrategy::ptr s_consistentHashStrategy;
+    static LoadBalanceStrategy::ptr s_leastOutstandingStrategy;
+    static LoadBalanceStrategy::ptr s_p2cStrategy;
+    static LoadBalanceStrategy::ptr s_weightedRoundStrategy;
 };
 
 }
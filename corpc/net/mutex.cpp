@@ -1,16 +1,117 @@
 #include <pthread.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <memory>
 #include "corpc/net/mutex.h"
+#include "corpc/net/coroutine_sync.h"
 #include "corpc/net/event_loop.h"
 #include "corpc/common/log.h"
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/coroutine/coroutine_hook.h"
+#include "corpc/net/timer.h"
 
 // this file copy form sylar
 
 namespace corpc {
 
-CoroutineMutex::CoroutineMutex() {}
+// 进入futex等待前的自旋次数
+static const int FUTEX_SPIN_TIMES = 200;
+
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// *addr等于expected时睡眠，直到被唤醒或超时，timeoutMs < 0 时不超时
+static void futexWait(std::atomic<int> *addr, int expected, int64_t timeoutMs)
+{
+    timespec ts;
+    timespec *pts = nullptr;
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000;
+        pts = &ts;
+    }
+    syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAIT_PRIVATE, expected, pts, nullptr, 0);
+}
+
+static void futexWake(std::atomic<int> *addr, int count)
+{
+    syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+void FutexSemaphore::post()
+{
+    count_.fetch_add(1);
+    if (waiters_.load() > 0) {
+        futexWake(&count_, 1);
+    }
+}
+
+bool FutexSemaphore::tryWait()
+{
+    int count = count_.load();
+    while (count > 0) {
+        if (count_.compare_exchange_weak(count, count - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FutexSemaphore::wait()
+{
+    for (int i = 0; i < FUTEX_SPIN_TIMES; ++i) {
+        if (tryWait()) {
+            return;
+        }
+        cpuRelax();
+    }
+    waiters_.fetch_add(1);
+    while (!tryWait()) {
+        futexWait(&count_, 0, -1);
+    }
+    waiters_.fetch_sub(1);
+}
+
+void FutexEvent::set()
+{
+    flag_.store(1);
+    if (waiters_.load() > 0) {
+        futexWake(&flag_, INT_MAX);
+    }
+}
+
+bool FutexEvent::wait(int64_t timeoutMs/* = 0*/)
+{
+    for (int i = 0; i < FUTEX_SPIN_TIMES; ++i) {
+        if (isSet()) {
+            return true;
+        }
+        cpuRelax();
+    }
+    int64_t deadline = timeoutMs > 0 ? getNowMs() + timeoutMs : 0;
+    waiters_.fetch_add(1);
+    while (!isSet()) {
+        int64_t rest = -1;
+        if (deadline > 0) {
+            rest = deadline - getNowMs();
+            if (rest <= 0) {
+                break;
+            }
+        }
+        futexWait(&flag_, 0, rest);
+    }
+    waiters_.fetch_sub(1);
+    return isSet();
+}
+
+CoroutineMutex::CoroutineMutex() : sleepCors_(new CoWaitQueue()) {}
 
 CoroutineMutex::~CoroutineMutex()
 {
@@ -26,24 +127,19 @@ void CoroutineMutex::lock()
         return;
     }
 
-    Coroutine *cor = Coroutine::getCurrentCoroutine();
-
     std::unique_lock<std::mutex> lock(mutex_);
     if (!lock_) {
         lock_ = true;
         LOG_DEBUG << "coroutine succ get coroutine mutex";
-        lock.unlock();
+        return;
     }
-    else {
-        sleepCors_.push(cor);
-        auto temp = sleepCors_;
-        lock.unlock();
-
-        LOG_DEBUG << "coroutine yield, pending coroutine mutex, current sleep queue exist ["
-                    << temp.size() << "] coroutines";
+    CoWaiter::ptr waiter = CoWaiter::current();
+    sleepCors_->push(waiter);
+    lock.unlock();
 
-        Coroutine::yield();
-    }
+    LOG_DEBUG << "coroutine yield, pending coroutine mutex";
+    // 被唤醒时unlock已经把锁直接交给了当前协程
+    waiter->park();
 }
 
 void CoroutineMutex::unlock()
@@ -54,22 +150,12 @@ void CoroutineMutex::unlock()
     }
 
     std::unique_lock<std::mutex> lock(mutex_);
-    if (lock_) {
+    if (!lock_) {
+        return;
+    }
+    // 有等待的协程时锁不释放，直接交给队列头部的协程，在它自己的io线程中唤醒
+    if (!sleepCors_->wakeOne()) {
         lock_ = false;
-        if (sleepCors_.empty()) {
-            return;
-        }
-
-        Coroutine *cor = sleepCors_.front();
-        sleepCors_.pop();
-        lock.unlock();
-
-        if (cor) {
-            // wakeup the first cor in sleep queue
-            LOG_DEBUG << "coroutine unlock, now to resume coroutine[" << cor->getCorId() << "]";
-
-            corpc::EventLoop::getEventLoop()->addTask([cor]() { corpc::Coroutine::resume(cor); }, true);
-        }
     }
 }
 
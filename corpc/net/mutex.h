@@ -5,6 +5,8 @@
 #include <memory>
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 
 // this file copy form sylar
 
@@ -145,7 +147,41 @@ private:
     pthread_rwlock_t lock_;
 };
 
-class Coroutine;
+// 基于futex的计数信号量，用于线程之间等待
+// 等待前先自旋一小段时间，结果很快就绪时不需要陷入内核，也不会发生线程切换
+class FutexSemaphore {
+public:
+    FutexSemaphore() = default;
+    ~FutexSemaphore() = default;
+
+    void post();
+    void wait();
+    bool tryWait();
+
+private:
+    std::atomic<int> count_{0};
+    std::atomic<int> waiters_{0};
+};
+
+// 基于futex的一次性事件，set之后所有的等待者都会返回
+class FutexEvent {
+public:
+    FutexEvent() = default;
+    ~FutexEvent() = default;
+
+    void set();
+    void reset() { flag_.store(0, std::memory_order_release); }
+    bool isSet() const { return flag_.load(std::memory_order_acquire) != 0; }
+
+    // timeoutMs <= 0 时一直等待，超时返回false
+    bool wait(int64_t timeoutMs = 0);
+
+private:
+    std::atomic<int> flag_{0};
+    std::atomic<int> waiters_{0};
+};
+
+class CoWaitQueue;
 
 class CoroutineMutex {
 public:
@@ -159,7 +195,7 @@ public:
 private:
     bool lock_{false};
     std::mutex mutex_;
-    std::queue<Coroutine*> sleepCors_;
+    std::unique_ptr<CoWaitQueue> sleepCors_;
 };
 
 }
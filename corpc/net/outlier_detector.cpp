@@ -0,0 +1,183 @@
+#include <algorithm>
+#include "corpc/net/outlier_detector.h"
+#include "corpc/net/timer.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+std::shared_ptr<const OutlierDetectionOptions> OutlierDetector::s_options = std::make_shared<OutlierDetectionOptions>();
+
+RWMutex RetryBudget::s_mutex;
+std::unordered_map<std::string, RetryBudget::ptr> RetryBudget::s_budgets;
+
+static bool contains(const std::vector<NetAddress::ptr> &addrs, const NetAddress::ptr &addr)
+{
+    for (const auto &item : addrs) {
+        if (item.get() == addr.get()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OutlierDetector::setOptions(const OutlierDetectionOptions &options)
+{
+    std::atomic_store(&s_options, std::shared_ptr<const OutlierDetectionOptions>(std::make_shared<OutlierDetectionOptions>(options)));
+}
+
+OutlierDetectionOptions OutlierDetector::getOptions()
+{
+    return *loadOptions();
+}
+
+std::shared_ptr<const OutlierDetectionOptions> OutlierDetector::loadOptions()
+{
+    return std::atomic_load(&s_options);
+}
+
+void OutlierDetector::record(const NetAddress::ptr &addr, const EndpointStats::ptr &stats, int64_t latencyUs, bool success)
+{
+    bool probing = stats->health() == EndpointHealth::HalfOpen;
+    stats->onFinish(latencyUs, success);
+    if (success) {
+        return;
+    }
+    std::shared_ptr<const OutlierDetectionOptions> options = loadOptions();
+    if (probing || stats->consecutiveErrors() >= options->consecutiveErrors) {
+        stats->eject(getNowMs(), options->baseEjectionMs, options->maxEjectionMs);
+        LOG_WARN << "endpoint " << addr->toString() << " ejected because of " << (probing ? "probe failure" : "consecutive errors");
+    }
+}
+
+NetAddress::ptr OutlierDetector::pickProbe(const std::vector<NetAddress::ptr> &addrs, const std::vector<NetAddress::ptr> &excluded)
+{
+    std::shared_ptr<const OutlierDetectionOptions> options = loadOptions();
+    int64_t now = getNowMs();
+    for (const auto &addr : addrs) {
+        EndpointStats::ptr stats = EndpointStatsRegistry::get(addr);
+        if (stats->health() != EndpointHealth::Closed && !contains(excluded, addr)
+                && stats->tryAcquire(now, options->maxEjectionMs)) {
+            LOG_INFO << "probe ejected endpoint " << addr->toString();
+            return addr;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<NetAddress::ptr> OutlierDetector::filter(const std::vector<NetAddress::ptr> &addrs, const std::vector<NetAddress::ptr> &excluded)
+{
+    std::shared_ptr<const OutlierDetectionOptions> options = loadOptions();
+    int64_t now = getNowMs();
+
+    std::vector<EndpointStats::ptr> stats;
+    stats.reserve(addrs.size());
+    int ejected = 0;
+    int hosts = 0;
+    int64_t sum = 0;
+    for (const auto &addr : addrs) {
+        stats.push_back(EndpointStatsRegistry::get(addr));
+        if (stats.back()->health() != EndpointHealth::Closed) {
+            ejected++;
+        }
+        else if (stats.back()->ewmaLatencyUs() > 0) {
+            hosts++;
+            sum += stats.back()->ewmaLatencyUs();
+        }
+    }
+
+    // 耗时异常检测：和其余节点的平均耗时比较
+    if (hosts >= options->minLatencyHosts) {
+        for (size_t i = 0; i < addrs.size(); i++) {
+            if ((ejected + 1) * 100 > options->maxEjectionPercent * (int)addrs.size()) {
+                break;
+            }
+            int64_t latency = stats[i]->ewmaLatencyUs();
+            if (stats[i]->health() != EndpointHealth::Closed || latency < options->minOutlierLatencyUs) {
+                continue;
+            }
+            double othersMean = (double)(sum - latency) / (hosts - 1);
+            if (latency > othersMean * options->latencyFactor) {
+                stats[i]->eject(now, options->baseEjectionMs, options->maxEjectionMs);
+                ejected++;
+                LOG_WARN << "endpoint " << addrs[i]->toString() << " ejected because of latency outlier, ewma="
+                    << latency << "us, others mean=" << (int64_t)othersMean << "us";
+            }
+        }
+    }
+
+    std::vector<NetAddress::ptr> healthy;
+    std::vector<NetAddress::ptr> notExcluded;
+    for (size_t i = 0; i < addrs.size(); i++) {
+        if (contains(excluded, addrs[i])) {
+            continue;
+        }
+        notExcluded.push_back(addrs[i]);
+        if (stats[i]->health() == EndpointHealth::Closed) {
+            healthy.push_back(addrs[i]);
+        }
+    }
+    if (!healthy.empty()) {
+        return healthy;
+    }
+    if (!notExcluded.empty()) {
+        return notExcluded;
+    }
+    return addrs;
+}
+
+RetryBudget::RetryBudget(double ratio/* = 0.1*/, int minRetriesPerSecond/* = 10*/, int maxRetries/* = 100*/)
+    : depositPerRequest_((int64_t)(ratio * 1000)), minRetriesPerSecond_(minRetriesPerSecond),
+    maxBalance_((int64_t)maxRetries * 1000), balance_(minRetriesPerSecond_ * 1000), lastRefillMs_(getNowMs()) {}
+
+void RetryBudget::onRequest()
+{
+    int64_t balance = balance_.fetch_add(depositPerRequest_, std::memory_order_relaxed) + depositPerRequest_;
+    if (balance > maxBalance_) {
+        balance_.store(maxBalance_, std::memory_order_relaxed);
+    }
+}
+
+bool RetryBudget::tryRetry()
+{
+    refill();
+    int64_t balance = balance_.load(std::memory_order_relaxed);
+    while (balance >= 1000) {
+        if (balance_.compare_exchange_weak(balance, balance - 1000, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RetryBudget::refill()
+{
+    int64_t now = getNowMs();
+    int64_t last = lastRefillMs_.load(std::memory_order_relaxed);
+    int64_t tokens = (now - last) * minRetriesPerSecond_; // (now - last) / 1000 * minRetriesPerSecond_ * 1000
+    if (tokens < 1000 || !lastRefillMs_.compare_exchange_strong(last, now)) {
+        return;
+    }
+    int64_t balance = balance_.fetch_add(tokens, std::memory_order_relaxed) + tokens;
+    if (balance > maxBalance_) {
+        balance_.store(maxBalance_, std::memory_order_relaxed);
+    }
+}
+
+RetryBudget::ptr RetryBudget::get(const std::string &name)
+{
+    RWMutex::ReadLock rlock(s_mutex);
+    auto it = s_budgets.find(name);
+    if (it != s_budgets.end()) {
+        return it->second;
+    }
+    rlock.unlock();
+
+    RWMutex::WriteLock wlock(s_mutex);
+    RetryBudget::ptr &budget = s_budgets[name];
+    if (!budget) {
+        budget = std::make_shared<RetryBudget>();
+    }
+    return budget;
+}
+
+}
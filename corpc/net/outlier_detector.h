@@ -0,0 +1,88 @@
+#ifndef CORPC_NET_OUTLIER_DETECTOR_H
+#define CORPC_NET_OUTLIER_DETECTOR_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "corpc/net/net_address.h"
+#include "corpc/net/endpoint_stats.h"
+#include "corpc/net/mutex.h"
+
+namespace corpc {
+
+struct OutlierDetectionOptions {
+    // 连续失败多少次后摘除节点
+    int consecutiveErrors{5};
+    // 第n次连续被摘除时，摘除 n * baseEjectionMs，最多 maxEjectionMs
+    int64_t baseEjectionMs{1000};
+    int64_t maxEjectionMs{30000};
+    // ewma耗时超过其余节点平均值的多少倍时认为是耗时异常
+    double latencyFactor{3.0};
+    // ewma耗时低于该值时不认为是耗时异常，us
+    int64_t minOutlierLatencyUs{10000};
+    // 至少有多少个节点有统计数据时才做耗时异常检测
+    int minLatencyHosts{3};
+    // 最多摘除节点的比例（百分比），避免部分故障时把所有流量压到剩下的少数节点上
+    int maxEjectionPercent{50};
+};
+
+// 节点异常检测，进程内所有channel共享节点的健康状态
+class OutlierDetector {
+public:
+    static void setOptions(const OutlierDetectionOptions &options);
+    static OutlierDetectionOptions getOptions();
+
+    // 记录一次调用结果，连续失败或探测失败时摘除节点
+    static void record(const NetAddress::ptr &addr, const EndpointStats::ptr &stats, int64_t latencyUs, bool success);
+
+    // 选出摘除时间已到、需要探测的节点，拿到探测机会时返回该节点，否则返回nullptr
+    static NetAddress::ptr pickProbe(const std::vector<NetAddress::ptr> &addrs, const std::vector<NetAddress::ptr> &excluded);
+
+    // 返回可用的节点（排除掉已摘除的节点和excluded中的节点），同时检测耗时异常的节点
+    // 可用的节点为空时依次退化为：未排除的所有节点、所有节点
+    static std::vector<NetAddress::ptr> filter(const std::vector<NetAddress::ptr> &addrs, const std::vector<NetAddress::ptr> &excluded);
+
+private:
+    // 配置整体替换，读取时不需要加锁和拷贝
+    static std::shared_ptr<const OutlierDetectionOptions> loadOptions();
+
+    static std::shared_ptr<const OutlierDetectionOptions> s_options;
+};
+
+// 重试预算：每个请求存入ratio个令牌，每次重试消耗一个令牌，保证重试量不超过正常流量的一定比例
+// 另外每秒补充minRetriesPerSecond个令牌，保证低流量时也能重试
+class RetryBudget {
+public:
+    typedef std::shared_ptr<RetryBudget> ptr;
+
+    RetryBudget(double ratio = 0.1, int minRetriesPerSecond = 10, int maxRetries = 100);
+    ~RetryBudget() = default;
+
+    void onRequest();
+
+    // 是否允许重试，允许时扣除令牌
+    bool tryRetry();
+
+    // 按调用的方法名获取共享的预算
+    static RetryBudget::ptr get(const std::string &name);
+
+private:
+    void refill();
+
+private:
+    // 令牌以千分之一为单位
+    const int64_t depositPerRequest_;
+    const int64_t minRetriesPerSecond_;
+    const int64_t maxBalance_;
+    std::atomic<int64_t> balance_;
+    std::atomic<int64_t> lastRefillMs_;
+
+    static RWMutex s_mutex;
+    static std::unordered_map<std::string, RetryBudget::ptr> s_budgets;
+};
+
+}
+
+#endif
@@ -9,13 +9,175 @@
 #include "corpc/net/abstract_data.h"
 #include "corpc/net/pb/pb_data.h"
 #include "corpc/common/msg_seq.h"
+#include "corpc/common/crc32c.h"
+#include "corpc/common/compress.h"
+#include "corpc/common/config.h"
+#include "corpc/common/error_code.h"
+#include "corpc/net/pb/pb_rpc_dispatcher.h"
 
 namespace corpc {
 
+extern corpc::Config::ptr gConfig;
+
 static const char PB_START = 0x02; // start char
 static const char PB_END = 0x03;   // end char
 static const int MSG_REQ_LEN = 20; // default length of msgSeq
 
+// v2格式的包以固定的两个字节开头，v1的包以PB_START开头，同一个端口上可以区分两种格式
+static const char PB_V2_MAGIC0 = (char)0xCB;
+static const char PB_V2_MAGIC1 = 0x02;
+static const int PB_V2_PREFIX_LEN = 3; // magic + flags
+
+// v2包头的flags
+static const uint8_t PB_FLAG_REPLY = 0x01;       // 回包，没有methodId
+static const uint8_t PB_FLAG_NUMERIC_SEQ = 0x02; // msgSeq编码为varint
+static const uint8_t PB_FLAG_ERROR = 0x04;       // 带有errCode和errInfo
+static const uint8_t PB_FLAG_META = 0x08;        // 带有附加信息
+static const uint8_t PB_FLAG_CHECKSUM = 0x10;    // 包尾带有crc32c
+static const uint8_t PB_FLAG_COMPRESS_TYPE = 0x20; // 带有压缩算法
+static const uint8_t PB_FLAG_COMPRESSED = 0x40;  // pbData已压缩
+static const uint8_t PB_FLAG_ALL = PB_FLAG_REPLY | PB_FLAG_NUMERIC_SEQ | PB_FLAG_ERROR | PB_FLAG_META | PB_FLAG_CHECKSUM
+                                 | PB_FLAG_COMPRESS_TYPE | PB_FLAG_COMPRESSED;
+static const int PB_CHECKSUM_LEN = 4;
+
+// 没有配置时，pbData达到这个长度才压缩
+static const int DEFAULT_COMPRESS_MIN_SIZE = 1024;
+// 每个线程缓存的压缩缓冲区超过这个大小时释放
+static const size_t MAX_CACHED_COMPRESS_BUFFER = 4 * 1024 * 1024;
+
+// 没有配置时，一个包和解压之后的pbData的最大长度
+static const int DEFAULT_PB_MAX_MESSAGE_SIZE = 4 * 1024 * 1024;
+
+static size_t maxMessageSize()
+{
+    return gConfig ? gConfig->pbMaxMessageSize : DEFAULT_PB_MAX_MESSAGE_SIZE;
+}
+
+// 不以0开头、不超过19位的十进制数可以无损地转换成uint64
+static bool isNumericSeq(const std::string &msgSeq, uint64_t &value)
+{
+    if (msgSeq.empty() || msgSeq.size() > 19 || (msgSeq[0] == '0' && msgSeq.size() > 1)) {
+        return false;
+    }
+    value = 0;
+    for (char c : msgSeq) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+static void putString(std::string &out, const std::string &str)
+{
+    putVarint64(out, str.size());
+    out.append(str);
+}
+
+// 从[p, end)中解析一个varint长度的字符串，成功时p移动到字符串之后
+static bool getString(const char *&p, const char *end, std::string &str)
+{
+    uint64_t len = 0;
+    int n = getVarint64(p, end, len);
+    if (n <= 0 || len > (uint64_t)(end - p - n)) {
+        return false;
+    }
+    p += n;
+    str.assign(p, len);
+    p += len;
+    return true;
+}
+
+// v1包的附加信息放在errInfo里，以这个不可见字符开头，和回包中的错误信息区分开
+static const char PB_V1_META_MARK = 0x01;
+
+// 附加信息中的'%'、'&'、'='和控制字符按%XX转义
+static void escapeMeta(std::string &out, const std::string &str)
+{
+    static const char HEX[] = "0123456789ABCDEF";
+    for (unsigned char c : str) {
+        if (c == '%' || c == '&' || c == '=' || c < 0x20 || c == 0x7f) {
+            out += '%';
+            out += HEX[c >> 4];
+            out += HEX[c & 0x0f];
+        }
+        else {
+            out += (char)c;
+        }
+    }
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// 不完整的转义原样保留
+static std::string unescapeMeta(const char *p, const char *end)
+{
+    std::string out;
+    out.reserve(end - p);
+    while (p < end) {
+        int hi = -1;
+        int lo = -1;
+        if (*p == '%' && end - p >= 3 && (hi = hexValue(p[1])) >= 0 && (lo = hexValue(p[2])) >= 0) {
+            out += (char)(hi << 4 | lo);
+            p += 3;
+        }
+        else {
+            out += *p++;
+        }
+    }
+    return out;
+}
+
+static std::string encodeV1Meta(const std::map<std::string, std::string> &meta)
+{
+    std::string out;
+    if (meta.empty()) {
+        return out;
+    }
+    out += PB_V1_META_MARK;
+    for (const auto &item : meta) {
+        if (out.size() > 1) {
+            out += '&';
+        }
+        escapeMeta(out, item.first);
+        out += '=';
+        escapeMeta(out, item.second);
+    }
+    return out;
+}
+
+// 格式为 mark key=value&key=value，不以mark开头时不是附加信息，返回false
+static bool decodeV1Meta(const std::string &str, std::map<std::string, std::string> &meta)
+{
+    if (str.empty() || str[0] != PB_V1_META_MARK) {
+        return false;
+    }
+    const char *p = str.data() + 1;
+    const char *end = str.data() + str.size();
+    while (p < end) {
+        const char *next = std::find(p, end, '&');
+        const char *eq = std::find(p, next, '=');
+        if (eq != p && eq != next) {
+            meta[unescapeMeta(p, eq)] = unescapeMeta(eq + 1, next);
+        }
+        p = next == end ? end : next + 1;
+    }
+    return true;
+}
+
 PbCodeC::PbCodeC()
 {
 }
@@ -33,6 +195,17 @@ void PbCodeC::encode(TcpBuffer *buf, AbstractData *data)
     LOG_DEBUG << "test encode start";
     PbStruct *temp = dynamic_cast<PbStruct *>(data);
 
+    if (temp->protoVersion >= 2) {
+        std::string out;
+        if (!encodePbDataV2(temp, out)) {
+            LOG_ERROR << "encode error";
+            return;
+        }
+        buf->writeToBuffer(out.data(), out.size());
+        LOG_DEBUG << "succ encode v2 package, len=" << out.size() << ", writeindex=" << buf->writeIndex();
+        return;
+    }
+
     int len = 0;
     const char *re = encodePbData(temp, len);
     if (re == nullptr || len == 0 || !temp->encodeSucc_) {
@@ -66,9 +239,21 @@ const char *PbCodeC::encodePbData(PbStruct *data, int &len)
         LOG_DEBUG << "generate msgno = " << data->msgSeq;
     }
 
-    int32_t pkLen = 2 * sizeof(char) + 6 * sizeof(int32_t) + data->pbData.size() + data->serviceFullName.size() + data->msgSeq.size() + data->errInfo.size();
+    // 附加信息放在errInfo里，回包只在成功时带上协商v2的附加信息
+    std::string metaInfo;
+    if (data->errCode == 0 && data->errInfo.empty()) {
+        metaInfo = encodeV1Meta(data->meta);
+    }
+    const std::string &errInfo = metaInfo.empty() ? data->errInfo : metaInfo;
+
+    int32_t pkLen = 2 * sizeof(char) + 6 * sizeof(int32_t) + data->pbData.size() + data->serviceFullName.size() + data->msgSeq.size() + errInfo.size();
 
     LOG_DEBUG << "encode pkLen = " << pkLen;
+    if ((size_t)pkLen > maxMessageSize()) {
+        LOG_ERROR << "encode error, package too large, len=" << pkLen << ", max=" << maxMessageSize();
+        data->encodeSucc_ = false;
+        return nullptr;
+    }
     char *buf = reinterpret_cast<char *>(malloc(pkLen));
     char *temp = buf;
     *temp = PB_START;
@@ -106,14 +291,14 @@ const char *PbCodeC::encodePbData(PbStruct *data, int &len)
     memcpy(temp, &errCodeNet, sizeof(int32_t));
     temp += sizeof(int32_t);
 
-    int32_t errInfoLen = data->errInfo.size();
+    int32_t errInfoLen = errInfo.size();
     LOG_DEBUG << "errInfoLen= " << errInfoLen;
     int32_t errInfoLenNet = htonl(errInfoLen);
     memcpy(temp, &errInfoLenNet, sizeof(int32_t));
     temp += sizeof(int32_t);
 
     if (errInfoLen != 0) {
-        memcpy(temp, &(data->errInfo[0]), errInfoLen);
+        memcpy(temp, &errInfo[0], errInfoLen);
         temp += errInfoLen;
     }
 
@@ -142,6 +327,245 @@ const char *PbCodeC::encodePbData(PbStruct *data, int &len)
     return buf;
 }
 
+bool PbCodeC::encodePbDataV2(PbStruct *data, std::string &out)
+{
+    data->encodeSucc_ = false;
+    if (!data->isReply && data->methodId == 0) {
+        if (data->serviceFullName.empty()) {
+            LOG_ERROR << "parse error, serviceFullName is empty";
+            return false;
+        }
+        data->methodId = PbRpcDispacther::getMethodId(data->serviceFullName);
+    }
+    if (data->msgSeq.empty()) {
+        data->msgSeq = MsgSeqUtil::genMsgNumber();
+        LOG_DEBUG << "generate msgno = " << data->msgSeq;
+    }
+
+    uint8_t flags = 0;
+    std::string body;
+    body.reserve(32 + data->msgSeq.size() + data->errInfo.size());
+
+    uint64_t seq = 0;
+    if (isNumericSeq(data->msgSeq, seq)) {
+        flags |= PB_FLAG_NUMERIC_SEQ;
+        putVarint64(body, seq);
+    }
+    else {
+        putString(body, data->msgSeq);
+    }
+    if (data->isReply) {
+        flags |= PB_FLAG_REPLY;
+    }
+    else {
+        putUint64ToNetByte(body, data->methodId);
+    }
+    if (data->errCode != 0 || !data->errInfo.empty()) {
+        flags |= PB_FLAG_ERROR;
+        putVarint64(body, (uint32_t)data->errCode);
+        putString(body, data->errInfo);
+    }
+    if (!data->meta.empty()) {
+        flags |= PB_FLAG_META;
+        putVarint64(body, data->meta.size());
+        for (const auto &item : data->meta) {
+            putString(body, item.first);
+            putString(body, item.second);
+        }
+    }
+
+    // 压缩之后的数据放在线程缓存的缓冲区中，不用每次分配
+    static thread_local std::string tCompressBuf;
+    const std::string *payload = &data->pbData;
+    if (data->compressType != COMPRESS_NONE) {
+        flags |= PB_FLAG_COMPRESS_TYPE;
+        body.push_back((char)data->compressType);
+        Compressor *compressor = Compressor::get(data->compressType);
+        size_t minSize = gConfig ? gConfig->compressMinSize : DEFAULT_COMPRESS_MIN_SIZE;
+        if (compressor && data->pbData.size() >= minSize) {
+            tCompressBuf.clear();
+            // 压缩之后没有变小时发送原始数据
+            if (compressor->compress(data->pbData.data(), data->pbData.size(), tCompressBuf) && tCompressBuf.size() < data->pbData.size()) {
+                flags |= PB_FLAG_COMPRESSED;
+                payload = &tCompressBuf;
+                LOG_DEBUG << "compress pbData with " << compressor->name() << " from " << data->pbData.size() << " to " << tCompressBuf.size() << " bytes";
+            }
+        }
+    }
+
+    size_t bodyLen = body.size() + payload->size();
+    if (data->withChecksum) {
+        flags |= PB_FLAG_CHECKSUM;
+        bodyLen += PB_CHECKSUM_LEN;
+    }
+    if (bodyLen > maxMessageSize()) {
+        LOG_ERROR << "encode error, package too large, len=" << bodyLen << ", max=" << maxMessageSize();
+        return false;
+    }
+    size_t start = out.size();
+    out.reserve(out.size() + PB_V2_PREFIX_LEN + 5 + bodyLen);
+    out.push_back(PB_V2_MAGIC0);
+    out.push_back(PB_V2_MAGIC1);
+    out.push_back((char)flags);
+    putVarint64(out, bodyLen);
+    out.append(body);
+    out.append(*payload);
+    if (tCompressBuf.capacity() > MAX_CACHED_COMPRESS_BUFFER) {
+        std::string().swap(tCompressBuf);
+    }
+    if (data->withChecksum) {
+        // 校验整个包，包头损坏时也能发现
+        uint32_t checksum = crc32c(out.data() + start, out.size() - start);
+        uint32_t checksumNet = htonl(checksum);
+        out.append(reinterpret_cast<const char *>(&checksumNet), sizeof(checksumNet));
+        data->checksum = checksum;
+    }
+
+    data->msgSeqLen = data->msgSeq.size();
+    data->serviceNameLen = data->serviceFullName.size();
+    data->errInfoLen = data->errInfo.size();
+    data->pkLen = out.size() - start;
+    data->encodeSucc_ = true;
+    return true;
+}
+
+void PbCodeC::decodeV2(TcpBuffer *buf, PbStruct *data)
+{
+    data->decodeSucc_ = false;
+    const char *begin = &buf->buffer_[buf->readIndex()];
+    const char *end = begin + buf->readAble();
+    if (end - begin < PB_V2_PREFIX_LEN + 1) {
+        return;
+    }
+    uint8_t flags = (uint8_t)begin[2];
+
+    uint64_t bodyLen = 0;
+    int n = getVarint64(begin + PB_V2_PREFIX_LEN, end, bodyLen);
+    if (n == 0) {
+        return;
+    }
+    if (n < 0 || bodyLen > maxMessageSize()) {
+        // 长度错误时找不到下一个包的开始位置，丢弃已经收到的数据
+        LOG_ERROR << "parse error, invalid v2 body length, drop " << buf->readAble() << " bytes";
+        buf->recycleRead(buf->readAble());
+        return;
+    }
+    const char *p = begin + PB_V2_PREFIX_LEN + n;
+    if ((uint64_t)(end - p) < bodyLen) {
+        LOG_DEBUG << "recv v2 package not complete, continue next parse";
+        return;
+    }
+    end = p + bodyLen;
+    int frameLen = end - begin;
+
+    bool succ = (flags & ~PB_FLAG_ALL) == 0;
+    if (!succ) {
+        LOG_ERROR << "parse error, unknown flags " << (int)flags << " of v2 package";
+    }
+    bool checksumErr = false;
+    if (succ && (flags & PB_FLAG_CHECKSUM)) {
+        succ = end - p >= PB_CHECKSUM_LEN;
+        if (succ) {
+            end -= PB_CHECKSUM_LEN;
+            data->checksum = getInt32FromNetByte(end);
+            data->withChecksum = true;
+            checksumErr = crc32c(begin, end - begin) != (uint32_t)data->checksum;
+        }
+    }
+    if (succ && (flags & PB_FLAG_NUMERIC_SEQ)) {
+        uint64_t seq = 0;
+        n = getVarint64(p, end, seq);
+        succ = n > 0;
+        if (succ) {
+            p += n;
+            data->msgSeq = std::to_string(seq);
+        }
+    }
+    else if (succ) {
+        succ = getString(p, end, data->msgSeq);
+    }
+    if (succ && !(flags & PB_FLAG_REPLY)) {
+        succ = end - p >= 8;
+        if (succ) {
+            data->methodId = getUint64FromNetByte(p);
+            p += 8;
+        }
+    }
+    data->isReply = (flags & PB_FLAG_REPLY) != 0;
+    if (succ && (flags & PB_FLAG_ERROR)) {
+        uint64_t errCode = 0;
+        n = getVarint64(p, end, errCode);
+        succ = n > 0;
+        if (succ) {
+            p += n;
+            data->errCode = (int32_t)(uint32_t)errCode;
+            succ = getString(p, end, data->errInfo);
+        }
+    }
+    if (succ && (flags & PB_FLAG_META)) {
+        uint64_t count = 0;
+        n = getVarint64(p, end, count);
+        succ = n > 0;
+        p += succ ? n : 0;
+        for (uint64_t i = 0; succ && i < count; ++i) {
+            std::string key;
+            std::string value;
+            succ = getString(p, end, key) && getString(p, end, value);
+            if (succ) {
+                data->meta[key] = value;
+            }
+        }
+    }
+    if (succ && (flags & PB_FLAG_COMPRESS_TYPE)) {
+        succ = p < end;
+        if (succ) {
+            data->compressType = (uint8_t)*p++;
+        }
+    }
+    bool decompressErr = false;
+    if (succ && (flags & PB_FLAG_COMPRESSED) && !checksumErr) {
+        Compressor *compressor = (flags & PB_FLAG_COMPRESS_TYPE) ? Compressor::get(data->compressType) : nullptr;
+        data->pbData.clear();
+        decompressErr = !compressor || !compressor->decompress(p, end - p, data->pbData, maxMessageSize());
+    }
+    else if (succ) {
+        data->pbData.assign(p, end - p);
+    }
+    buf->recycleRead(frameLen);
+
+    if ((checksumErr || decompressErr) && !data->msgSeq.empty()) {
+        // 包已经损坏，只保留msgSeq，用于回复错误或者让等待这个回包的调用失败
+        if (checksumErr) {
+            LOG_ERROR << "checksum mismatch, msgSeq = " << data->msgSeq << ", pkLen = " << frameLen;
+            data->errCode = ERROR_CHECKSUM_MISMATCH;
+            data->errInfo = "checksum mismatch, package is corrupted";
+        }
+        else {
+            LOG_ERROR << "decompress pbData error, compress type = " << (int)data->compressType << ", msgSeq = " << data->msgSeq;
+            data->errCode = ERROR_FAILED_DECOMPRESS;
+            data->errInfo = "failed to decompress pb data, compress type " + std::to_string(data->compressType);
+        }
+        data->serviceFullName.clear();
+        data->methodId = 0;
+        data->meta.clear();
+        data->pbData.clear();
+        succ = true;
+    }
+    else if (checksumErr || decompressErr) {
+        succ = false;
+    }
+    if (!succ) {
+        LOG_ERROR << "parse error, drop v2 package of len " << frameLen;
+        return;
+    }
+    data->protoVersion = 2;
+    data->pkLen = frameLen;
+    data->msgSeqLen = data->msgSeq.size();
+    data->errInfoLen = data->errInfo.size();
+    data->decodeSucc_ = true;
+    LOG_DEBUG << "decode v2 succ, pkLen = " << frameLen << ", msgSeq = " << data->msgSeq;
+}
+
 void PbCodeC::decode(TcpBuffer *buf, AbstractData *data)
 {
     if (!buf || !data) {
@@ -149,6 +573,12 @@ void PbCodeC::decode(TcpBuffer *buf, AbstractData *data)
         return;
     }
 
+    int readIndex = buf->readIndex();
+    if (buf->readAble() >= 2 && buf->buffer_[readIndex] == PB_V2_MAGIC0 && buf->buffer_[readIndex + 1] == PB_V2_MAGIC1) {
+        decodeV2(buf, dynamic_cast<PbStruct *>(data));
+        return;
+    }
+
     std::vector<char> temp = buf->getBufferVector();
     int startIndex = buf->readIndex();
     int endIndex = -1;
@@ -162,6 +592,11 @@ void PbCodeC::decode(TcpBuffer *buf, AbstractData *data)
             if (i + 1 < buf->writeIndex()) {
                 pkLen = getInt32FromNetByte(&temp[i + 1]);
                 LOG_DEBUG << "prase pkLen =" << pkLen;
+                // 超过最大长度的包不再等待收完整，当作找错了开始字符
+                if (pkLen <= 0 || (size_t)pkLen > maxMessageSize()) {
+                    LOG_DEBUG << "invalid pkLen " << pkLen << ", PB_START find error";
+                    continue;
+                }
                 int j = i + pkLen - 1;
                 LOG_DEBUG << "j =" << j << ", i=" << i;
 
@@ -261,10 +696,15 @@ void PbCodeC::decode(TcpBuffer *buf, AbstractData *data)
     LOG_DEBUG << "errInfoLen = " << pbStruct->errInfoLen;
     int errInfoIndex = errInfoLenIndex + sizeof(int32_t);
 
-    char errInfo[1024] = {0};
-
-    memcpy(&errInfo[0], &temp[errInfoIndex], pbStruct->errInfoLen);
-    pbStruct->errInfo = std::string(errInfo);
+    if (pbStruct->errInfoLen < 0 || pbStruct->errInfoLen > endIndex - errInfoIndex) {
+        LOG_ERROR << "parse error, errInfoLen[" << pbStruct->errInfoLen << "] exceeds package";
+        return;
+    }
+    pbStruct->errInfo.assign(&temp[errInfoIndex], pbStruct->errInfoLen);
+    // 只有以PB_V1_META_MARK开头的errInfo是附加信息，其他的是对端的错误信息，原样保留
+    if (pbStruct->errCode == 0 && decodeV1Meta(pbStruct->errInfo, pbStruct->meta)) {
+        pbStruct->errInfo.clear();
+    }
 
     int pbDataLen = pbStruct->pkLen - pbStruct->serviceNameLen - pbStruct->msgSeqLen - pbStruct->errInfoLen - 2 * sizeof(char) - 6 * sizeof(int32_t);
 
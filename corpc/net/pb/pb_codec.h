@@ -2,6 +2,7 @@
 #define CORPC_NET_PB_PB_CODEC_H
 
 #include <cstdint>
+#include <string>
 #include "corpc/net/abstract_codec.h"
 #include "corpc/net/abstract_data.h"
 #include "corpc/net/pb/pb_data.h"
@@ -19,6 +20,11 @@ public:
     virtual ProtocolType getProtocolType() override;
 
     const char *encodePbData(PbStruct *data, int &len);
+    // 编码v2格式的包，追加到out中，失败时返回false
+    bool encodePbDataV2(PbStruct *data, std::string &out);
+
+private:
+    void decodeV2(TcpBuffer *buf, PbStruct *data);
 };
 
 }
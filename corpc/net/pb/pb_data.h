@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <map>
 #include <memory>
 #include "corpc/net/abstract_data.h"
 
@@ -35,6 +36,24 @@ public:
     std::string pbData;           // business pb data
     int32_t checksum{-1};         // checksum of all package. to check legality of data
     // char end;                        // identify end of protocal data
+
+    // 请求的附加信息，比如剩余的超时时间 timeout=xxx(ms)
+    // v1中成功的包不会用到errInfo，编码时放在errInfo里，格式为 \x01key=value&key=value，key和value中的'%'、'&'、'='按%XX转义，老版本的服务端会直接忽略
+    std::map<std::string, std::string> meta;
+
+    /**
+     *  v2 frame, used after both sides agree by meta proto=2 in a v1 request and its reply:
+     *  magic(2) + flags(1) + bodyLen(varint) + msgSeq + [methodId(8)] + [errCode + errInfo] + [meta] + pbData
+     *  msgSeq is a varint when it is a decimal number that fits in uint64, otherwise varint len + bytes
+     *  methodId is only in requests, errCode/errInfo and meta only when not empty
+     *  with compress type flag, a byte of compress type follows meta, pbData is compressed with it when compressed flag is set
+     *  with checksum flag, crc32c(4) of all bytes before it is appended
+     */
+    int32_t protoVersion{1};      // frame version, the server replies in the version of the request
+    bool isReply{false};          // set by server, v2 reply doesn't carry methodId
+    uint64_t methodId{0};         // id of serviceFullName, v2 request carries it instead of serviceFullName
+    bool withChecksum{false};     // v2 package carries crc32c, the server replies with checksum if the request has it
+    uint8_t compressType{0};      // compress pbData with it when it is large enough, in a request it is also the algorithm accepted for the reply
 };
 
 }
@@ -35,6 +35,13 @@ PbRpcAsyncChannel::PbRpcAsyncChannel(std::vector<NetAddress::ptr> addrs, LoadBal
     currentCor_ = Coroutine::getCurrentCoroutine();
 }
 
+PbRpcAsyncChannel::PbRpcAsyncChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
+{
+    rpcChannel_ = std::make_shared<PbRpcChannel>(endpoints, loadBalance);
+    currentIothread_ = IOThread::getCurrentIOThread();
+    currentCor_ = Coroutine::getCurrentCoroutine();
+}
+
 PbRpcAsyncChannel::~PbRpcAsyncChannel()
 {
     getCoroutinePool()->returnCoroutine(pendingCor_);
@@ -24,6 +24,7 @@ public:
 
     PbRpcAsyncChannel(NetAddress::ptr addr);
     PbRpcAsyncChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
+    PbRpcAsyncChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
     ~PbRpcAsyncChannel();
 
     void CallMethod(const google::protobuf::MethodDescriptor *method,
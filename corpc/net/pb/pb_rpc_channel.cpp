@@ -1,4 +1,7 @@
+#include <atomic>
+#include <cstdlib>
 #include <memory>
+#include <algorithm>
 #include <google/protobuf/service.h>
 #include <google/protobuf/message.h>
 #include <google/protobuf/descriptor.h>
@@ -12,20 +15,256 @@
 #include "corpc/common/log.h"
 #include "corpc/common/msg_seq.h"
 #include "corpc/common/runtime.h"
+#include "corpc/common/config.h"
+#include "corpc/common/compress.h"
+#include "corpc/net/endpoint_stats.h"
+#include "corpc/net/outlier_detector.h"
+#include "corpc/net/latency_histogram.h"
+#include "corpc/net/event_loop.h"
+#include "corpc/coroutine/coroutine.h"
 
 namespace corpc {
 
+extern corpc::Config::ptr gConfig;
+
+// 重试的退避时间，ms
+static const int64_t RETRY_BACKOFF_BASE_MS = 10;
+static const int64_t RETRY_BACKOFF_MAX_MS = 200;
+
+// 一次请求的结果
+struct PbCallResult {
+    int ret{0};
+    std::string errInfo;
+    PbStruct::ptr resData;
+    NetAddress::ptr addr;
+    NetAddress::ptr localAddr;
+};
+
+// 对冲调用的共享状态，调用方返回之后，没有用上的请求结束时仍然会访问它
+// waiting和hedgeFired只在调用方的事件循环中访问；请求协程可能迁移到其他io线程结束，其余字段都是原子的
+struct HedgeState {
+    typedef std::shared_ptr<HedgeState> ptr;
+    Coroutine *caller{nullptr};
+    bool waiting{false};              // 调用方是否正在等待结果
+    bool hedgeFired{false};           // 对冲的等待时间已到
+    std::atomic<bool> claimed{false}; // 已经有请求抢到了写入结果的机会
+    std::atomic<bool> done{false};    // 结果已经写入
+    std::atomic<int> pending{0};      // 还没结束的请求数
+    PbCallResult *result{nullptr};
+};
+
+// 向一个节点发起一次调用
+static void callOnce(const NetAddress::ptr &addr, PbStruct &pbStruct, int64_t endCall, PbCallResult &result)
+{
+    TcpClient::ptr client = std::make_shared<TcpClient>(addr);
+    result.addr = addr;
+    result.localAddr = client->getLocalAddr();
+
+    // 剩余的超时时间带给服务端，服务端收到时已经超时的请求不会再处理
+    int64_t restTime = endCall - getNowMs();
+    pbStruct.meta["timeout"] = std::to_string(restTime);
+
+    // 服务端确认过支持v2格式之后才使用，否则在v1请求中带上proto=2询问服务端
+    EndpointStats::ptr stats = EndpointStatsRegistry::get(addr);
+    bool enableV2 = gConfig && gConfig->pbProtocolVersion >= 2;
+    bool enableChecksum = enableV2 && gConfig->pbChecksum;
+    pbStruct.protoVersion = enableV2 && stats->protoVersion() >= 2 ? 2 : 1;
+    pbStruct.withChecksum = pbStruct.protoVersion >= 2 && enableChecksum && stats->checksum();
+    // 压缩算法可以按方法配置，节点不支持时不压缩
+    Compressor *compressor = nullptr;
+    if (enableV2) {
+        auto it = gConfig->compressMethods.find(pbStruct.serviceFullName);
+        compressor = Compressor::get(it != gConfig->compressMethods.end() ? it->second : gConfig->compressType);
+    }
+    pbStruct.compressType = COMPRESS_NONE;
+    if (pbStruct.protoVersion >= 2 && compressor && (stats->compressMask() & (1ULL << compressor->type()))) {
+        pbStruct.compressType = compressor->type();
+    }
+    if (enableV2 && pbStruct.protoVersion < 2) {
+        pbStruct.meta["proto"] = "2";
+        if (enableChecksum) {
+            pbStruct.meta["checksum"] = "crc32c";
+        }
+        if (!gConfig->compressType.empty() || !gConfig->compressMethods.empty()) {
+            pbStruct.meta["compress"] = Compressor::getNames();
+        }
+    }
+    else {
+        pbStruct.meta.erase("proto");
+        pbStruct.meta.erase("checksum");
+        pbStruct.meta.erase("compress");
+    }
+
+    AbstractCodeC::ptr codec = client->getConnection()->getCodec();
+    codec->encode(client->getConnection()->getOutBuffer(), &pbStruct);
+    if (!pbStruct.encodeSucc_) {
+        result.ret = ERROR_FAILED_ENCODE;
+        result.errInfo = "encode pb data error";
+        return;
+    }
+    client->setTimeout(restTime);
+
+    // 记录节点的统计信息，供负载均衡和异常检测使用
+    stats->onStart();
+    int64_t startUs = getNowUs();
+    result.ret = client->sendAndRecvPb(pbStruct.msgSeq, result.resData); // 接收并解码服务端响应
+    if (result.ret == 0 && (result.resData->errCode == ERROR_CHECKSUM_MISMATCH || result.resData->errCode == ERROR_FAILED_DECOMPRESS
+        || result.resData->errCode == ERROR_FAILED_DECODE)) {
+        // 请求或者回包在传输中损坏，或者对端不接受这个格式，换一个节点重试
+        result.ret = result.resData->errCode;
+        result.errInfo = result.resData->errInfo;
+    }
+    // 只有v2的包本身被拒绝时才回退到v1：对端回复了解码错误，或者按v1回包，比如节点换成了关闭v2的版本
+    // 超时和连接错误和包的格式无关，不回退
+    if (pbStruct.protoVersion >= 2 && result.resData && (result.resData->errCode == ERROR_FAILED_DECODE || result.resData->protoVersion < 2)) {
+        LOG_INFO << pbStruct.msgSeq << "|peer [" << addr->toString() << "] rejects v2 pb frame, fall back to v1";
+        stats->setProtoVersion(1);
+    }
+    int64_t latencyUs = getNowUs() - startUs;
+    OutlierDetector::record(addr, stats, latencyUs, result.ret == 0);
+    if (result.ret == 0) {
+        LatencyHistogram::get(pbStruct.serviceFullName)->record(latencyUs);
+        auto it = result.resData->meta.find("proto");
+        if (enableV2 && it != result.resData->meta.end() && std::atoi(it->second.c_str()) >= 2) {
+            stats->setProtoVersion(2);
+            it = result.resData->meta.find("checksum");
+            stats->setChecksum(enableChecksum && it != result.resData->meta.end() && it->second == "crc32c");
+            it = result.resData->meta.find("compress");
+            stats->setCompressMask(it != result.resData->meta.end() ? Compressor::parseNames(it->second) : 0);
+        }
+    }
+    else {
+        result.resData.reset();
+        if (result.errInfo.empty()) {
+            result.errInfo = client->getErrInfo();
+        }
+    }
+}
+
+// 在当前线程的新协程中发起一次调用，成功或者所有请求都失败时唤醒调用方
+static void startAttempt(HedgeState::ptr state, NetAddress::ptr addr, PbStruct pbStruct, int64_t endCall)
+{
+    EventLoop *loop = EventLoop::getEventLoop();
+    state->pending.fetch_add(1);
+    loop->runInCoroutine([state, addr, pbStruct, endCall, loop]() mutable {
+        PbCallResult result;
+        callOnce(addr, pbStruct, endCall, result);
+        int pending = state->pending.fetch_sub(1) - 1;
+        // 只有一个请求能写入结果，写完之后再发布done，调用方看到done时结果已经完整
+        if ((result.ret == 0 || pending == 0) && !state->claimed.exchange(true)) {
+            *state->result = std::move(result);
+            state->done.store(true, std::memory_order_release);
+            // 在调用方的事件循环中唤醒它
+            loop->addTask([state]() {
+                if (state->waiting) {
+                    Coroutine::resume(state->caller);
+                }
+            });
+        }
+    });
+}
+
 PbRpcChannel::PbRpcChannel(NetAddress::ptr addr)
 {
-    addrs_.clear();
-    addrs_.push_back(addr);
-    originAddrs_ = addrs_;
-    loadBalancer_ = LoadBalance::queryStrategy(LoadBalanceCategory::Random);
+    publishState(0, {addr}, LoadBalance::queryStrategy(LoadBalanceCategory::Random));
+}
+
+PbRpcChannel::PbRpcChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
+{
+    publishState(0, addrs, LoadBalance::queryStrategy(loadBalance));
+}
+
+PbRpcChannel::PbRpcChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/) : endpoints_(endpoints)
+{
+    EndpointSnapshot::ptr snap = endpoints_->snapshot();
+    publishState(snap->version, snap->addrs, LoadBalance::queryStrategy(loadBalance));
+}
+
+void PbRpcChannel::setLoadBalanceStrategy(LoadBalanceStrategy::ptr strategy)
+{
+    EndpointState::ptr state = std::atomic_load(&state_);
+    publishState(state->version, state->addrs, strategy);
+}
+
+void PbRpcChannel::publishState(uint64_t version, const std::vector<NetAddress::ptr> &addrs, LoadBalanceStrategy::ptr loadBalancer)
+{
+    std::shared_ptr<EndpointState> state = std::make_shared<EndpointState>();
+    state->version = version;
+    state->addrs = addrs;
+    state->loadBalancer = loadBalancer;
+    state->loadBalanceState = loadBalancer->prepare(addrs);
+    std::atomic_store(&state_, EndpointState::ptr(state));
+}
+
+PbRpcChannel::EndpointState::ptr PbRpcChannel::syncEndpoints()
+{
+    EndpointState::ptr state = std::atomic_load(&state_);
+    if (!endpoints_) {
+        return state;
+    }
+    EndpointSnapshot::ptr snap = endpoints_->snapshot();
+    if (snap->version != state->version) {
+        // 多个线程同时发现地址变化时会各自发布一次，内容相同
+        publishState(snap->version, snap->addrs, state->loadBalancer);
+        state = std::atomic_load(&state_);
+    }
+    return state;
 }
 
-PbRpcChannel::PbRpcChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/) : addrs_(addrs), originAddrs_(addrs)
+NetAddress::ptr PbRpcChannel::pickAddr(const EndpointState &state, const PbStruct &pbStruct, const std::vector<NetAddress::ptr> &excluded)
 {
-    loadBalancer_ = LoadBalance::queryStrategy(loadBalance);
+    // 摘除时间已到的节点优先拿来探测，否则在健康的节点中做负载均衡
+    NetAddress::ptr addr = OutlierDetector::pickProbe(state.addrs, excluded);
+    if (!addr) {
+        std::vector<NetAddress::ptr> candidates = OutlierDetector::filter(state.addrs, excluded);
+        addr = state.loadBalancer->selectPrepared(state.loadBalanceState, candidates, pbStruct); // 负载均衡器的选择
+    }
+    return addr;
+}
+
+void PbRpcChannel::hedgedCall(const EndpointState &endpointState, NetAddress::ptr addr, const PbStruct &pbStruct, int64_t endCall, int64_t hedgeDelay,
+                                const std::vector<NetAddress::ptr> &tried, RetryBudget::ptr budget, PbCallResult &result)
+{
+    HedgeState::ptr state = std::make_shared<HedgeState>();
+    state->caller = Coroutine::getCurrentCoroutine();
+    // 调用方等到done之后才会返回，请求结束时只有在done之前会写入result
+    state->result = &result;
+    startAttempt(state, addr, pbStruct, endCall);
+
+    TimerEvent::ptr event = std::make_shared<TimerEvent>(hedgeDelay, false, [state]() {
+        state->hedgeFired = true;
+        if (state->waiting) {
+            Coroutine::resume(state->caller);
+        }
+    });
+    EventLoop::getEventLoop()->getTimer()->addTimerEvent(event);
+
+    bool hedged = false;
+    state->waiting = true;
+    while (!state->done.load(std::memory_order_acquire)) {
+        Coroutine::yield();
+        if (state->done.load(std::memory_order_acquire) || !state->hedgeFired || hedged) {
+            continue;
+        }
+        hedged = true;
+        // 对冲请求会放大流量，和重试共用预算
+        if (!budget->tryRetry()) {
+            LOG_INFO << pbStruct.msgSeq << "|retry budget exhausted, skip hedged request";
+            continue;
+        }
+        std::vector<NetAddress::ptr> excluded = tried;
+        excluded.push_back(addr);
+        NetAddress::ptr hedgeAddr = pickAddr(endpointState, pbStruct, excluded);
+        if (hedgeAddr.get() == addr.get()) {
+            continue;
+        }
+        LOG_INFO << pbStruct.msgSeq << "|no reply after " << hedgeDelay << " ms, send hedged request to " << hedgeAddr->toString();
+        startAttempt(state, hedgeAddr, pbStruct, endCall);
+    }
+    state->waiting = false;
+    // 之后结束的请求不能再写调用方栈上的result
+    state->result = nullptr;
+    EventLoop::getEventLoop()->getTimer()->delTimerEvent(event);
 }
 
 void PbRpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
@@ -71,40 +310,63 @@ void PbRpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
         rpcController->SetMsgSeq(pbStruct.msgSeq);
     }
 
+    EndpointState::ptr endpointState = syncEndpoints();
+    if (endpointState->addrs.empty()) {
+        rpcController->SetError(ERROR_SERVICE_NOT_FOUND, "not found address of service");
+        LOG_ERROR << pbStruct.msgSeq << "|call rpc occur client error, serviceFullName=" << pbStruct.serviceFullName << ", error_code="
+                << ERROR_SERVICE_NOT_FOUND << ", errorInfo = not found address of service";
+        if (done) {
+            done->Run();
+        }
+        return;
+    }
+
     int maxRetry = rpcController->MaxRetry();
     PbStruct::ptr resData;
     int64_t endCall = getNowMs() + rpcController->Timeout();
+    // 在处理上游请求时发起的调用，不能超过上游请求的截止时间
+    RunTime *runtime = getCurrentRunTime();
+    if (runtime != nullptr && runtime->deadline_ > 0 && runtime->deadline_ < endCall) {
+        endCall = runtime->deadline_;
+        if (endCall <= getNowMs()) {
+            rpcController->SetError(ERROR_RPC_DEADLINE_EXCEEDED, "deadline of upstream request exceeded");
+            LOG_ERROR << pbStruct.msgSeq << "|call rpc occur client error, serviceFullName=" << pbStruct.serviceFullName << ", error_code="
+                    << ERROR_RPC_DEADLINE_EXCEEDED << ", errorInfo = deadline of upstream request exceeded";
+            if (done) {
+                done->Run();
+            }
+            return;
+        }
+    }
+
+    // 同一个方法的所有调用共享重试预算，避免部分故障时重试把流量放大
+    RetryBudget::ptr budget = RetryBudget::get(pbStruct.serviceFullName);
+    budget->onRequest();
+    // 本次调用已经失败过的节点，重试时不再选择
+    std::vector<NetAddress::ptr> tried;
+    int lastErrCode = 0;
+    std::string lastErrInfo;
 
     // 重试大循环，最多的重复调用次数为 1 + maxRetry
     for (int retryTimes = 0; retryTimes <= maxRetry; retryTimes++) {
-        if (addrs_.empty()) {
-            addrs_ = originAddrs_;
-            if (addrs_.empty()) {
-                rpcController->SetError(ERROR_SERVICE_NOT_FOUND, "not found address of service");
-                LOG_ERROR << pbStruct.msgSeq << "|call rpc occur client error, serviceFullName=" << pbStruct.serviceFullName << ", error_code="
-                        << ERROR_SERVICE_NOT_FOUND << ", errorInfo = not found address of service";
-                if (done) {
-                    done->Run();
-                }
-                return;
+        if (retryTimes > 0) {
+            if (!budget->tryRetry()) {
+                LOG_ERROR << pbStruct.msgSeq << "|retry budget exhausted, serviceFullName=" << pbStruct.serviceFullName << ", give up retry";
+                break;
             }
-        }
-        NetAddress::ptr addr = loadBalancer_->select(addrs_, pbStruct); // 负载均衡器的选择
-        LOG_INFO << "service full name: " << pbStruct.serviceFullName << " server addr: " << addr->toString();
-        TcpClient::ptr client = std::make_shared<TcpClient>(addr);
-        rpcController->SetLocalAddr(client->getLocalAddr());
-        rpcController->SetPeerAddr(client->getPeerAddr());
-
-        AbstractCodeC::ptr codec = client->getConnection()->getCodec();
-        codec->encode(client->getConnection()->getOutBuffer(), &pbStruct);
-        if (!pbStruct.encodeSucc_) {
-            rpcController->SetError(ERROR_FAILED_ENCODE, "encode pb data error");
-            if (done) {
-                done->Run();
+            // 指数退避 + 随机抖动，不超过剩余的超时时间
+            int64_t backoff = std::min<int64_t>(RETRY_BACKOFF_BASE_MS << (retryTimes - 1), RETRY_BACKOFF_MAX_MS);
+            backoff = std::min<int64_t>(RandomLoadBalanceStrategy::randomIndex(backoff) + 1, endCall - getNowMs());
+            if (backoff > 0) {
+                // 协程中挂起当前协程，主协程中（同步调用本来就阻塞线程）直接阻塞睡眠
+                sleepMs(backoff);
             }
-            return;
         }
 
+        NetAddress::ptr addr = pickAddr(*endpointState, pbStruct, tried);
+        LOG_INFO << "service full name: " << pbStruct.serviceFullName << " server addr: " << addr->toString();
+        rpcController->SetPeerAddr(addr);
+
         LOG_INFO << "============================================================";
         LOG_INFO << pbStruct.msgSeq << "|" << rpcController->PeerAddr()->toString()
                 << "|. Set client send request data: " << request->ShortDebugString();
@@ -113,38 +375,61 @@ void PbRpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
         }
         LOG_INFO << "============================================================";
 
-        int64_t restTime = endCall - getNowMs();
-        client->setTimeout(restTime);
+        // 对冲只在协程中、有多个节点、并且有足够的耗时统计时才会开启
+        int64_t hedgeDelay = 0;
+        if (rpcController->Hedge() && endpointState->addrs.size() > 1 && !Coroutine::isMainCoroutine()) {
+            hedgeDelay = rpcController->HedgeDelay();
+            if (hedgeDelay <= 0) {
+                hedgeDelay = (LatencyHistogram::get(pbStruct.serviceFullName)->percentile(0.95) + 999) / 1000;
+            }
+        }
+
+        PbCallResult result;
+        if (hedgeDelay > 0 && hedgeDelay < endCall - getNowMs()) {
+            hedgedCall(*endpointState, addr, pbStruct, endCall, hedgeDelay, tried, budget, result);
+        }
+        else {
+            callOnce(addr, pbStruct, endCall, result);
+        }
+        rpcController->SetLocalAddr(result.localAddr);
+        rpcController->SetPeerAddr(result.addr);
 
-        int ret = client->sendAndRecvPb(pbStruct.msgSeq, resData); // 接收并解码服务端响应
+        int ret = result.ret;
         if (ret == 0) {
+            resData = result.resData;
             break;
         }
-        else if (ret != 0 && ret != ERROR_RPC_TIMEOUT) {
-            auto it = addrs_.begin();
-            for (; it != addrs_.end(); it++) {
-                if ((*it)->toString() == addr->toString()) {
-                    break;
-                }
-            }
-            if (it != addrs_.end()) {
-                addrs_.erase(it);
+        if (ret == ERROR_FAILED_ENCODE) {
+            rpcController->SetError(ERROR_FAILED_ENCODE, "encode pb data error");
+            if (done) {
+                done->Run();
             }
+            return;
+        }
+        lastErrCode = ret;
+        lastErrInfo = result.errInfo;
+        if (ret != ERROR_RPC_TIMEOUT) {
+            tried.push_back(result.addr);
             LOG_ERROR << pbStruct.msgSeq << "|call rpc occur client error, serviceFullName=" << pbStruct.serviceFullName << ", error_code="
-                        << ret << ", errorInfo = " << client->getErrInfo() << ", to retry......";
+                        << ret << ", errorInfo = " << result.errInfo << ", to retry......";
             continue;
         }
         else {
-            rpcController->SetError(ret, client->getErrInfo());
             LOG_ERROR << pbStruct.msgSeq << "|call rpc occur client error, serviceFullName=" << pbStruct.serviceFullName << ", error_code="
-                        << ret << ", errorInfo = " << client->getErrInfo();
-            if (done) {
-                done->Run();
-            }
-            return;
+                        << ret << ", errorInfo = " << result.errInfo;
+            break;
         }
     }
 
+    if (!resData) {
+        // 所有尝试都失败了，返回最后一次的错误
+        rpcController->SetError(lastErrCode, lastErrInfo);
+        if (done) {
+            done->Run();
+        }
+        return;
+    }
+
     if (!response->ParseFromString(resData->pbData)) {
         rpcController->SetError(ERROR_FAILED_DESERIALIZE, "failed to deserialize data from server");
         LOG_ERROR << pbStruct.msgSeq << "|failed to deserialize data";
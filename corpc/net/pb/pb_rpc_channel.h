@@ -7,14 +7,21 @@
 #include "corpc/net/net_address.h"
 #include "corpc/net/tcp/tcp_client.h"
 #include "corpc/net/load_balance.h"
+#include "corpc/net/service_discovery.h"
+#include "corpc/net/outlier_detector.h"
+#include "corpc/net/pb/pb_data.h"
 
 namespace corpc {
 
+struct PbCallResult;
+
 class PbRpcChannel : public google::protobuf::RpcChannel {
 public:
     typedef std::shared_ptr<PbRpcChannel> ptr;
     PbRpcChannel(NetAddress::ptr addr);
     PbRpcChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
+    // 地址来自注册中心的缓存，每次调用前检查快照版本，地址变化后自动切换
+    PbRpcChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
     ~PbRpcChannel() = default;
 
     void CallMethod(const google::protobuf::MethodDescriptor *method,
@@ -23,10 +30,38 @@ public:
                     google::protobuf::Message *response,
                     google::protobuf::Closure *done);
 
+    // 使用自定义的负载均衡策略，比如按请求字段做一致性哈希：
+    // setLoadBalanceStrategy(std::make_shared<ConsistentHashLoadBalanceStrategy>(ConsistentHashLoadBalanceStrategy::fieldKey(1)))
+    void setLoadBalanceStrategy(LoadBalanceStrategy::ptr strategy);
+
+private:
+    // 通道当前使用的地址和负载均衡数据，发布之后不再修改，地址或者负载均衡器变化时整体替换
+    // 多个线程共用一个通道时，每次调用开始时原子地取一份，整个调用期间使用同一份
+    struct EndpointState {
+        typedef std::shared_ptr<const EndpointState> ptr;
+        uint64_t version{0};
+        std::vector<NetAddress::ptr> addrs;
+        LoadBalanceStrategy::ptr loadBalancer;
+        // 负载均衡器针对addrs预先计算的数据
+        LoadBalanceState::ptr loadBalanceState;
+    };
+
+    void publishState(uint64_t version, const std::vector<NetAddress::ptr> &addrs, LoadBalanceStrategy::ptr loadBalancer);
+
+    // 同步注册中心缓存中的最新地址，返回本次调用使用的状态
+    EndpointState::ptr syncEndpoints();
+
+    // 选择本次调用的节点，不会选到excluded中的节点（除非没有别的节点）
+    static NetAddress::ptr pickAddr(const EndpointState &state, const PbStruct &pbStruct, const std::vector<NetAddress::ptr> &excluded);
+
+    // 先向addr发请求，超过hedgeDelay还没有结果时再向另一个节点发一次，取先成功的结果
+    void hedgedCall(const EndpointState &endpointState, NetAddress::ptr addr, const PbStruct &pbStruct, int64_t endCall, int64_t hedgeDelay,
+                    const std::vector<NetAddress::ptr> &tried, RetryBudget::ptr budget, PbCallResult &result);
+
 private:
-    std::vector<NetAddress::ptr> addrs_;
-    std::vector<NetAddress::ptr> originAddrs_;
-    LoadBalanceStrategy::ptr loadBalancer_;
+    // 只通过std::atomic_load/std::atomic_store访问
+    EndpointState::ptr state_;
+    ServiceEndpoints::ptr endpoints_;
 };
 
 }
@@ -15,41 +15,23 @@
 #include "corpc/common/log.h"
 #include "corpc/common/runtime.h"
 #include "corpc/common/msg_seq.h"
-#include "corpc/coroutine/coroutine_pool.h"
-#include "corpc/coroutine/coroutine.h"
-#include "corpc/common/start.h"
-#include "corpc/net/pb/pb_rpc_closure.h"
+#include "corpc/net/tcp/client_runtime.h"
 
 namespace corpc {
 
 PbRpcClientAsyncChannel::PbRpcClientAsyncChannel(NetAddress::ptr addr)
 {
-    Coroutine::getCurrentCoroutine();
     rpcChannel_ = std::make_shared<PbRpcChannel>(addr);
-    loop_ = corpc::EventLoop::getEventLoop();
-    loop_->setEventLoopType(SubLoop);
-    ioPool_ = std::make_shared<IOThreadPool>(1);
-    ioPool_->start();
 }
 
 PbRpcClientAsyncChannel::PbRpcClientAsyncChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
 {
-    Coroutine::getCurrentCoroutine();
     rpcChannel_ = std::make_shared<PbRpcChannel>(addrs, loadBalance);
-    loop_ = corpc::EventLoop::getEventLoop();
-    loop_->setEventLoopType(SubLoop);
-    ioPool_ = std::make_shared<IOThreadPool>(1);
-    ioPool_->start();
 }
 
-PbRpcClientAsyncChannel::~PbRpcClientAsyncChannel()
+PbRpcClientAsyncChannel::PbRpcClientAsyncChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
 {
-    if (currentCor_) {
-        getCoroutinePool()->returnCoroutine(currentCor_);
-    }
-    if (pendingCor_) {
-        getCoroutinePool()->returnCoroutine(pendingCor_);
-    }
+    rpcChannel_ = std::make_shared<PbRpcChannel>(endpoints, loadBalance);
 }
 
 PbRpcChannel *PbRpcClientAsyncChannel::getRpcChannel()
@@ -59,11 +41,10 @@ PbRpcChannel *PbRpcClientAsyncChannel::getRpcChannel()
 
 void PbRpcClientAsyncChannel::saveCallee(conPtr controller, msgPtr req, msgPtr res, cloPtr closure)
 {
-    std::shared_ptr<corpc::PbRpcClosure> clo = std::make_shared<corpc::PbRpcClosure>(std::bind(&PbRpcClientAsyncChannel::stop, this, closure.get())); 
     controller_ = controller;
     req_ = req;
     res_ = res;
-    closure_ = clo;
+    closure_ = closure;
     isPreSet_ = true;
 }
 
@@ -73,26 +54,13 @@ void PbRpcClientAsyncChannel::CallMethod(const google::protobuf::MethodDescripto
                                     google::protobuf::Message *response,
                                     google::protobuf::Closure *done)
 {
+    PbRpcController *rpcController = dynamic_cast<PbRpcController *>(controller);
     if (!isPreSet_) {
         LOG_ERROR << "Error! must call [saveCallee()] function before [CallMethod()]";
-        PbRpcController *rpcController = dynamic_cast<PbRpcController *>(controller);
         rpcController->SetError(ERROR_NOT_SET_ASYNC_PRE_CALL, "Error! must call [saveCallee()] function before [CallMethod()];");
-        isFinished_ = true;
+        setFinished(true);
         return;
     }
-    currentCor_ = getCoroutinePool()->getCoroutineInstanse(); // 子协程
-    getCurrentCoroutine()->setCallBack(std::bind(&PbRpcClientAsyncChannel::callMethod, this, method, controller, request, response, closure_.get()));
-    loop_->addCoroutine(getCurrentCoroutine());
-    loop_->loop();
-}
-
-void PbRpcClientAsyncChannel::callMethod(const google::protobuf::MethodDescriptor *method,
-                                    google::protobuf::RpcController *controller,
-                                    const google::protobuf::Message *request,
-                                    google::protobuf::Message *response,
-                                    google::protobuf::Closure *done)
-{
-    PbRpcController *rpcController = dynamic_cast<PbRpcController *>(controller);
     RunTime *runtime = getCurrentRunTime();
     if (runtime) {
         rpcController->SetMsgSeq(runtime->msgNo_);
@@ -103,101 +71,41 @@ void PbRpcClientAsyncChannel::callMethod(const google::protobuf::MethodDescripto
         LOG_INFO << "get from RunTime error, generate new msgno=" << rpcController->MsgSeq();
     }
 
+    isFinished_ = false;
+    finishEvent_.reset();
     std::shared_ptr<PbRpcClientAsyncChannel> sPtr = shared_from_this();
 
-    // cb将在随机分配的新io线程中的子协程中执行
-    auto cb = [sPtr, method]() mutable {
-        LOG_INFO << "now execute rpc call method by this thread";
+    // cb在客户端io线程的子协程中执行，回调也在该协程中执行
+    ClientRuntime::runInCoroutine([sPtr, method]() {
+        LOG_INFO << "now execute rpc call method by client io thread";
         sPtr->getRpcChannel()->CallMethod(method, sPtr->getControllerPtr(), sPtr->getRequestPtr(), sPtr->getResponsePtr(), nullptr);
-
-        LOG_INFO << "execute rpc call method by this thread finish";
-
-        // callBack在之前的主io线程中的主协程中执行
-        auto callBack = [sPtr]() mutable {
-            LOG_INFO << "async execute rpc call method back old thread";
-            // callback function execute in origin thread
-            if (sPtr->getClosurePtr() != nullptr) {
-                sPtr->getClosurePtr()->Run();
-            }
-            sPtr->setFinished(true);
-
-            // 如果客户端调用了wait()，说明是需要resume到子协程的
-            if (sPtr->getNeedResume()) {
-                LOG_INFO << "async execute rpc call method back old thread, need resume";
-                Coroutine::resume(sPtr->getCurrentCoroutine().get());
-            }
-            sPtr.reset();
-        };
-
-        if (sPtr->getEventLoop()->isLooping()) {
-            sPtr->getEventLoop()->addTask(callBack, true);
-        }
-        else {
-            if (sPtr->getClosurePtr() != nullptr) {
-                sPtr->getClosurePtr()->Run();
-            }
-            sPtr->setFinished(true);
+        LOG_INFO << "execute rpc call method by client io thread finish";
+        if (sPtr->getClosurePtr() != nullptr) {
+            sPtr->getClosurePtr()->Run();
         }
-        sPtr.reset();
-    };
-    pendingCor_ = getIOThreadPool()->addCoroutineToRandomThread(cb, false);
-    if (loop_) {
-        loop_->stop();
-    }
-}
-
-void PbRpcClientAsyncChannel::stop(google::protobuf::Closure *done)
-{
-    if (done) {
-        done->Run();
-    }
-    if (loop_) {
-        loop_->stop();
-    }
+        sPtr->setFinished(true);
+    });
 }
 
 IOThreadPool::ptr PbRpcClientAsyncChannel::getIOThreadPool()
 {
-    return ioPool_;
-}
-
-EventLoop *PbRpcClientAsyncChannel::getEventLoop()
-{
-    return loop_;
-}
-
-void PbRpcClientAsyncChannel::waitCor()
-{
-    needResume_ = true;
-    if (isFinished_) { // rpc调用是否执行完，执行完就不用yield了
-        return;
-    }
-    Coroutine::yield();
+    return ClientRuntime::getIOThreadPool();
 }
 
 void PbRpcClientAsyncChannel::wait()
 {
-    if (!currentCor_) {
+    if (!isPreSet_ || isFinished_) { // rpc调用是否执行完，执行完就不用等待了
         return;
     }
-    getCurrentCoroutine()->setCallBack(std::bind(&PbRpcClientAsyncChannel::waitCor, this));
-    loop_->addCoroutine(getCurrentCoroutine());
-    loop_->loop();
+    finishEvent_.wait();
 }
 
 void PbRpcClientAsyncChannel::setFinished(bool value)
 {
-    isFinished_ = true;
-}
-
-Coroutine::ptr PbRpcClientAsyncChannel::getCurrentCoroutine()
-{
-    return currentCor_;
-}
-
-bool PbRpcClientAsyncChannel::getNeedResume()
-{
-    return needResume_;
+    isFinished_ = value;
+    if (value) {
+        finishEvent_.set();
+    }
 }
 
 google::protobuf::RpcController *PbRpcClientAsyncChannel::getControllerPtr()
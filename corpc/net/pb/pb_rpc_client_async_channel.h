@@ -9,12 +9,13 @@
 #include "corpc/net/pb/pb_rpc_controller.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/tcp/tcp_client.h"
-#include "corpc/coroutine/coroutine.h"
-#include "corpc/net/event_loop.h"
+#include "corpc/net/tcp/io_thread.h"
 #include "corpc/net/load_balance.h"
+#include "corpc/net/mutex.h"
 
 namespace corpc {
 
+// 异步调用：调用在进程共享的客户端io线程中执行，结束后在io线程中执行回调，wait()等待回调执行完
 class PbRpcClientAsyncChannel : public google::protobuf::RpcChannel, public std::enable_shared_from_this<PbRpcClientAsyncChannel> {
 public:
     typedef std::shared_ptr<PbRpcClientAsyncChannel> ptr;
@@ -24,7 +25,8 @@ public:
 
     PbRpcClientAsyncChannel(NetAddress::ptr addr);
     PbRpcClientAsyncChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
-    ~PbRpcClientAsyncChannel();
+    PbRpcClientAsyncChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
+    ~PbRpcClientAsyncChannel() = default;
 
     void CallMethod(const google::protobuf::MethodDescriptor *method,
                     google::protobuf::RpcController *controller,
@@ -42,10 +44,6 @@ public:
 
     void setFinished(bool value);
 
-    bool getNeedResume();
-
-    Coroutine::ptr getCurrentCoroutine();
-
     google::protobuf::RpcController *getControllerPtr();
 
     google::protobuf::Message *getRequestPtr();
@@ -54,34 +52,19 @@ public:
 
     google::protobuf::Closure *getClosurePtr();
 
-    EventLoop *getEventLoop();
-
     IOThreadPool::ptr getIOThreadPool();
 
 private:
     PbRpcChannel::ptr rpcChannel_;
-    Coroutine::ptr pendingCor_;
-    Coroutine::ptr currentCor_{nullptr};
-    bool isFinished_{false};
-    bool needResume_{false};
+    std::atomic<bool> isFinished_{false};
     bool isPreSet_{false};
-    IOThreadPool::ptr ioPool_;
-    EventLoop *loop_{nullptr};
+    FutexEvent finishEvent_;
 
 private:
     conPtr controller_;
     msgPtr req_;
     msgPtr res_;
     cloPtr closure_;
-
-private:
-    void callMethod(const google::protobuf::MethodDescriptor *method,
-                    google::protobuf::RpcController *controller,
-                    const google::protobuf::Message *request,
-                    google::protobuf::Message *response,
-                    google::protobuf::Closure *done);
-    void stop(google::protobuf::Closure *done);
-    void waitCor();
 };
 
 }
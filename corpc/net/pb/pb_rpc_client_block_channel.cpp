@@ -10,30 +10,25 @@
 #include "corpc/common/log.h"
 #include "corpc/common/msg_seq.h"
 #include "corpc/common/runtime.h"
-#include "corpc/coroutine/coroutine_pool.h"
-#include "corpc/net/pb/pb_rpc_closure.h"
+#include "corpc/coroutine/coroutine.h"
+#include "corpc/net/mutex.h"
+#include "corpc/net/tcp/client_runtime.h"
 
 namespace corpc {
 
 PbRpcClientBlockChannel::PbRpcClientBlockChannel(NetAddress::ptr addr)
 {
-    Coroutine::getCurrentCoroutine();
     rpcChannel_ = std::make_shared<PbRpcChannel>(addr);
-    loop_ = corpc::EventLoop::getEventLoop();
-    loop_->setEventLoopType(SubLoop);
 }
 
 PbRpcClientBlockChannel::PbRpcClientBlockChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
 {
-    Coroutine::getCurrentCoroutine();
     rpcChannel_ = std::make_shared<PbRpcChannel>(addrs, loadBalance);
-    loop_ = corpc::EventLoop::getEventLoop();
-    loop_->setEventLoopType(SubLoop);
 }
 
-PbRpcClientBlockChannel::~PbRpcClientBlockChannel()
+PbRpcClientBlockChannel::PbRpcClientBlockChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
 {
-    getCoroutinePool()->returnCoroutine(cor_);
+    rpcChannel_ = std::make_shared<PbRpcChannel>(endpoints, loadBalance);
 }
 
 void PbRpcClientBlockChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
@@ -42,21 +37,23 @@ void PbRpcClientBlockChannel::CallMethod(const google::protobuf::MethodDescripto
                                 google::protobuf::Message *response,
                                 google::protobuf::Closure *done)
 {
-    std::shared_ptr<corpc::PbRpcClosure> closure = std::make_shared<corpc::PbRpcClosure>(std::bind(&PbRpcClientBlockChannel::stop, this, done)); 
-    cor_ = getCoroutinePool()->getCoroutineInstanse(); // 子协程
-    cor_->setCallBack(std::bind(&PbRpcChannel::CallMethod, rpcChannel_.get(), method, controller, request, response, closure.get()));
-    loop_->addCoroutine(cor_);
-    loop_->loop();
-}
+    if (!Coroutine::isMainCoroutine()) {
+        // 已经在协程中，直接调用，不需要切换线程
+        rpcChannel_->CallMethod(method, controller, request, response, done);
+        return;
+    }
+
+    std::shared_ptr<FutexEvent> finished = std::make_shared<FutexEvent>();
+    PbRpcChannel::ptr rpcChannel = rpcChannel_;
+    ClientRuntime::runInCoroutine([rpcChannel, finished, method, controller, request, response]() {
+        rpcChannel->CallMethod(method, controller, request, response, nullptr);
+        finished->set();
+    });
+    finished->wait();
 
-void PbRpcClientBlockChannel::stop(google::protobuf::Closure *done)
-{
     if (done) {
         done->Run();
     }
-    if (loop_) {
-        loop_->stop();
-    }
 }
 
 }
\ No newline at end of file
@@ -6,18 +6,18 @@
 #include <google/protobuf/service.h>
 #include "corpc/net/net_address.h"
 #include "corpc/net/pb/pb_rpc_channel.h"
-#include "corpc/net/event_loop.h"
-#include "corpc/coroutine/coroutine.h"
 #include "corpc/net/load_balance.h"
 
 namespace corpc {
 
+// 阻塞调用：在协程中直接执行调用，否则交给进程共享的客户端io线程执行，调用线程等待结果
 class PbRpcClientBlockChannel : public google::protobuf::RpcChannel {
 public:
     typedef std::shared_ptr<PbRpcClientBlockChannel> ptr;
     PbRpcClientBlockChannel(NetAddress::ptr addr);
     PbRpcClientBlockChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
-    ~PbRpcClientBlockChannel();
+    PbRpcClientBlockChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
+    ~PbRpcClientBlockChannel() = default;
 
     void CallMethod(const google::protobuf::MethodDescriptor *method,
                     google::protobuf::RpcController *controller,
@@ -27,11 +27,6 @@ public:
 
 private:
     PbRpcChannel::ptr rpcChannel_;
-    EventLoop *loop_{nullptr};
-    Coroutine::ptr cor_;
-
-private:
-    void stop(google::protobuf::Closure *done);
 };
 
 }
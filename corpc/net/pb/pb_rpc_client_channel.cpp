@@ -10,26 +10,25 @@
 #include "corpc/common/log.h"
 #include "corpc/common/msg_seq.h"
 #include "corpc/common/runtime.h"
-#include "corpc/coroutine/coroutine_pool.h"
+#include "corpc/net/tcp/client_runtime.h"
 
 namespace corpc {
 
-PbRpcClientChannel::PbRpcClientChannel(NetAddress::ptr addr)
+PbRpcClientChannel::PbRpcClientChannel(NetAddress::ptr addr) : waitSemaphore_(std::make_shared<FutexSemaphore>())
 {
-    int ret = sem_init(&waitSemaphore_, 0, 0);
-    assert(ret == 0);
     rpcChannel_ = std::make_shared<PbRpcChannel>(addr);
-    ioPool_ = std::make_shared<IOThreadPool>(1);
-    ioPool_->start();
 }
 
 PbRpcClientChannel::PbRpcClientChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
+    : waitSemaphore_(std::make_shared<FutexSemaphore>())
 {
-    int ret = sem_init(&waitSemaphore_, 0, 0);
-    assert(ret == 0);
     rpcChannel_ = std::make_shared<PbRpcChannel>(addrs, loadBalance);
-    ioPool_ = std::make_shared<IOThreadPool>(1);
-    ioPool_->start();
+}
+
+PbRpcClientChannel::PbRpcClientChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance/* = LoadBalanceCategory::Random*/)
+    : waitSemaphore_(std::make_shared<FutexSemaphore>())
+{
+    rpcChannel_ = std::make_shared<PbRpcChannel>(endpoints, loadBalance);
 }
 
 void PbRpcClientChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
@@ -38,24 +37,21 @@ void PbRpcClientChannel::CallMethod(const google::protobuf::MethodDescriptor *me
                                 google::protobuf::Message *response,
                                 google::protobuf::Closure *done)
 {
-    closure_ = std::make_shared<corpc::PbRpcClosure>(std::bind(&PbRpcClientChannel::stop, this, done));
-    Coroutine::ptr cor = getCoroutinePool()->getCoroutineInstanse(); // 子协程
-    IOThread *ioThread = ioPool_->getIOThread();
-    cor->setCallBack(std::bind(&PbRpcChannel::CallMethod, rpcChannel_.get(), method, controller, request, response, closure_.get()));
-    ioThread->getEventLoop()->addCoroutine(cor);
+    // 每次调用的状态都由回调自己持有，channel析构之后也不会访问已释放的对象
+    PbRpcChannel::ptr rpcChannel = rpcChannel_;
+    std::shared_ptr<FutexSemaphore> waitSemaphore = waitSemaphore_;
+    ClientRuntime::runInCoroutine([rpcChannel, waitSemaphore, method, controller, request, response, done]() {
+        rpcChannel->CallMethod(method, controller, request, response, nullptr);
+        if (done) {
+            done->Run();
+        }
+        waitSemaphore->post();
+    });
 }
 
 void PbRpcClientChannel::wait()
 {
-    sem_wait(&waitSemaphore_);
-}
-
-void PbRpcClientChannel::stop(google::protobuf::Closure *done)
-{
-    if (done) {
-        done->Run();
-    }
-    sem_post(&waitSemaphore_);
+    waitSemaphore_->wait();
 }
 
 }
\ No newline at end of file
@@ -6,18 +6,19 @@
 #include <google/protobuf/service.h>
 #include "corpc/net/net_address.h"
 #include "corpc/net/pb/pb_rpc_channel.h"
-#include "corpc/net/tcp/io_thread.h"
 #include "corpc/net/load_balance.h"
-#include "corpc/net/pb/pb_rpc_closure.h"
-#include <semaphore.h>
+#include "corpc/net/mutex.h"
 
 namespace corpc {
 
+// 非阻塞调用：调用在进程共享的客户端io线程中执行，结束后在io线程中执行done
+// wait()等待一次调用结束，同一个channel可以同时发起多个调用
 class PbRpcClientChannel : public google::protobuf::RpcChannel {
 public:
     typedef std::shared_ptr<PbRpcClientChannel> ptr;
     PbRpcClientChannel(NetAddress::ptr addr);
     PbRpcClientChannel(std::vector<NetAddress::ptr> addrs, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
+    PbRpcClientChannel(ServiceEndpoints::ptr endpoints, LoadBalanceCategory loadBalance = LoadBalanceCategory::Random);
     ~PbRpcClientChannel() = default;
 
     void CallMethod(const google::protobuf::MethodDescriptor *method,
@@ -30,12 +31,7 @@ public:
 
 private:
     PbRpcChannel::ptr rpcChannel_;
-    IOThreadPool::ptr ioPool_;
-    std::shared_ptr<corpc::PbRpcClosure> closure_;
-    sem_t waitSemaphore_;
-
-private:
-    void stop(google::protobuf::Closure *done);
+    std::shared_ptr<FutexSemaphore> waitSemaphore_;
 };
 
 }
@@ -4,7 +4,23 @@
 
 namespace corpc {
 
-void PbRpcController::Reset() {}
+void PbRpcController::Reset()
+{
+    errorCode_ = 0;
+    errorInfo_.clear();
+    msgSeq_.clear();
+    isFailed_ = false;
+    isCanceled_ = false;
+    peerAddr_.reset();
+    localAddr_.reset();
+    timeout_ = 5000;
+    methodName_.clear();
+    fullName_.clear();
+    maxRetry_ = 2;
+    hedge_ = false;
+    hedgeDelay_ = 0;
+    async_ = false;
+}
 
 bool PbRpcController::Failed() const
 {
@@ -99,6 +115,26 @@ int PbRpcController::MaxRetry() const
     return maxRetry_;
 }
 
+void PbRpcController::SetHedge(const bool hedge)
+{
+    hedge_ = hedge;
+}
+
+bool PbRpcController::Hedge() const
+{
+    return hedge_;
+}
+
+void PbRpcController::SetHedgeDelay(const int hedgeDelay)
+{
+    hedgeDelay_ = hedgeDelay;
+}
+
+int PbRpcController::HedgeDelay() const
+{
+    return hedgeDelay_;
+}
+
 void PbRpcController::SetMethodName(const std::string &name)
 {
     methodName_ = name;
@@ -119,4 +155,14 @@ std::string PbRpcController::GetMethodFullName()
     return fullName_;
 }
 
-}
\ No newline at end of file
+void PbRpcController::SetAsync(const bool async)
+{
+    async_ = async;
+}
+
+bool PbRpcController::IsAsync() const
+{
+    return async_;
+}
+
+}
@@ -48,12 +48,24 @@ public:
     void SetMaxRetry(const int maxRetry);
     int MaxRetry() const;
 
+    // 对冲请求：超过hedgeDelay还没有响应时，向另一个节点再发一次相同的请求，取先返回的结果
+    // 只能用于幂等的请求，hedgeDelay为0时使用该方法最近耗时的p95
+    void SetHedge(const bool hedge);
+    bool Hedge() const;
+    void SetHedgeDelay(const int hedgeDelay);
+    int HedgeDelay() const;
+
     void SetMethodName(const std::string &name);
     std::string GetMethodName();
 
     void SetMethodFullName(const std::string &name);
     std::string GetMethodFullName();
 
+    // 服务端：处理函数返回前调用SetAsync(true)，表示接管了done，之后在任意线程调用done->Run()时才回包
+    // 在done->Run()之前request、response和controller都保持有效
+    void SetAsync(const bool async);
+    bool IsAsync() const;
+
 private:
     int errorCode_{0};      // errorCode, identify one specific error
     std::string errorInfo_; // errorInfo, details description of error
@@ -68,6 +80,11 @@ private:
     std::string fullName_;   // full name, like server.method_name
 
     int maxRetry_{2};
+
+    bool hedge_{false};
+    int hedgeDelay_{0}; // ms
+
+    bool async_{false};
 };
 
 }
@@ -1,8 +1,15 @@
+#include <cstdlib>
+#include <atomic>
+#include <vector>
 #include <google/protobuf/message.h>
 #include <google/protobuf/service.h>
 #include <google/protobuf/descriptor.h>
+#include <google/protobuf/arena.h>
 
 #include "corpc/common/error_code.h"
+#include "corpc/common/config.h"
+#include "corpc/common/xxhash.h"
+#include "corpc/common/compress.h"
 #include "corpc/net/pb/pb_data.h"
 #include "corpc/net/pb/pb_rpc_dispatcher.h"
 #include "corpc/net/pb/pb_codec.h"
@@ -10,11 +17,167 @@
 #include "corpc/net/tcp/tcp_connection.h"
 #include "corpc/net/pb/pb_rpc_controller.h"
 #include "corpc/net/pb/pb_rpc_closure.h"
+#include "corpc/net/timer.h"
+#include "corpc/net/worker_pool.h"
 
 namespace corpc {
 
+extern corpc::Config::ptr gConfig;
+
+// arena的第一块内存放在调用上下文中，随上下文复用
+static const size_t ARENA_INITIAL_BLOCK_SIZE = 4096;
+// 每个线程缓存的空闲调用上下文个数上限
+static const size_t MAX_FREE_CALL_COUNT = 256;
+
 class TcpBuffer;
 
+// 一次pb调用的上下文，处理函数异步回包时在dispatch返回之后继续存在，直到done->Run()
+// 回包之后放回当前线程的空闲列表中复用，请求不多时处理过程中不需要分配内存
+class PbRpcCall {
+public:
+    enum State {
+        Calling = 0,  // 处理函数还没有返回
+        Done = 1,     // done->Run()在处理函数返回之前执行了，由dispatch回包
+        Deferred = 2, // 处理函数已经返回并且接管了done，由done->Run()回包
+    };
+
+    static PbRpcCall *get();
+    static void release(PbRpcCall *call);
+
+    PbRpcCall();
+
+    // 序列化响应，编码到连接的写缓冲区，然后回收上下文
+    void reply();
+
+    void onDone();
+
+public:
+    char arenaBlock[ARENA_INITIAL_BLOCK_SIZE];
+    google::protobuf::Arena arena;
+    bool useArena{false};
+
+    PbStruct replyPk;
+    PbRpcController controller;
+    PbRpcClosure closure;
+
+    TcpConnection::ptr conn;
+    EventLoop *loop{nullptr};
+    google::protobuf::Message *request{nullptr};
+    google::protobuf::Message *response{nullptr};
+    std::atomic<int> state{Calling};
+
+    // 通过准入控制之后设置，回包时归还并发额度
+    ConcurrencyLimiter *limiter{nullptr};
+    std::string clientIP;
+    int64_t startUs{0};
+};
+
+static google::protobuf::ArenaOptions getArenaOptions(char *block, size_t size)
+{
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block;
+    options.initial_block_size = size;
+    return options;
+}
+
+static thread_local std::vector<PbRpcCall *> *tFreeCalls = nullptr;
+
+PbRpcCall::PbRpcCall()
+    : arena(getArenaOptions(arenaBlock, sizeof(arenaBlock))), closure(std::bind(&PbRpcCall::onDone, this))
+{
+}
+
+PbRpcCall *PbRpcCall::get()
+{
+    if (!tFreeCalls) {
+        tFreeCalls = new std::vector<PbRpcCall *>();
+    }
+    if (tFreeCalls->empty()) {
+        return new PbRpcCall();
+    }
+    PbRpcCall *call = tFreeCalls->back();
+    tFreeCalls->pop_back();
+    return call;
+}
+
+void PbRpcCall::release(PbRpcCall *call)
+{
+    // 异步回包时可能在其他线程回收，放到回收线程的空闲列表中
+    if (call->useArena) {
+        call->arena.Reset();
+    }
+    else {
+        delete call->request;
+        delete call->response;
+    }
+    call->request = nullptr;
+    call->response = nullptr;
+    call->useArena = false;
+    call->replyPk = PbStruct();
+    call->controller.Reset();
+    call->conn.reset();
+    call->loop = nullptr;
+    call->state = Calling;
+    call->limiter = nullptr;
+
+    if (!tFreeCalls) {
+        tFreeCalls = new std::vector<PbRpcCall *>();
+    }
+    if (tFreeCalls->size() >= MAX_FREE_CALL_COUNT) {
+        delete call;
+        return;
+    }
+    tFreeCalls->push_back(call);
+}
+
+void PbRpcCall::reply()
+{
+    if (response && replyPk.errCode == 0) {
+        if (!(response->SerializeToString(&(replyPk.pbData)))) {
+            replyPk.pbData = "";
+            LOG_ERROR << replyPk.msgSeq << "|reply error! encode reply package error";
+            replyPk.errCode = ERROR_FAILED_SERIALIZE;
+            replyPk.errInfo = "failed to serilize relpy data";
+        }
+        else {
+            LOG_INFO << "Call [" << replyPk.serviceFullName << "] succ, now send reply package";
+            LOG_INFO << "============================================================";
+            LOG_INFO << replyPk.msgSeq << "|Set server response data:" << response->ShortDebugString();
+            LOG_INFO << "============================================================";
+        }
+    }
+    if (limiter) {
+        limiter->onFinish(replyPk.serviceFullName, clientIP, getNowUs() - startUs, replyPk.errCode == 0);
+    }
+    conn->encodeReply(dynamic_cast<AbstractData *>(&replyPk));
+    if (!replyPk.encodeSucc_ && !replyPk.pbData.empty()) {
+        // 回包超过pb_max_message_size，告诉客户端失败，不让它一直等到超时
+        LOG_ERROR << replyPk.msgSeq << "|reply error! reply package of " << replyPk.pbData.size() << " bytes is too large";
+        replyPk.pbData.clear();
+        replyPk.errCode = ERROR_FAILED_ENCODE;
+        replyPk.errInfo = "reply package is too large";
+        conn->encodeReply(dynamic_cast<AbstractData *>(&replyPk));
+    }
+    release(this);
+}
+
+void PbRpcCall::onDone()
+{
+    int expected = Calling;
+    if (state.compare_exchange_strong(expected, Done)) {
+        // 处理函数还没有返回，由dispatch回包
+        return;
+    }
+    // 异步回包，回到接收请求的io线程中编码并发送，回包顺序不一定和请求顺序一致，客户端通过msgSeq对应
+    PbRpcCall *call = this;
+    loop->runInCoroutine([call]() {
+        TcpConnection::ptr conn = call->conn;
+        LOG_INFO << "async reply client pb request, msgno=" << call->replyPk.msgSeq;
+        call->reply();
+        conn->output();
+    });
+}
+
 void PbRpcDispacther::dispatch(AbstractData *data, const TcpConnection::ptr &conn)
 {
     PbStruct *temp = dynamic_cast<PbStruct *>(data);
@@ -23,61 +186,142 @@ void PbRpcDispacther::dispatch(AbstractData *data, const TcpConnection::ptr &con
         LOG_ERROR << "dynamic_cast error";
         return;
     }
-    Coroutine::getCurrentCoroutine()->getRunTime()->msgNo_ = temp->msgSeq;
-    setCurrentRunTime(Coroutine::getCurrentCoroutine()->getRunTime());
+    RunTime *runtime = Coroutine::getCurrentCoroutine()->resetRunTime();
+    runtime->msgNo_ = temp->msgSeq;
 
     LOG_INFO << "begin to dispatch client tinypb request, msgno=" << temp->msgSeq;
 
-    std::string serviceName;
-    std::string methodName;
+    // 客户端带上了剩余的超时时间，从收到请求时开始计算截止时间
+    auto timeoutIt = temp->meta.find("timeout");
+    if (timeoutIt != temp->meta.end()) {
+        int64_t timeout = std::atoll(timeoutIt->second.c_str());
+        if (timeout > 0) {
+            runtime->deadline_ = temp->recvTime_ + timeout;
+        }
+    }
 
-    PbStruct replyPk;
+    // v2的请求只带方法id，先找到方法名，后面的日志和限流都按方法名处理
+    const MethodEntry *entry = nullptr;
+    if (temp->serviceFullName.empty() && temp->methodId != 0) {
+        entry = findMethod(temp->methodId);
+        if (entry) {
+            temp->serviceFullName = entry->method->full_name();
+        }
+    }
+    else {
+        entry = findMethod(temp->serviceFullName);
+    }
+
+    PbRpcCall *call = PbRpcCall::get();
+    call->conn = conn;
+    call->loop = EventLoop::getEventLoop();
+
+    PbStruct &replyPk = call->replyPk;
     replyPk.serviceFullName = temp->serviceFullName;
     replyPk.msgSeq = temp->msgSeq;
     if (replyPk.msgSeq.empty()) {
         replyPk.msgSeq = MsgSeqUtil::genMsgNumber();
     }
+    // 按请求的格式回包，v1请求中带了proto=2时告诉客户端后面的请求可以用v2格式
+    replyPk.protoVersion = temp->protoVersion;
+    replyPk.isReply = true;
+    auto protoIt = temp->meta.find("proto");
+    if (temp->protoVersion < 2 && protoIt != temp->meta.end() && std::atoi(protoIt->second.c_str()) >= 2 && gConfig->pbProtocolVersion >= 2) {
+        replyPk.meta["proto"] = "2";
+        // 客户端要求v2的包带上校验
+        auto checksumIt = temp->meta.find("checksum");
+        if (checksumIt != temp->meta.end() && checksumIt->second == "crc32c") {
+            replyPk.meta["checksum"] = "crc32c";
+        }
+        // 客户端要压缩时告诉它服务端支持的压缩算法
+        if (temp->meta.find("compress") != temp->meta.end()) {
+            replyPk.meta["compress"] = Compressor::getNames();
+        }
+    }
+    replyPk.withChecksum = temp->withChecksum;
+    // 用客户端接受的算法压缩回包，可以按方法关闭
+    if (temp->compressType != COMPRESS_NONE && Compressor::get(temp->compressType)) {
+        auto it = gConfig->compressMethods.find(temp->serviceFullName);
+        if (it == gConfig->compressMethods.end() || it->second != "none") {
+            replyPk.compressType = temp->compressType;
+        }
+    }
 
-    if (!parseServiceFullName(temp->serviceFullName, serviceName, methodName)) {
-        LOG_ERROR << replyPk.msgSeq << "|parse service full name " << temp->serviceFullName << "error";
+    // 关闭了v2的服务端不处理v2的包，按v1回复解码错误，客户端收到后回退到v1重新发送
+    if (temp->protoVersion >= 2 && gConfig->pbProtocolVersion < 2) {
+        replyPk.protoVersion = 1;
+        replyPk.withChecksum = false;
+        replyPk.compressType = COMPRESS_NONE;
+        if (replyPk.serviceFullName.empty()) {
+            replyPk.serviceFullName = "unknown";
+        }
+        replyPk.errCode = ERROR_FAILED_DECODE;
+        replyPk.errInfo = "v2 pb frame is disabled on server";
+        LOG_ERROR << replyPk.msgSeq << "|" << replyPk.errInfo;
+        call->reply();
+        return;
+    }
 
-        replyPk.errCode = ERROR_PARSE_SERVICE_FULL_NAME;
-        std::stringstream ss;
-        ss << "cannot parse service full name:[" << temp->serviceFullName << "]";
-        replyPk.errInfo = ss.str();
-        conn->getCodec()->encode(conn->getOutBuffer(), dynamic_cast<AbstractData *>(&replyPk));
+    if (temp->errCode == ERROR_CHECKSUM_MISMATCH || temp->errCode == ERROR_FAILED_DECOMPRESS) {
+        replyPk.errCode = temp->errCode;
+        replyPk.errInfo = temp->errInfo;
+        LOG_ERROR << replyPk.msgSeq << "|" << replyPk.errInfo;
+        call->reply();
         return;
     }
 
-    Coroutine::getCurrentCoroutine()->getRunTime()->interfaceName_ = temp->serviceFullName;
-    auto it = serviceMap_.find(serviceName);
-    if (it == serviceMap_.end() || !(it->second)) {
-        replyPk.errCode = ERROR_SERVICE_NOT_FOUND;
+    // 客户端已经放弃了这个请求，不再处理
+    int64_t now = getNowMs();
+    if (runtime->deadline_ > 0 && now >= runtime->deadline_) {
+        replyPk.errCode = ERROR_RPC_DEADLINE_EXCEEDED;
         std::stringstream ss;
-        ss << "not found service name:[" << serviceName << "]";
-        LOG_ERROR << replyPk.msgSeq << "|" << ss.str();
+        ss << "deadline exceeded " << now - runtime->deadline_ << " ms before call [" << temp->serviceFullName << "]";
         replyPk.errInfo = ss.str();
-
-        conn->getCodec()->encode(conn->getOutBuffer(), dynamic_cast<AbstractData *>(&replyPk));
-
-        LOG_INFO << "end dispatch client pb request, msgno=" << temp->msgSeq;
+        LOG_ERROR << replyPk.msgSeq << "|" << ss.str();
+        call->reply();
         return;
     }
 
-    servicePtr service = it->second;
-
-    const google::protobuf::MethodDescriptor *method = service->GetDescriptor()->FindMethodByName(methodName);
-    if (!method) {
+    runtime->interfaceName_ = temp->serviceFullName;
+    if (!entry && temp->serviceFullName.empty()) {
         replyPk.errCode = ERROR_METHOD_NOT_FOUND;
-        std::stringstream ss;
-        ss << "not found method name:[" << methodName << "]";
-        LOG_ERROR << replyPk.msgSeq << "|" << ss.str();
-        replyPk.errInfo = ss.str();
-        conn->getCodec()->encode(conn->getOutBuffer(), dynamic_cast<AbstractData *>(&replyPk));
+        replyPk.errInfo = "not found method id:[" + std::to_string(temp->methodId) + "]";
+        LOG_ERROR << replyPk.msgSeq << "|" << replyPk.errInfo;
+        call->reply();
+        return;
+    }
+    if (!entry) {
+        setNotFoundError(temp->serviceFullName, replyPk);
+        call->reply();
+        LOG_INFO << "end dispatch client pb request, msgno=" << temp->msgSeq;
         return;
     }
 
-    google::protobuf::Message *request = service->GetRequestPrototype(method).New();
+    // 超过并发限制时直接拒绝，不解析请求
+    if (limiter_) {
+        std::string clientIP = ConcurrencyLimiter::getClientIP(conn->getPeerAddr());
+        if (!limiter_->onRequest(temp->serviceFullName, clientIP)) {
+            replyPk.errCode = ERROR_SERVER_OVERLOADED;
+            replyPk.errInfo = "server overloaded, reject call [" + temp->serviceFullName + "]";
+            // 拒绝日志由limiter按间隔汇总
+            LOG_DEBUG << replyPk.msgSeq << "|" << replyPk.errInfo;
+            call->reply();
+            return;
+        }
+        call->limiter = limiter_.get();
+        call->clientIP = clientIP;
+        call->startUs = getNowUs();
+    }
+
+    const servicePtr &service = entry->service;
+    const google::protobuf::MethodDescriptor *method = entry->method;
+
+    // 请求和响应分配在这次调用的arena上，嵌套的字段不再单独分配，回包之后一次释放
+    call->useArena = gConfig->pbArena;
+    google::protobuf::Arena *arenaPtr = call->useArena ? &call->arena : nullptr;
+
+    google::protobuf::Message *request = entry->requestPrototype->New(arenaPtr);
+    call->request = request;
     LOG_DEBUG << replyPk.msgSeq << "|request.name = " << request->GetDescriptor()->full_name();
 
     if (!request->ParseFromString(temp->pbData)) {
@@ -86,8 +330,7 @@ void PbRpcDispacther::dispatch(AbstractData *data, const TcpConnection::ptr &con
         ss << "faild to parse request data, request.name:[" << request->GetDescriptor()->full_name() << "]";
         replyPk.errInfo = ss.str();
         LOG_ERROR << replyPk.msgSeq << "|" << ss.str();
-        delete request;
-        conn->getCodec()->encode(conn->getOutBuffer(), dynamic_cast<AbstractData *>(&replyPk));
+        call->reply();
         return;
     }
 
@@ -95,38 +338,46 @@ void PbRpcDispacther::dispatch(AbstractData *data, const TcpConnection::ptr &con
     LOG_INFO << replyPk.msgSeq << "|Get client request data:" << request->ShortDebugString();
     LOG_INFO << "============================================================";
 
-    google::protobuf::Message *response = service->GetResponsePrototype(method).New();
+    google::protobuf::Message *response = entry->responsePrototype->New(arenaPtr);
+    call->response = response;
 
     LOG_DEBUG << replyPk.msgSeq << "|response.name = " << response->GetDescriptor()->full_name();
 
-    PbRpcController rpcController;
+    PbRpcController &rpcController = call->controller;
     rpcController.SetMsgSeq(replyPk.msgSeq);
-    rpcController.SetMethodName(methodName);
+    rpcController.SetMethodName(entry->methodName);
     rpcController.SetMethodFullName(temp->serviceFullName);
+    if (runtime->deadline_ > 0) {
+        // 业务可以通过Timeout()获取剩余时间，下游调用也会继承这个截止时间
+        rpcController.SetTimeout(runtime->deadline_ - now);
+    }
 
-    std::function<void()> replyPackageFunc = []() {};
-
-    PbRpcClosure closure(replyPackageFunc);
-    service->CallMethod(method, &rpcController, request, response, &closure);
-
-    LOG_INFO << "Call [" << replyPk.serviceFullName << "] succ, now send reply package";
-
-    if (!(response->SerializeToString(&(replyPk.pbData)))) {
-        replyPk.pbData = "";
-        LOG_ERROR << replyPk.msgSeq << "|reply error! encode reply package error";
-        replyPk.errCode = ERROR_FAILED_SERIALIZE;
-        replyPk.errInfo = "failed to serilize relpy data";
+    bool isCalled = true;
+    if (entry->runInWorker && workerPool_) {
+        // 在业务线程池中执行，当前协程挂起，执行完之后回到io线程编码回包
+        isCalled = workerPool_->run([&]() {
+            service->CallMethod(method, &rpcController, request, response, &call->closure);
+        });
     }
     else {
-        LOG_INFO << "============================================================";
-        LOG_INFO << replyPk.msgSeq << "|Set server response data:" << response->ShortDebugString();
-        LOG_INFO << "============================================================";
+        service->CallMethod(method, &rpcController, request, response, &call->closure);
     }
 
-    delete request;
-    delete response;
+    if (!isCalled) {
+        replyPk.errCode = ERROR_WORKER_QUEUE_FULL;
+        replyPk.errInfo = "worker pool queue is full, reject call [" + temp->serviceFullName + "]";
+        LOG_ERROR << replyPk.msgSeq << "|" << replyPk.errInfo;
+        call->reply();
+        return;
+    }
 
-    conn->getCodec()->encode(conn->getOutBuffer(), dynamic_cast<AbstractData *>(&replyPk));
+    // 处理函数接管了done并且还没有调用，等done->Run()时再回包，当前连接可以继续处理后面的请求
+    int expected = PbRpcCall::Calling;
+    if (rpcController.IsAsync() && call->state.compare_exchange_strong(expected, PbRpcCall::Deferred)) {
+        LOG_INFO << "deferred reply client pb request, msgno=" << temp->msgSeq;
+        return;
+    }
+    call->reply();
 }
 
 bool PbRpcDispacther::parseServiceFullName(const std::string &fullName, std::string &serviceName, std::string &methodName)
@@ -150,11 +401,81 @@ bool PbRpcDispacther::parseServiceFullName(const std::string &fullName, std::str
     return true;
 }
 
-void PbRpcDispacther::registerService(servicePtr service)
+void PbRpcDispacther::setNotFoundError(const std::string &fullName, PbStruct &replyPk)
 {
-    std::string serviceName = service->GetDescriptor()->full_name();
+    std::string serviceName;
+    std::string methodName;
+    std::stringstream ss;
+    if (!parseServiceFullName(fullName, serviceName, methodName)) {
+        replyPk.errCode = ERROR_PARSE_SERVICE_FULL_NAME;
+        ss << "cannot parse service full name:[" << fullName << "]";
+    }
+    else if (serviceMap_.find(serviceName) == serviceMap_.end()) {
+        replyPk.errCode = ERROR_SERVICE_NOT_FOUND;
+        ss << "not found service name:[" << serviceName << "]";
+    }
+    else {
+        replyPk.errCode = ERROR_METHOD_NOT_FOUND;
+        ss << "not found method name:[" << methodName << "]";
+    }
+    replyPk.errInfo = ss.str();
+    LOG_ERROR << replyPk.msgSeq << "|" << replyPk.errInfo;
+}
+
+bool PbRpcDispacther::registerService(servicePtr service, const std::vector<std::string> &workerMethods/* = std::vector<std::string>()*/)
+{
+    const google::protobuf::ServiceDescriptor *descriptor = service->GetDescriptor();
+    std::string serviceName = descriptor->full_name();
     serviceMap_[serviceName] = service;
+
+    for (int i = 0; i < descriptor->method_count(); ++i) {
+        const google::protobuf::MethodDescriptor *method = descriptor->method(i);
+        MethodEntry &entry = methodMap_[method->full_name()];
+        entry.service = service;
+        entry.method = method;
+        entry.requestPrototype = &service->GetRequestPrototype(method);
+        entry.responsePrototype = &service->GetResponsePrototype(method);
+        entry.methodName = method->name();
+        entry.methodId = getMethodId(method->full_name());
+
+        auto it = methodIdMap_.find(entry.methodId);
+        if (it != methodIdMap_.end() && it->second != &entry) {
+            LOG_ERROR << "method id of [" << method->full_name() << "] conflicts with [" << it->second->method->full_name() << "]";
+            continue;
+        }
+        methodIdMap_[entry.methodId] = &entry;
+    }
+
+    for (auto &i : workerMethods) {
+        auto it = methodMap_.find(serviceName + "." + i);
+        if (it == methodMap_.end()) {
+            LOG_ERROR << "register service[" << serviceName << "] error, not found worker method[" << i << "]";
+            return false;
+        }
+        it->second.runInWorker = true;
+        if (!workerPool_) {
+            LOG_WARN << "method[" << it->first << "] should run in worker pool, but worker pool isn't configured, run in io thread";
+        }
+    }
     LOG_INFO << "succ register service[" << serviceName << "]!";
+    return true;
+}
+
+const PbRpcDispacther::MethodEntry *PbRpcDispacther::findMethod(const std::string &fullName) const
+{
+    auto it = methodMap_.find(fullName);
+    return it == methodMap_.end() ? nullptr : &it->second;
+}
+
+const PbRpcDispacther::MethodEntry *PbRpcDispacther::findMethod(uint64_t methodId) const
+{
+    auto it = methodIdMap_.find(methodId);
+    return it == methodIdMap_.end() ? nullptr : it->second;
+}
+
+uint64_t PbRpcDispacther::getMethodId(const std::string &fullName)
+{
+    return xxHash64(fullName);
 }
 
 }
\ No newline at end of file
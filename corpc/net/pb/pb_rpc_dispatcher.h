@@ -5,10 +5,13 @@
 #include <google/protobuf/service.h>
 #include <google/protobuf/descriptor.h>
 #include <map>
+#include <unordered_map>
 #include <memory>
+#include <vector>
 
 #include "corpc/net/abstract_dispatcher.h"
 #include "corpc/net/pb/pb_data.h"
+#include "corpc/net/worker_pool.h"
 
 namespace corpc {
 
@@ -16,17 +19,48 @@ class PbRpcDispacther : public AbstractDispatcher {
 public:
     typedef std::shared_ptr<google::protobuf::Service> servicePtr;
 
+    // 注册服务时预先计算好的方法信息，处理请求时只需要一次查找，不需要解析方法名和分配内存
+    struct MethodEntry {
+        servicePtr service;
+        const google::protobuf::MethodDescriptor *method{nullptr};
+        const google::protobuf::Message *requestPrototype{nullptr};
+        const google::protobuf::Message *responsePrototype{nullptr};
+        std::string methodName;
+        uint64_t methodId{0};
+        bool runInWorker{false}; // 在业务线程池中执行
+    };
+
     PbRpcDispacther() = default;
     ~PbRpcDispacther() = default;
 
     void dispatch(AbstractData *data, const TcpConnection::ptr &conn) override;
     bool parseServiceFullName(const std::string &fullName, std::string &serviceName, std::string &methodName);
-    void registerService(servicePtr service);
+    // workerMethods中的方法在业务线程池中执行，方法不存在时返回false
+    bool registerService(servicePtr service, const std::vector<std::string> &workerMethods = std::vector<std::string>());
+    void setWorkerPool(WorkerPool::ptr pool) { workerPool_ = pool; }
+
+    // 按service.method查找，找不到返回nullptr
+    const MethodEntry *findMethod(const std::string &fullName) const;
+    // 按方法id查找，找不到返回nullptr
+    const MethodEntry *findMethod(uint64_t methodId) const;
+
+    // 方法的数字id，由service.method计算得到，客户端和服务端不需要协商就能得到相同的id
+    static uint64_t getMethodId(const std::string &fullName);
+
+private:
+    // 找不到方法时，区分是方法名格式错误、服务不存在还是方法不存在
+    void setNotFoundError(const std::string &fullName, PbStruct &replyPk);
 
 public:
     // all services should be registerd on there before progress start
     // key: service_name
     std::map<std::string, servicePtr> serviceMap_;
+
+private:
+    // key: service.method
+    std::unordered_map<std::string, MethodEntry> methodMap_;
+    std::unordered_map<uint64_t, const MethodEntry*> methodIdMap_;
+    WorkerPool::ptr workerPool_;
 };
 
 }
@@ -0,0 +1,137 @@
+#include "corpc/net/pb/pb_rpc_future.h"
+#include "corpc/net/timer.h"
+#include "corpc/common/log.h"
+#include "corpc/coroutine/coroutine.h"
+#include "corpc/net/mutex.h"
+
+namespace corpc {
+
+// 正在等待的协程或线程，被唤醒或者超时之后不再有效
+// 调用可能在其他io线程中结束，remain和active会被并发访问
+struct FutureWaiter {
+    typedef std::shared_ptr<FutureWaiter> ptr;
+    Coroutine *cor{nullptr};
+    EventLoop *loop{nullptr}; // 为空时表示在线程中等待
+    FutexEvent event;
+    std::atomic<bool> active{false};
+    std::atomic<size_t> remain{0}; // 还需要等待结束的调用数
+
+    // 一个调用结束，返回是否需要唤醒等待者
+    bool finishOne()
+    {
+        size_t now = remain.load(std::memory_order_acquire);
+        while (now > 0) {
+            if (remain.compare_exchange_weak(now, now - 1, std::memory_order_acq_rel)) {
+                return now == 1;
+            }
+        }
+        return false;
+    }
+};
+
+// 等待futures中至少need个调用结束
+static bool waitFutures(const std::vector<RpcFutureBase::ptr> &futures, size_t need, int64_t timeoutMs)
+{
+    size_t ready = 0;
+    for (const auto &future : futures) {
+        if (future->isReady()) {
+            ready++;
+        }
+    }
+    if (ready >= need) {
+        return true;
+    }
+
+    FutureWaiter::ptr waiter = std::make_shared<FutureWaiter>();
+    if (!Coroutine::isMainCoroutine()) {
+        waiter->cor = Coroutine::getCurrentCoroutine();
+        waiter->loop = EventLoop::getEventLoop();
+    }
+    waiter->remain = need - ready;
+    waiter->active = true;
+
+    for (const auto &future : futures) {
+        if (future->isReady()) {
+            continue;
+        }
+        // 调用结束时在调用所在的协程中执行，需要回到等待者所在io线程的主协程再唤醒等待的协程
+        future->then([waiter]() {
+            if (!waiter->active || !waiter->finishOne()) {
+                return;
+            }
+            if (!waiter->loop) {
+                waiter->event.set();
+                return;
+            }
+            waiter->loop->addTask([waiter]() {
+                if (waiter->active) {
+                    Coroutine::resume(waiter->cor);
+                }
+            });
+        });
+    }
+
+    if (!waiter->loop) {
+        bool finished = waiter->event.wait(timeoutMs);
+        waiter->active = false;
+        return finished || waiter->remain == 0;
+    }
+
+    CoTimeout timeout(timeoutMs);
+    while (waiter->remain > 0 && !timeout.isTimeout()) {
+        Coroutine::yield();
+    }
+    // 之后投递的唤醒任务不会再恢复当前协程
+    waiter->active = false;
+    return waiter->remain == 0;
+}
+
+bool RpcFutureBase::wait(int64_t timeoutMs/* = 0*/)
+{
+    return waitFutures({shared_from_this()}, 1, timeoutMs);
+}
+
+void RpcFutureBase::then(std::function<void()> cb)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!done_) {
+            callbacks_.push_back(cb);
+            return;
+        }
+    }
+    cb();
+}
+
+void RpcFutureBase::setDone()
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.store(true, std::memory_order_release);
+        callbacks.swap(callbacks_);
+    }
+    for (auto &cb : callbacks) {
+        cb();
+    }
+}
+
+bool whenAll(const std::vector<RpcFutureBase::ptr> &futures, int64_t timeoutMs/* = 0*/)
+{
+    return waitFutures(futures, futures.size(), timeoutMs);
+}
+
+int whenAny(const std::vector<RpcFutureBase::ptr> &futures, int64_t timeoutMs/* = 0*/)
+{
+    if (futures.empty() || !waitFutures(futures, 1, timeoutMs)) {
+        return -1;
+    }
+    for (size_t i = 0; i < futures.size(); ++i) {
+        if (futures[i]->isReady()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+}
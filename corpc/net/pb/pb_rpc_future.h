@@ -0,0 +1,105 @@
+#ifndef CORPC_NET_PB_PB_RPC_FUTURE_H
+#define CORPC_NET_PB_PB_RPC_FUTURE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <google/protobuf/service.h>
+#include <google/protobuf/message.h>
+#include "corpc/net/pb/pb_rpc_channel.h"
+#include "corpc/net/pb/pb_rpc_controller.h"
+#include "corpc/net/event_loop.h"
+#include "corpc/net/tcp/io_thread.h"
+#include "corpc/net/tcp/client_runtime.h"
+
+namespace corpc {
+
+// 异步调用的结果，在io线程中发起时调用在当前io线程的新协程中执行，不会切换线程
+// 在其他线程中发起时调用在客户端io线程中执行，可以在任意线程中等待
+class RpcFutureBase : public std::enable_shared_from_this<RpcFutureBase> {
+public:
+    typedef std::shared_ptr<RpcFutureBase> ptr;
+
+    explicit RpcFutureBase(PbRpcController::ptr controller) : controller_(controller) {}
+    virtual ~RpcFutureBase() = default;
+
+    bool isReady() const { return done_.load(std::memory_order_acquire); }
+
+    // 等待调用结束，timeoutMs <= 0 时一直等待，超时返回false
+    // 在协程中等待时挂起当前协程，否则阻塞当前线程
+    // 等待超时不会取消调用，调用本身的超时由controller控制
+    bool wait(int64_t timeoutMs = 0);
+
+    PbRpcController *controller() { return controller_.get(); }
+
+    // 调用结束后执行cb，已经结束时立即执行
+    void then(std::function<void()> cb);
+
+    void setDone();
+
+private:
+    PbRpcController::ptr controller_;
+    std::atomic<bool> done_{false};
+    std::mutex mutex_;
+    std::vector<std::function<void()>> callbacks_;
+};
+
+template <class Response>
+class RpcFuture : public RpcFutureBase {
+public:
+    typedef std::shared_ptr<RpcFuture<Response>> ptr;
+
+    explicit RpcFuture(PbRpcController::ptr controller) : RpcFutureBase(controller) {}
+    ~RpcFuture() = default;
+
+    Response &value() { return response_; }
+    Response *response() { return &response_; }
+
+private:
+    Response response_;
+};
+
+// 等待所有调用结束，不管有多少个调用，当前协程只挂起一次，超时返回false
+bool whenAll(const std::vector<RpcFutureBase::ptr> &futures, int64_t timeoutMs = 0);
+
+// 等待任意一个调用结束，返回它的下标，超时返回-1
+int whenAny(const std::vector<RpcFutureBase::ptr> &futures, int64_t timeoutMs = 0);
+
+template <class Future>
+bool whenAll(const std::vector<std::shared_ptr<Future>> &futures, int64_t timeoutMs = 0)
+{
+    return whenAll(std::vector<RpcFutureBase::ptr>(futures.begin(), futures.end()), timeoutMs);
+}
+
+template <class Future>
+int whenAny(const std::vector<std::shared_ptr<Future>> &futures, int64_t timeoutMs = 0)
+{
+    return whenAny(std::vector<RpcFutureBase::ptr>(futures.begin(), futures.end()), timeoutMs);
+}
+
+// 发起异步调用，比如：
+// RpcFuture<queryNameRes>::ptr future = asyncCall(channel, &QueryService_Stub::query_name, request);
+// future->wait();
+template <class Stub, class Request, class Response>
+typename RpcFuture<Response>::ptr asyncCall(PbRpcChannel::ptr channel,
+        void (Stub::*method)(google::protobuf::RpcController *, const Request *, Response *, google::protobuf::Closure *),
+        const Request &request, PbRpcController::ptr controller = nullptr)
+{
+    if (!controller) {
+        controller = std::make_shared<PbRpcController>();
+    }
+    typename RpcFuture<Response>::ptr future = std::make_shared<RpcFuture<Response>>(controller);
+    EventLoop *loop = IOThread::getCurrentIOThread() ? EventLoop::getEventLoop() : ClientRuntime::getEventLoop();
+    loop->runInCoroutine([channel, method, request, future]() {
+        Stub stub(channel.get());
+        (stub.*method)(future->controller(), &request, future->response(), nullptr);
+        future->setDone();
+    });
+    return future;
+}
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include "corpc/net/reactor.h"
+#include "corpc/net/io_uring_reactor.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+Reactor *Reactor::create(bool useIoUring)
+{
+    if (useIoUring) {
+        IoUringReactor *reactor = new IoUringReactor();
+        if (reactor->init()) {
+            return reactor;
+        }
+        delete reactor;
+        LOG_WARN << "io_uring is unavailable on this kernel, fall back to epoll";
+    }
+    return new EpollReactor();
+}
+
+EpollReactor::EpollReactor()
+{
+    if ((epfd_ = epoll_create(1)) <= 0) {
+        LOG_FATAL << "start server error. epoll_create error, sys error=" << strerror(errno);
+    }
+    else {
+        LOG_DEBUG << "epfd_ = " << epfd_;
+    }
+}
+
+EpollReactor::~EpollReactor()
+{
+    close(epfd_);
+}
+
+bool EpollReactor::addEvent(int fd, epoll_event event, bool isMod)
+{
+    int op = isMod ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epfd_, op, fd, &event) != 0) {
+        LOG_ERROR << "epoll_ctl error, fd[" << fd << "], sys errinfo = " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool EpollReactor::delEvent(int fd)
+{
+    if (epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr) != 0) {
+        LOG_ERROR << "epoll_ctl error, fd[" << fd << "], sys errinfo = " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+int EpollReactor::wait(std::vector<epoll_event> &events, int timeoutMs)
+{
+    const int MAX_EVENTS = 10;
+    events.resize(MAX_EVENTS);
+    int ret = epoll_wait(epfd_, events.data(), MAX_EVENTS, timeoutMs);
+    if (ret < 0) {
+        LOG_ERROR << "epoll_wait error, skip, errno=" << strerror(errno);
+    }
+    return ret;
+}
+
+}
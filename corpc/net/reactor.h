@@ -0,0 +1,77 @@
+#ifndef CORPC_NET_REACTOR_H
+#define CORPC_NET_REACTOR_H
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace corpc {
+
+class Coroutine;
+
+// 直接交给reactor执行的一次io，完成之后唤醒发起的协程
+struct IoOp {
+    enum Type {
+        Recv = 1,
+        Send = 2,
+        Accept = 3,
+    };
+
+    IoOp(Type t, int f, void *b, size_t l, int fl = 0) : type(t), fd(f), buf(b), len(l), flags(fl) {}
+
+    Type type;
+    int fd{-1};
+    void *buf{nullptr};
+    size_t len{0};
+    int flags{0};
+    sockaddr *addr{nullptr};     // accept
+    socklen_t *addrlen{nullptr}; // accept
+
+    Coroutine *cor{nullptr};
+    ssize_t res{0}; // 失败时为-errno
+    bool done{false};
+};
+
+// 事件循环使用的多路复用器，每个事件循环一个，只在事件循环所在的线程中使用
+class Reactor {
+public:
+    virtual ~Reactor() {}
+
+    // 注册或者修改fd关注的事件，event.data原样返回
+    virtual bool addEvent(int fd, epoll_event event, bool isMod) = 0;
+
+    virtual bool delEvent(int fd) = 0;
+
+    // 等待就绪事件，返回就绪的个数，出错返回-1
+    virtual int wait(std::vector<epoll_event> &events, int timeoutMs) = 0;
+
+    // 提交io并挂起当前协程直到io完成，结果保存在op.res中
+    // 被提前唤醒（比如超时）时会取消这次io，等取消完成后再返回，op.res为-ECANCELED
+    // 不支持直接提交io时返回false，调用方需要等待fd就绪再自己完成io
+    virtual bool submitIO(IoOp &) { return false; }
+
+    virtual const char *name() const = 0;
+
+public:
+    // 创建失败时退回epoll
+    static Reactor *create(bool useIoUring);
+};
+
+class EpollReactor : public Reactor {
+public:
+    EpollReactor();
+    ~EpollReactor();
+
+    bool addEvent(int fd, epoll_event event, bool isMod) override;
+    bool delEvent(int fd) override;
+    int wait(std::vector<epoll_event> &events, int timeoutMs) override;
+    const char *name() const override { return "epoll"; }
+
+private:
+    int epfd_{-1};
+};
+
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <functional>
 #include <google/protobuf/service.h>
 #include <google/protobuf/descriptor.h>
 #include "corpc/net/register/zk_service_register.h"
@@ -6,12 +7,13 @@ namespace corpc {
 
 static const char *ROOT_PATH = "/corpc";
 
-ZkServiceRegister::ZkServiceRegister()
+ZkServiceRegister::ZkServiceRegister() : cache_(std::bind(&ZkServiceRegister::fetchService, this, std::placeholders::_1))
 {
     init();
 }
 
-ZkServiceRegister::ZkServiceRegister(const std::string &ip, int port, int timeout) : zkCli_(ip, port, timeout)
+ZkServiceRegister::ZkServiceRegister(const std::string &ip, int port, int timeout)
+    : zkCli_(ip, port, timeout), cache_(std::bind(&ZkServiceRegister::fetchService, this, std::placeholders::_1))
 {
     init();
 }
@@ -19,6 +21,9 @@ ZkServiceRegister::ZkServiceRegister(const std::string &ip, int port, int timeou
 void ZkServiceRegister::init()
 {
     zkCli_.closeLog();
+    zkCli_.setChildrenListener(std::bind(&ZkServiceRegister::onChildrenChanged, this, std::placeholders::_1, std::placeholders::_2));
+    // 会话重建后重新拉取所有订阅过的服务，拉取时会重新设置watcher
+    zkCli_.setReconnectListener(std::bind(&ServiceDiscoveryCache::reloadAll, &cache_));
     // 启动zkclient客户端
     zkCli_.start();
     // 加入根节点
@@ -52,15 +57,40 @@ void ZkServiceRegister::registerService(std::shared_ptr<CustomService> service,
 }
 
 std::vector<NetAddress::ptr> ZkServiceRegister::discoverService(const std::string &serviceName)
+{
+    return cache_.get(serviceName)->snapshot()->addrs;
+}
+
+ServiceEndpoints::ptr ZkServiceRegister::subscribeService(const std::string &serviceName)
+{
+    return cache_.get(serviceName);
+}
+
+std::vector<NetAddress::ptr> ZkServiceRegister::fetchService(const std::string &serviceName)
 {
     std::string servicePath = ROOT_PATH;
     servicePath += "/" + serviceName;
-    std::vector<std::string> strNodes = zkCli_.getChildrenNodes(servicePath);
-    std::vector<NetAddress::ptr> nodes;
-    for (const auto &node : strNodes) {
-        nodes.push_back(std::make_shared<corpc::IPAddress>(node));
+    return toAddrs(zkCli_.getChildrenNodes(servicePath));
+}
+
+void ZkServiceRegister::onChildrenChanged(const std::string &path, const std::vector<std::string> &children)
+{
+    // path: /corpc/serviceName
+    std::string prefix = ROOT_PATH;
+    prefix += "/";
+    if (path.compare(0, prefix.size(), prefix) != 0) {
+        return;
+    }
+    cache_.refresh(path.substr(prefix.size()), toAddrs(children));
+}
+
+std::vector<NetAddress::ptr> ZkServiceRegister::toAddrs(const std::vector<std::string> &nodes)
+{
+    std::vector<NetAddress::ptr> addrs;
+    for (const auto &node : nodes) {
+        addrs.push_back(std::make_shared<corpc::IPAddress>(node));
     }
-    return nodes;
+    return addrs;
 }
 
 void ZkServiceRegister::clear()
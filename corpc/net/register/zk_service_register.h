@@ -5,6 +5,7 @@
 #include <string>
 #include "corpc/net/abstract_service_register.h"
 #include "corpc/common/zk_util.h"
+#include "corpc/net/service_discovery.h"
 
 namespace corpc {
 
@@ -17,13 +18,25 @@ public:
     void registerService(std::shared_ptr<google::protobuf::Service> service, NetAddress::ptr addr);
     void registerService(std::shared_ptr<CustomService> service, NetAddress::ptr addr);
     std::vector<NetAddress::ptr> discoverService(const std::string &serviceName);
+    ServiceEndpoints::ptr subscribeService(const std::string &serviceName);
     void clear();
 
 private:
     void init();
 
+    // 从zk拉取服务的地址列表
+    std::vector<NetAddress::ptr> fetchService(const std::string &serviceName);
+
+    // zk通知子节点变化，刷新本地缓存
+    void onChildrenChanged(const std::string &path, const std::vector<std::string> &children);
+
+    static std::vector<NetAddress::ptr> toAddrs(const std::vector<std::string> &nodes);
+
     ZkClient zkCli_;
 
+    // 本地的服务地址缓存，首次访问时拉取，之后由watcher刷新
+    ServiceDiscoveryCache cache_;
+
     std::unordered_set<std::string> pathSet_;
     std::unordered_set<std::string> serviceSet_;
 };
@@ -0,0 +1,83 @@
+#include <atomic>
+#include "corpc/net/service_discovery.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+ServiceEndpoints::ServiceEndpoints(const std::string &serviceName) : serviceName_(serviceName), snapshot_(std::make_shared<EndpointSnapshot>()) {}
+
+EndpointSnapshot::ptr ServiceEndpoints::snapshot() const
+{
+    return std::atomic_load(&snapshot_);
+}
+
+void ServiceEndpoints::update(const std::vector<NetAddress::ptr> &addrs)
+{
+    std::lock_guard<std::mutex> lock(updateMutex_);
+    std::shared_ptr<EndpointSnapshot> snap = std::make_shared<EndpointSnapshot>();
+    snap->version = std::atomic_load(&snapshot_)->version + 1;
+    snap->addrs = addrs;
+    std::atomic_store(&snapshot_, EndpointSnapshot::ptr(snap));
+    LOG_INFO << "service [" << serviceName_ << "] endpoints updated, version=" << snap->version << ", size=" << addrs.size();
+}
+
+ServiceDiscoveryCache::ServiceDiscoveryCache(Loader loader) : loader_(loader) {}
+
+ServiceEndpoints::ptr ServiceDiscoveryCache::get(const std::string &serviceName)
+{
+    ServiceEndpoints::ptr endpoints;
+    RWMutex::ReadLock rlock(mutex_);
+    auto it = endpoints_.find(serviceName);
+    if (it != endpoints_.end()) {
+        endpoints = it->second;
+    }
+    rlock.unlock();
+
+    if (!endpoints) {
+        RWMutex::WriteLock wlock(mutex_);
+        it = endpoints_.find(serviceName);
+        if (it != endpoints_.end()) {
+            endpoints = it->second;
+        }
+        else {
+            // 先放进map再拉取，这样拉取期间到来的watcher通知也能刷新到这个缓存上
+            endpoints = std::make_shared<ServiceEndpoints>(serviceName);
+            endpoints_[serviceName] = endpoints;
+        }
+    }
+
+    // 拉取不在锁内进行，version为0说明还没有拉取成功过（或者别的线程正在拉取），这里补拉一次
+    if (endpoints->version() == 0) {
+        endpoints->update(loader_(serviceName));
+    }
+    return endpoints;
+}
+
+void ServiceDiscoveryCache::refresh(const std::string &serviceName, const std::vector<NetAddress::ptr> &addrs)
+{
+    RWMutex::ReadLock rlock(mutex_);
+    auto it = endpoints_.find(serviceName);
+    if (it == endpoints_.end()) {
+        return;
+    }
+    ServiceEndpoints::ptr endpoints = it->second;
+    rlock.unlock();
+
+    endpoints->update(addrs);
+}
+
+void ServiceDiscoveryCache::reloadAll()
+{
+    std::vector<ServiceEndpoints::ptr> all;
+    RWMutex::ReadLock rlock(mutex_);
+    for (auto &item : endpoints_) {
+        all.push_back(item.second);
+    }
+    rlock.unlock();
+
+    for (auto &endpoints : all) {
+        endpoints->update(loader_(endpoints->getServiceName()));
+    }
+}
+
+}
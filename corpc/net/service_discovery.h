@@ -0,0 +1,73 @@
+#ifndef CORPC_NET_SERVICE_DISCOVERY_H
+#define CORPC_NET_SERVICE_DISCOVERY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "corpc/net/net_address.h"
+#include "corpc/net/mutex.h"
+
+namespace corpc {
+
+// 服务地址快照，发布之后不再修改，读者拿到之后可以随意使用
+struct EndpointSnapshot {
+    typedef std::shared_ptr<const EndpointSnapshot> ptr;
+
+    // 每次地址列表发生变化都会加一，可以用来判断本地保存的地址列表是否过期
+    uint64_t version{0};
+    std::vector<NetAddress::ptr> addrs;
+};
+
+// 某个服务的地址缓存
+// 读取时只做一次shared_ptr的原子加载，不加锁；写入（首次拉取、watcher刷新）时整体替换快照
+class ServiceEndpoints {
+public:
+    typedef std::shared_ptr<ServiceEndpoints> ptr;
+
+    explicit ServiceEndpoints(const std::string &serviceName);
+    ~ServiceEndpoints() = default;
+
+    EndpointSnapshot::ptr snapshot() const;
+
+    uint64_t version() const { return snapshot()->version; }
+
+    void update(const std::vector<NetAddress::ptr> &addrs);
+
+    const std::string &getServiceName() const { return serviceName_; }
+
+private:
+    std::string serviceName_;
+    EndpointSnapshot::ptr snapshot_;
+    // 只用来串行化写者
+    std::mutex updateMutex_;
+};
+
+// 服务名到地址缓存的映射，第一次访问某个服务时通过loader拉取地址，之后由注册中心的通知刷新
+class ServiceDiscoveryCache {
+public:
+    typedef std::function<std::vector<NetAddress::ptr>(const std::string &serviceName)> Loader;
+
+    explicit ServiceDiscoveryCache(Loader loader);
+    ~ServiceDiscoveryCache() = default;
+
+    // 获取服务的地址缓存，不存在时同步拉取一次
+    ServiceEndpoints::ptr get(const std::string &serviceName);
+
+    // 服务地址发生了变化（一般在watcher回调中调用），只刷新已经订阅过的服务
+    void refresh(const std::string &serviceName, const std::vector<NetAddress::ptr> &addrs);
+
+    // 重新通过loader拉取所有已订阅服务的地址，用于会话重建等watcher可能丢失的场景
+    void reloadAll();
+
+private:
+    Loader loader_;
+    RWMutex mutex_;
+    std::unordered_map<std::string, ServiceEndpoints::ptr> endpoints_;
+};
+
+}
+
+#endif
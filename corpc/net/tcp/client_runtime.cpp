@@ -0,0 +1,35 @@
+#include <mutex>
+#include "corpc/net/tcp/client_runtime.h"
+#include "corpc/common/config.h"
+#include "corpc/common/log.h"
+
+namespace corpc {
+
+extern corpc::Config::ptr gConfig;
+
+// 进程退出时不析构，避免在静态变量析构时等待io线程退出
+static IOThreadPool::ptr *gClientIOThreadPool = nullptr;
+static std::once_flag gClientRuntimeOnce;
+
+IOThreadPool::ptr ClientRuntime::getIOThreadPool()
+{
+    std::call_once(gClientRuntimeOnce, []() {
+        int num = gConfig ? gConfig->clientIothreadNum : 1;
+        gClientIOThreadPool = new IOThreadPool::ptr(std::make_shared<IOThreadPool>(num));
+        (*gClientIOThreadPool)->start();
+        LOG_INFO << "client runtime start " << num << " io threads";
+    });
+    return *gClientIOThreadPool;
+}
+
+EventLoop *ClientRuntime::getEventLoop()
+{
+    return getIOThreadPool()->getIOThread()->getEventLoop();
+}
+
+void ClientRuntime::runInCoroutine(std::function<void()> cb)
+{
+    getEventLoop()->runInCoroutine(cb);
+}
+
+}
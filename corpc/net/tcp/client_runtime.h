@@ -0,0 +1,25 @@
+#ifndef CORPC_NET_TCP_CLIENT_RUNTIME_H
+#define CORPC_NET_TCP_CLIENT_RUNTIME_H
+
+#include <functional>
+#include "corpc/net/tcp/io_thread.h"
+#include "corpc/net/event_loop.h"
+
+namespace corpc {
+
+// 进程内所有客户端channel共享的io线程池，不在协程中发起的调用都在这些线程中执行
+// 线程数由配置中的client_iothread_num指定，第一次使用时才创建
+class ClientRuntime {
+public:
+    static IOThreadPool::ptr getIOThreadPool();
+
+    // 轮询选择一个io线程的事件循环
+    static EventLoop *getEventLoop();
+
+    // 在某个io线程的新协程中执行cb
+    static void runInCoroutine(std::function<void()> cb);
+};
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "corpc/net/tcp/timewheel.h"
 #include "corpc/coroutine/coroutine.h"
 #include "corpc/common/config.h"
+#include "corpc/common/cpu_affinity.h"
 #include "corpc/coroutine/coroutine_pool.h"
 #include "corpc/net/tcp/tcp_connection.h"
 
@@ -17,7 +18,7 @@ extern corpc::Config::ptr gConfig;
 static thread_local EventLoop *tLoopPtr = nullptr;
 static thread_local IOThread *tCurrIoThread = nullptr;
 
-IOThread::IOThread()
+IOThread::IOThread(int cpu /* = -1*/) : cpu_(cpu)
 {
     int ret = sem_init(&initSemaphore_, 0, 0);
     assert(ret == 0);
@@ -62,6 +63,12 @@ EventLoop *IOThread::getEventLoop()
     return loop_;
 }
 
+CoroutinePool *IOThread::getLocalCoroutinePool()
+{
+    // 没有绑核的io线程使用共享的协程池，调用方可能是绑核的主线程，不能取调用方的协程池
+    return corPool_ ? corPool_ : getSharedCoroutinePool();
+}
+
 std::shared_ptr<std::thread> IOThread::getThreadId()
 {
     return thread_;
@@ -79,6 +86,11 @@ int IOThread::getThreadIndex()
 
 void IOThread::mainFunc()
 {
+    // 先绑核，之后线程创建的事件循环、协程栈和缓冲区都优先从所在的numa节点分配
+    if (cpu_ >= 0 && CpuAffinity::bindCurrentThread(cpu_)) {
+        corPool_ = initLocalCoroutinePool();
+    }
+
     tLoopPtr = new EventLoop();
     assert(tLoopPtr != nullptr);
 
@@ -108,11 +120,14 @@ void IOThread::addClient(TcpConnection *tcpConn)
     return;
 }
 
-IOThreadPool::IOThreadPool(int size) : size_(size)
+IOThreadPool::IOThreadPool(int size, const std::vector<int> &cpus /* = std::vector<int>()*/) : size_(size)
 {
     ioThreads_.resize(size);
+    // 不指定cpu的io线程不继承创建线程的绑核
+    CpuAffinity::ScopedUnbind unbind;
     for (int i = 0; i < size; ++i) {
-        ioThreads_[i] = std::make_shared<IOThread>();
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        ioThreads_[i] = std::make_shared<IOThread>(cpu);
         ioThreads_[i]->setThreadIndex(i);
     }
 }
@@ -128,8 +143,7 @@ void IOThreadPool::start()
 // 轮询选择I/O线程
 IOThread *IOThreadPool::getIOThread()
 {
-    index_ = (index_ + 1) % size_;
-    return ioThreads_[index_].get();
+    return ioThreads_[index_.fetch_add(1, std::memory_order_relaxed) % size_].get();
 }
 
 int IOThreadPool::getIOThreadPoolSize()
@@ -176,6 +190,7 @@ Coroutine::ptr IOThreadPool::addCoroutineToRandomThread(std::function<void()> cb
 {
     Coroutine::ptr cor = getCoroutinePool()->getCoroutineInstanse();
     cor->setCallBack(cb);
+    cor->setRunTime(getCurrentRunTimePtr());
     addCoroutineToRandomThread(cor, self);
     return cor;
 }
@@ -186,8 +201,9 @@ Coroutine::ptr IOThreadPool::addCoroutineToThreadByIndex(int index, std::functio
         LOG_ERROR << "addCoroutineToThreadByIndex error, invalid iothread index[" << index << "]";
         return nullptr;
     }
-    Coroutine::ptr cor = getCoroutinePool()->getCoroutineInstanse();
+    Coroutine::ptr cor = ioThreads_[index]->getLocalCoroutinePool()->getCoroutineInstanse();
     cor->setCallBack(cb);
+    cor->setRunTime(getCurrentRunTimePtr());
     ioThreads_[index]->getEventLoop()->addCoroutine(cor, true);
     return cor;
 }
@@ -195,10 +211,42 @@ Coroutine::ptr IOThreadPool::addCoroutineToThreadByIndex(int index, std::functio
 void IOThreadPool::addCoroutineToEachThread(std::function<void()> cb)
 {
     for (auto i : ioThreads_) {
-        Coroutine::ptr cor = getCoroutinePool()->getCoroutineInstanse();
+        Coroutine::ptr cor = i->getLocalCoroutinePool()->getCoroutineInstanse();
         cor->setCallBack(cb);
         i->getEventLoop()->addCoroutine(cor, true);
     }
 }
 
-}
\ No newline at end of file
+// 等协程在from上挂起之后再交给to恢复，避免两个线程同时使用协程的栈
+// 协程可能是在from的任务中恢复的，需要唤醒from，否则要等到下一次wait超时才会执行
+static void moveCurrentCoroutine(EventLoop *from, EventLoop *to)
+{
+    Coroutine *cor = Coroutine::getCurrentCoroutine();
+    from->addTask([cor, to]() {
+        to->addTask([cor]() {
+            Coroutine::resume(cor);
+        }, true);
+    }, true);
+    Coroutine::yield();
+}
+
+void IOThreadPool::offload(std::function<void()> cb)
+{
+    EventLoop *home = EventLoop::getEventLoop();
+    if (Coroutine::isMainCoroutine() || !home->isLooping() || size_ <= 1) {
+        cb();
+        return;
+    }
+    // 其他线程可能同时在选择，不能再取一次，直接跳到下一个
+    size_t index = index_.fetch_add(1, std::memory_order_relaxed) % size_;
+    IOThread *target = ioThreads_[index].get();
+    if (target->getEventLoop() == home) {
+        target = ioThreads_[(index + 1) % size_].get();
+    }
+
+    moveCurrentCoroutine(home, target->getEventLoop());
+    cb();
+    moveCurrentCoroutine(target->getEventLoop(), home);
+}
+
+}
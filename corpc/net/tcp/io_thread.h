@@ -7,6 +7,7 @@
 #include <functional>
 #include <semaphore.h>
 #include <thread>
+#include <vector>
 #include "corpc/net/event_loop.h"
 #include "corpc/net/tcp/timewheel.h"
 #include "corpc/coroutine/coroutine.h"
@@ -14,13 +15,17 @@
 namespace corpc {
 
 class TcpServer;
+class CoroutinePool;
 
 class IOThread {
 public:
     typedef std::shared_ptr<IOThread> ptr;
-    IOThread();
+    // cpu >= 0 时线程绑定到该cpu上，并使用自己的协程池
+    IOThread(int cpu = -1);
     ~IOThread();
     EventLoop *getEventLoop();
+    // io线程使用的协程池，在该线程上运行的协程从这里分配
+    CoroutinePool *getLocalCoroutinePool();
     void addClient(TcpConnection *tcpConn);
     std::shared_ptr<std::thread> getThreadId();
     void setThreadIndex(const int index);
@@ -40,6 +45,8 @@ private:
     pid_t tid_{-1};
     TimerEvent::ptr timerEvent_{nullptr};
     int index_{-1};
+    int cpu_{-1};
+    CoroutinePool *corPool_{nullptr};
 
     sem_t initSemaphore_;
     sem_t startSemaphore_;
@@ -49,7 +56,8 @@ class IOThreadPool {
 public:
     typedef std::shared_ptr<IOThreadPool> ptr;
 
-    IOThreadPool(int size);
+    // 第i个io线程绑定到cpus[i % cpus.size()]上，cpus为空时不绑核
+    IOThreadPool(int size, const std::vector<int> &cpus = std::vector<int>());
     void start();
     IOThread *getIOThread();
     int getIOThreadPoolSize();
@@ -65,9 +73,14 @@ public:
     Coroutine::ptr addCoroutineToThreadByIndex(int index, std::function<void()> cb, bool self = false);
     void addCoroutineToEachThread(std::function<void()> cb);
 
+    // 把当前协程临时迁移到线程池中的其他io线程上执行cb，执行完之后回到原来的线程
+    // 会占用另一个io线程，cpu密集的处理应该优先交给WorkerPool，见corpc::offload
+    // 不在协程中调用或者没有其他io线程时直接执行cb
+    void offload(std::function<void()> cb);
+
 private:
     int size_{0};
-    std::atomic<int> index_{-1};
+    std::atomic<size_t> index_{0}; // 轮询的计数，多个线程可能同时选择io线程
     std::vector<IOThread::ptr> ioThreads_;
 };
 
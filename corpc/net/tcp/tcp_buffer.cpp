@@ -102,8 +102,8 @@ void TcpBuffer::clearBuffer()
 void TcpBuffer::recycleRead(int index)
 {
     int j = readIndex_ + index;
-    if (j > (int)buffer_.size()) {
-        LOG_ERROR << "recycleRead error";
+    if (index < 0 || j > writeIndex_) {
+        LOG_ERROR << "recycleRead error, index=" << index;
         return;
     }
     readIndex_ = j;
@@ -113,8 +113,8 @@ void TcpBuffer::recycleRead(int index)
 void TcpBuffer::recycleWrite(int index)
 {
     int j = writeIndex_ + index;
-    if (j > (int)buffer_.size()) {
-        LOG_ERROR << "recycleWrite error";
+    if (index < 0 || j > (int)buffer_.size()) {
+        LOG_ERROR << "recycleWrite error, index=" << index;
         return;
     }
     writeIndex_ = j;
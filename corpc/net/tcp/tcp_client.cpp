@@ -65,23 +65,15 @@ void TcpClient::resetFd()
 int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
 {
     bool isTimeout = false; // rpc是否超时的标记，rpc超时异常不进行重试
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine(); // 子协程
-    auto timercb = [this, &isTimeout, curCor]() {
-        LOG_INFO << "TcpClient timer out event occur";
-        isTimeout = true;
-        this->connection_->setOverTimeFlag(true);
-        corpc::Coroutine::resume(curCor);
-    };
-    TimerEvent::ptr event = std::make_shared<TimerEvent>(maxTimeout_, false, timercb);
+    CoTimeout timeout(maxTimeout_, &TcpClient::onTimeout, this); // 离开作用域时自动取消
     if (maxTimeout_ <= 0) {
         isTimeout = true;
         goto ERR_DEAL;
     }
-    loop_->getTimer()->addTimerEvent(event);
 
-    LOG_DEBUG << "add rpc timer event, timeout on " << event->arriveTime_;
+    LOG_DEBUG << "add rpc timer event, timeout on " << timeout.getArriveTime();
 
-    while (!isTimeout) {
+    while (!timeout.isTimeout()) {
         LOG_DEBUG << "begin to connect";
         if (connection_->getState() != Connected) {
             int ret = connect_hook(fd_, reinterpret_cast<sockaddr *>(peerAddr_->getSockAddr()), peerAddr_->getSockLen());
@@ -91,7 +83,8 @@ int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
                 break;
             }
             resetFd();
-            if (isTimeout) {
+            if (timeout.isTimeout()) {
+                isTimeout = true;
                 LOG_INFO << "connect timeout, break";
                 goto ERR_DEAL;
             }
@@ -100,7 +93,6 @@ int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
                 ss << "connect error, peer[ " << peerAddr_->toString() << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_PEER_CLOSED;
             }
             // 无意义的错误不重试
@@ -109,7 +101,6 @@ int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
                 ss << "connect cur sys ror, err info is " << std::string(strerror(errno)) << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_CONNECT_SYS_ERR;
             }
         }
@@ -122,7 +113,6 @@ int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
         std::stringstream ss;
         ss << "connect peer addr[" << peerAddr_->toString() << "] error. sys error=" << strerror(errno);
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_FAILED_CONNECT;
     }
 
@@ -153,7 +143,6 @@ int TcpClient::sendAndRecvPb(const std::string &msgNo, PbStruct::ptr &res)
         connection_->execute(); // 解码缓冲区中服务端响应，并将序列号和解码后的响应保存起来，避免乱序
     }
 
-    loop_->getTimer()->delTimerEvent(event);
     errInfo_ = "";
     return 0;
 
@@ -173,7 +162,6 @@ ERR_DEAL:
     else {
         ss << "call rpc failed, peer closed [" << peerAddr_->toString() << "]";
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_PEER_CLOSED; // 数据收发过程中，出现了错误，如果不是超时错误，就默认是对方关闭了连接
     }
 }
@@ -181,23 +169,15 @@ ERR_DEAL:
 int TcpClient::sendData()
 {
     bool isTimeout = false; // rpc是否超时的标记，rpc超时异常不进行重试
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine(); // 子协程
-    auto timercb = [this, &isTimeout, curCor]() {
-        LOG_INFO << "TcpClient timer out event occur";
-        isTimeout = true;
-        this->connection_->setOverTimeFlag(true);
-        corpc::Coroutine::resume(curCor);
-    };
-    TimerEvent::ptr event = std::make_shared<TimerEvent>(maxTimeout_, false, timercb);
+    CoTimeout timeout(maxTimeout_, &TcpClient::onTimeout, this); // 离开作用域时自动取消
     if (maxTimeout_ <= 0) {
         isTimeout = true;
         goto ERR_DEAL;
     }
-    loop_->getTimer()->addTimerEvent(event);
 
-    LOG_DEBUG << "add rpc timer event, timeout on " << event->arriveTime_;
+    LOG_DEBUG << "add rpc timer event, timeout on " << timeout.getArriveTime();
 
-    while (!isTimeout) {
+    while (!timeout.isTimeout()) {
         LOG_DEBUG << "begin to connect";
         if (connection_->getState() != Connected) {
             int ret = connect_hook(fd_, reinterpret_cast<sockaddr *>(peerAddr_->getSockAddr()), peerAddr_->getSockLen());
@@ -207,7 +187,8 @@ int TcpClient::sendData()
                 break;
             }
             resetFd();
-            if (isTimeout) {
+            if (timeout.isTimeout()) {
+                isTimeout = true;
                 LOG_INFO << "connect timeout, break";
                 goto ERR_DEAL;
             }
@@ -216,7 +197,6 @@ int TcpClient::sendData()
                 ss << "connect error, peer[ " << peerAddr_->toString() << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_PEER_CLOSED;
             }
             // 无意义的错误不重试
@@ -225,7 +205,6 @@ int TcpClient::sendData()
                 ss << "connect cur sys ror, err info is " << std::string(strerror(errno)) << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_CONNECT_SYS_ERR;
             }
         }
@@ -238,7 +217,6 @@ int TcpClient::sendData()
         std::stringstream ss;
         ss << "connect peer addr[" << peerAddr_->toString() << "] error. sys error=" << strerror(errno);
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_FAILED_CONNECT;
     }
 
@@ -250,7 +228,6 @@ int TcpClient::sendData()
         goto ERR_DEAL;
     }
 
-    loop_->getTimer()->delTimerEvent(event);
     errInfo_ = "";
     return 0;
 
@@ -270,7 +247,6 @@ ERR_DEAL:
     else {
         ss << "call rpc failed, peer closed [" << peerAddr_->toString() << "]";
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_PEER_CLOSED; // 数据收发过程中，出现了错误，如果不是超时错误，就默认是对方关闭了连接
     }
 }
@@ -278,23 +254,15 @@ ERR_DEAL:
 int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
 {
     bool isTimeout = false; // rpc是否超时的标记，rpc超时异常不进行重试
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine(); // 子协程
-    auto timercb = [this, &isTimeout, curCor]() {
-        LOG_INFO << "TcpClient timer out event occur";
-        isTimeout = true;
-        this->connection_->setOverTimeFlag(true);
-        corpc::Coroutine::resume(curCor);
-    };
-    TimerEvent::ptr event = std::make_shared<TimerEvent>(maxTimeout_, false, timercb);
+    CoTimeout timeout(maxTimeout_, &TcpClient::onTimeout, this); // 离开作用域时自动取消
     if (maxTimeout_ <= 0) {
         isTimeout = true;
         goto ERR_DEAL;
     }
-    loop_->getTimer()->addTimerEvent(event);
 
-    LOG_DEBUG << "add rpc timer event, timeout on " << event->arriveTime_;
+    LOG_DEBUG << "add rpc timer event, timeout on " << timeout.getArriveTime();
 
-    while (!isTimeout) {
+    while (!timeout.isTimeout()) {
         LOG_DEBUG << "begin to connect";
         if (connection_->getState() != Connected) {
             int ret = connect_hook(fd_, reinterpret_cast<sockaddr *>(peerAddr_->getSockAddr()), peerAddr_->getSockLen());
@@ -304,7 +272,8 @@ int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
                 break;
             }
             resetFd();
-            if (isTimeout) {
+            if (timeout.isTimeout()) {
+                isTimeout = true;
                 LOG_INFO << "connect timeout, break";
                 goto ERR_DEAL;
             }
@@ -313,7 +282,6 @@ int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
                 ss << "connect error, peer[ " << peerAddr_->toString() << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_PEER_CLOSED;
             }
             // 无意义的错误不重试
@@ -322,7 +290,6 @@ int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
                 ss << "connect cur sys ror, err info is " << std::string(strerror(errno)) << " ] closed.";
                 errInfo_ = ss.str();
                 LOG_ERROR << "cancel overtime event, err info=" << errInfo_;
-                loop_->getTimer()->delTimerEvent(event);
                 return ERROR_CONNECT_SYS_ERR;
             }
         }
@@ -335,7 +302,6 @@ int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
         std::stringstream ss;
         ss << "connect peer addr[" << peerAddr_->toString() << "] error. sys error=" << strerror(errno);
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_FAILED_CONNECT;
     }
 
@@ -366,7 +332,6 @@ int TcpClient::sendAndRecvData(CustomStruct::ptr &res)
         connection_->execute(); // 解码缓冲区中服务端响应，并将序列号和解码后的响应保存起来，避免乱序
     }
 
-    loop_->getTimer()->delTimerEvent(event);
     errInfo_ = "";
     return 0;
 
@@ -386,7 +351,6 @@ ERR_DEAL:
     else {
         ss << "call rpc failed, peer closed [" << peerAddr_->toString() << "]";
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_PEER_CLOSED; // 数据收发过程中，出现了错误，如果不是超时错误，就默认是对方关闭了连接
     }
 }
@@ -394,21 +358,13 @@ ERR_DEAL:
 int TcpClient::recvData(CustomStruct::ptr &res)
 {
     bool isTimeout = false; // rpc是否超时的标记，rpc超时异常不进行重试
-    corpc::Coroutine *curCor = corpc::Coroutine::getCurrentCoroutine(); // 子协程
-    auto timercb = [this, &isTimeout, curCor]() {
-        LOG_INFO << "TcpClient timer out event occur";
-        isTimeout = true;
-        this->connection_->setOverTimeFlag(true);
-        corpc::Coroutine::resume(curCor);
-    };
-    TimerEvent::ptr event = std::make_shared<TimerEvent>(maxTimeout_, false, timercb);
+    CoTimeout timeout(maxTimeout_, &TcpClient::onTimeout, this); // 离开作用域时自动取消
     if (maxTimeout_ <= 0) {
         isTimeout = true;
         goto ERR_DEAL;
     }
-    loop_->getTimer()->addTimerEvent(event);
 
-    LOG_DEBUG << "add rpc timer event, timeout on " << event->arriveTime_;
+    LOG_DEBUG << "add rpc timer event, timeout on " << timeout.getArriveTime();
 
     // 接收服务端响应
     // 然后根据消息序列号，找到对应的响应
@@ -429,7 +385,6 @@ int TcpClient::recvData(CustomStruct::ptr &res)
         connection_->execute(); // 解码缓冲区中服务端响应，并将序列号和解码后的响应保存起来，避免乱序
     }
 
-    loop_->getTimer()->delTimerEvent(event);
     errInfo_ = "";
     return 0;
 
@@ -449,11 +404,17 @@ ERR_DEAL:
     else {
         ss << "call rpc failed, peer closed [" << peerAddr_->toString() << "]";
         errInfo_ = ss.str();
-        loop_->getTimer()->delTimerEvent(event);
         return ERROR_PEER_CLOSED; // 数据收发过程中，出现了错误，如果不是超时错误，就默认是对方关闭了连接
     }
 }
 
+void TcpClient::onTimeout(void *arg)
+{
+    TcpClient *client = static_cast<TcpClient *>(arg);
+    LOG_INFO << "TcpClient timer out event occur";
+    client->connection_->setOverTimeFlag(true);
+}
+
 void TcpClient::stop()
 {
     if (!isStop_) {
@@ -40,6 +40,10 @@ public:
     void setCustomData(std::function<CustomStruct::ptr()> func);
     std::function<CustomStruct::ptr()> getCustomData() { return getCustomData_; }
 
+private:
+    // rpc超时时由定时器调用，之后定时器会唤醒等待的协程
+    static void onTimeout(void *arg);
+
 private:
     int family_{0};
     int fd_{-1};
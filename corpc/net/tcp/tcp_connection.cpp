@@ -1,5 +1,6 @@
 #include <unistd.h>
 #include <cstring>
+#include <algorithm>
 #include <sys/socket.h>
 #include "corpc/net/tcp/tcp_connection.h"
 #include "corpc/net/tcp/tcp_server.h"
@@ -10,9 +11,12 @@
 #include "corpc/net/pb/pb_codec.h"
 #include "corpc/net/custom/custom_codec.h"
 #include "corpc/net/custom/custom_dispatcher.h"
+#include "corpc/common/config.h"
 
 namespace corpc {
 
+extern corpc::Config::ptr gConfig;
+
 TcpConnection::TcpConnection(corpc::TcpServer *tcpServer, corpc::IOThread *ioThread, int fd, int buffSize, NetAddress::ptr peerAddr)
     : ioThread_(ioThread), fd_(fd), state_(Connected), connectionType_(ServerConnection), peerAddr_(peerAddr)
 {
@@ -24,8 +28,13 @@ TcpConnection::TcpConnection(corpc::TcpServer *tcpServer, corpc::IOThread *ioThr
     getCustomData_ = tcpServer_->getCustomData();
     channel_ = ChannelContainer::getChannelContainer()->getChannel(fd);
     channel_->setEventLoop(loop_);
+    channel_->setEdgeMode(true);
     initBuffer(buffSize);
-    loopCor_ = getCoroutinePool()->getCoroutineInstanse(); // 子协程
+    loopCor_ = ioThread_->getLocalCoroutinePool()->getCoroutineInstanse(); // 子协程，栈在io线程所在的numa节点上
+    // http需要按请求的顺序回包，只有pb可以通过msgSeq对应乱序的回包
+    if (codec_->getProtocolType() == Pb_Protocol && gConfig->connConcurrency > 0) {
+        requestSem_.reset(new CoSemaphore(gConfig->connConcurrency));
+    }
     state_ = Connected;
     LOG_DEBUG << "succ create tcp connection[" << state_ << "], fd=" << fd;
 }
@@ -42,6 +51,7 @@ TcpConnection::TcpConnection(corpc::TcpClient *tcpCli, corpc::EventLoop *loop, i
 
     channel_ = ChannelContainer::getChannelContainer()->getChannel(fd);
     channel_->setEventLoop(loop_);
+    channel_->setEdgeMode(true);
     initBuffer(buffSize);
 
     LOG_DEBUG << "succ create tcp connection[NotConnected]";
@@ -88,6 +98,7 @@ TcpConnection::~TcpConnection()
 void TcpConnection::initBuffer(int size)
 {
     // 初始化缓冲区大小
+    initBufferSize_ = size;
     writeBuffer_ = std::make_shared<TcpBuffer>(size);
     readBuffer_ = std::make_shared<TcpBuffer>(size);
 }
@@ -197,6 +208,7 @@ void TcpConnection::input()
     if (!readAll) {
         LOG_ERROR << "not read all data in socket buffer";
     }
+    lastReadTime_ = getNowMs();
     LOG_INFO << "recv [" << count << "] bytes data from [" << peerAddr_->toString() << "], fd [" << fd_ << "]";
     // 连接有新数据来了，需要更新该连接在时间轮中的位置
     if (connectionType_ == ServerConnection) {
@@ -231,8 +243,20 @@ void TcpConnection::execute()
             LOG_ERROR << "it parse request error of fd " << fd_;
             break;
         }
+        // 包在最后一次读的时候收完整，之后可能要排队等待处理，不能在处理时再取连接的读时间
+        data->recvTime_ = lastReadTime_;
 
         if (connectionType_ == ServerConnection) {
+            waitWriteDrain();
+            if (getState() != Connected) {
+                break;
+            }
+        }
+
+        if (connectionType_ == ServerConnection && requestSem_) {
+            dispatchInCor(data);
+        }
+        else if (connectionType_ == ServerConnection) {
             LOG_DEBUG << "to dispatch this package";
             tcpServer_->getDispatcher()->dispatch(data.get(), shared_from_this());
             LOG_DEBUG << "continue parse next package";
@@ -253,35 +277,85 @@ void TcpConnection::execute()
     }
 }
 
+void TcpConnection::dispatchInCor(std::shared_ptr<AbstractData> data)
+{
+    // 达到并发上限时连接协程挂起，不再解析后面的请求，直到有请求处理完
+    requestSem_->acquire();
+    TcpConnection::ptr self = shared_from_this();
+    EventLoop::getEventLoop()->runInCoroutine([self, data]() {
+        self->tcpServer_->getDispatcher()->dispatch(data.get(), self);
+        self->output();
+        self->requestSem_->release();
+    });
+}
+
 void TcpConnection::output()
+{
+    flush(0, 0);
+}
+
+void TcpConnection::flush(int remainSize, int64_t deadline)
 {
     if (isOverTime_) {
         LOG_INFO << "over timer, skip output progress";
         return;
     }
+    // 写的过程中可能挂起，异步回包的协程不能同时写这个连接，客户端只有一个协程在写
+    bool isServer = connectionType_ == ServerConnection;
+    if (isServer) {
+        writeMutex_.lock();
+    }
     while (true) {
         TcpConnectionState state = getState();
         if (state != Connected) {
             break;
         }
 
-        if (writeBuffer_->readAble() == 0) {
+        if (writeBuffer_->readAble() <= remainSize) {
             LOG_DEBUG << "app buffer of fd[" << fd_ << "] no data to write, to yiled this coroutine";
             break;
         }
 
         int totalSize = writeBuffer_->readAble();
         int readIndex = writeBuffer_->readIndex();
+        // 对端一直不读时写会一直挂起，超时后关闭连接
+        int64_t timeoutMs = isServer ? gConfig->slowConsumerTimeout : 0;
+        if (deadline > 0) {
+            timeoutMs = std::max<int64_t>(deadline - getNowMs(), 1);
+        }
+        CoTimeout timeout(timeoutMs);
         int ret = write_hook(fd_, &(writeBuffer_->buffer_[readIndex]), totalSize);
-        // LOG_INFO << "write end";
-        if (ret <= 0) {
-            LOG_ERROR << "write empty, error=" << strerror(errno);
+        timeout.cancel();
+        if (ret <= 0 && !timeout.isTimeout()) {
+            if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+                // 客户端rpc超时的定时器也会唤醒挂起的写，这时不能再重试，否则对端不读时永远不会返回
+                if (isOverTime_) {
+                    LOG_INFO << "over timer, now break write function";
+                    break;
+                }
+                continue;
+            }
+            getWriteBufferStats().writeErrorCount++;
+            LOG_ERROR << "write error, fd=" << fd_ << ", ret=" << ret << ", error=" << strerror(errno);
+            break;
+        }
+
+        if (ret > 0) {
+            LOG_DEBUG << "succ write " << ret << " bytes";
+            writeBuffer_->recycleRead(ret);
+            LOG_DEBUG << "recycle write index =" << writeBuffer_->writeIndex() << ", readIndex =" << writeBuffer_->readIndex() << "readable = " << writeBuffer_->readAble();
+            LOG_INFO << "send[" << ret << "] bytes data to [" << peerAddr_->toString() << "], fd [" << fd_ << "]";
+        }
+
+        bool isSlow = deadline > 0 ? getNowMs() >= deadline && writeBuffer_->readAble() > remainSize : ret <= 0 && timeout.isTimeout();
+        if (isSlow) {
+            getWriteBufferStats().slowConsumerCount++;
+            LOG_ERROR << "peer [" << peerAddr_->toString() << "] reads too slowly, still " << writeBuffer_->readAble() << " bytes pending after "
+                      << gConfig->slowConsumerTimeout << " ms, now shutdown connection, fd=" << fd_;
+            shutdownConnection();
+            break;
         }
 
-        LOG_DEBUG << "succ write " << ret << " bytes";
-        writeBuffer_->recycleRead(ret);
-        LOG_DEBUG << "recycle write index =" << writeBuffer_->writeIndex() << ", readIndex =" << writeBuffer_->readIndex() << "readable = " << writeBuffer_->readAble();
-        LOG_INFO << "send[" << ret << "] bytes data to [" << peerAddr_->toString() << "], fd [" << fd_ << "]";
         if (writeBuffer_->readAble() <= 0) { // 已发送完所有数据
             LOG_INFO << "send all data, now unregister write event and break";
             break;
@@ -292,6 +366,39 @@ void TcpConnection::output()
             break;
         }
     }
+    if (isServer) {
+        // 大的回包把写缓冲区撑大之后，发完就缩回去，不让空闲连接一直占着内存
+        if (gConfig->writeHighWatermark > 0 && writeBuffer_->readAble() == 0 && writeBuffer_->getSize() > gConfig->writeHighWatermark) {
+            writeBuffer_->resizeBuffer(initBufferSize_);
+        }
+        writeMutex_.unlock();
+    }
+}
+
+void TcpConnection::waitWriteDrain()
+{
+    int highWatermark = gConfig->writeHighWatermark;
+    if (highWatermark <= 0 || writeBuffer_->readAble() < highWatermark) {
+        return;
+    }
+    getWriteBufferStats().pauseCount++;
+    LOG_WARN << "pending reply data of [" << peerAddr_->toString() << "] reaches high watermark, pending " << writeBuffer_->readAble()
+             << " bytes, pause reading until it drops below " << gConfig->writeLowWatermark << " bytes, fd=" << fd_;
+    // 对端在超时时间内还没有读到低水位以下，当作慢消费者关闭连接
+    int64_t deadline = gConfig->slowConsumerTimeout > 0 ? getNowMs() + gConfig->slowConsumerTimeout : 0;
+    flush(gConfig->writeLowWatermark, deadline);
+}
+
+WriteBufferStats &TcpConnection::getWriteBufferStats()
+{
+    static WriteBufferStats stats;
+    return stats;
+}
+
+void TcpConnection::encodeReply(AbstractData *data)
+{
+    CoroutineMutex::Lock lock(writeMutex_);
+    codec_->encode(writeBuffer_.get(), data);
 }
 
 void TcpConnection::clearClient()
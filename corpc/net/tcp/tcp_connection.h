@@ -1,6 +1,7 @@
 #ifndef CORPC_NET_TCP_TCP_CONNECTION_H
 #define CORPC_NET_TCP_TCP_CONNECTION_H
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <queue>
@@ -15,6 +16,7 @@
 #include "corpc/net/tcp/abstract_slot.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/mutex.h"
+#include "corpc/net/coroutine_sync.h"
 #include "corpc/net/abstract_codec.h"
 #include "corpc/net/http/http_request.h"
 #include "corpc/net/pb/pb_codec.h"
@@ -27,6 +29,13 @@ class TcpServer;
 class TcpClient;
 class IOThread;
 
+// 所有服务端连接写缓冲区的统计
+struct WriteBufferStats {
+    std::atomic<int64_t> pauseCount{0};        // 待发送的回包超过高水位，暂停读取请求的次数
+    std::atomic<int64_t> slowConsumerCount{0}; // 对端长时间不读回包被关闭的连接数
+    std::atomic<int64_t> writeErrorCount{0};   // 写失败的次数
+};
+
 enum TcpConnectionState {
     NotConnected = 1, // can do io
     Connected = 2,    // can do io
@@ -74,8 +83,14 @@ public:
     void input();
     void execute();
     void output();
+    // 把回包编码到写缓冲区，异步回包时会在其他协程中调用，和output()互斥
+    void encodeReply(AbstractData *data);
     void setOverTimeFlag(bool value);
     bool getOverTimerFlag();
+    NetAddress::ptr getPeerAddr() const { return peerAddr_; }
+    // 写缓冲区中还没有发出去的字节数
+    int getPendingWriteBytes() { return writeBuffer_->readAble(); }
+    static WriteBufferStats &getWriteBufferStats();
     void initServer();
     void sendInCor(const std::string &data);
     void sendInCor(const char *buf, int size);
@@ -84,6 +99,13 @@ public:
 
 private:
     void clearClient();
+    // 在新的协程中处理一个请求，处理完直接回包
+    void dispatchInCor(std::shared_ptr<AbstractData> data);
+    // 发送写缓冲区中的数据，剩余不超过remainSize字节时返回
+    // deadline(ms)之前没有发到remainSize以下时关闭连接，为0时只限制每次写的等待时间
+    void flush(int remainSize, int64_t deadline);
+    // 待发送的回包超过高水位时暂停读取和处理请求，发送到低水位以下再继续
+    void waitWriteDrain();
 
 private:
     TcpServer *tcpServer_{nullptr};
@@ -99,6 +121,7 @@ private:
 
     TcpBuffer::ptr readBuffer_;
     TcpBuffer::ptr writeBuffer_;
+    int initBufferSize_{0};
 
     Coroutine::ptr loopCor_;
 
@@ -108,6 +131,7 @@ private:
 
     bool stop_{false};
     bool isOverTime_{false};
+    int64_t lastReadTime_{0};
 
     std::map<std::string, std::shared_ptr<PbStruct>> replyDatas_;
     std::queue<std::shared_ptr<CustomStruct>> replyCustomDatas_;
@@ -115,6 +139,8 @@ private:
     std::weak_ptr<AbstractSlot<TcpConnection>> weakSlot_;
 
     RWMutex mutex_;
+    CoroutineMutex writeMutex_; // 保护writeBuffer_
+    std::unique_ptr<CoSemaphore> requestSem_; // 连接上并发处理的请求数，为空时逐个处理
 
     ConnectionCallback connectionCallback_; // 有新连接时的回调
     std::function<CustomStruct::ptr()> getCustomData_;
@@ -9,6 +9,7 @@
 #include "corpc/coroutine/coroutine_hook.h"
 #include "corpc/coroutine/coroutine_pool.h"
 #include "corpc/common/config.h"
+#include "corpc/common/cpu_affinity.h"
 #include "corpc/net/tcp/tcp_connection.h"
 #include "corpc/net/http/http_codec.h"
 #include "corpc/net/pb/pb_rpc_dispatcher.h"
@@ -103,7 +104,7 @@ int TcpAcceptor::toAccept()
 
 TcpServer::TcpServer(NetAddress::ptr addr, ProtocolType protocolType /*= Pb_Protocol*/) : addr_(addr)
 {
-    ioPool_ = std::make_shared<IOThreadPool>(gConfig->iothreadNum);
+    ioPool_ = std::make_shared<IOThreadPool>(gConfig->iothreadNum, gConfig->iothreadCpus);
     if (protocolType == Http_Protocol) {
         dispatcher_ = std::make_shared<HttpDispacther>();
         codec_ = std::make_shared<HttpCodeC>();
@@ -111,6 +112,10 @@ TcpServer::TcpServer(NetAddress::ptr addr, ProtocolType protocolType /*= Pb_Prot
     else if (protocolType == Pb_Protocol) {
         dispatcher_ = std::make_shared<PbRpcDispacther>();
         codec_ = std::make_shared<PbCodeC>();
+        if (gConfig->workerThreadNum > 0) {
+            workerPool_ = std::make_shared<WorkerPool>(gConfig->workerThreadNum, gConfig->workerQueueSize);
+            dynamic_cast<PbRpcDispacther *>(dispatcher_.get())->setWorkerPool(workerPool_);
+        }
     }
     else {
         dispatcher_ = std::make_shared<CustomDispatcher>();
@@ -118,6 +123,11 @@ TcpServer::TcpServer(NetAddress::ptr addr, ProtocolType protocolType /*= Pb_Prot
     }
     protocolType_ = protocolType;
 
+    if (gConfig->maxConcurrency > 0 || gConfig->ipMaxConcurrency > 0 || !gConfig->methodMaxConcurrency.empty()) {
+        limiter_ = std::make_shared<ConcurrencyLimiter>(gConfig->limiterAdaptive, gConfig->maxConcurrency, gConfig->ipMaxConcurrency, gConfig->methodMaxConcurrency);
+        dispatcher_->setLimiter(limiter_);
+    }
+
     // main loop对应主线程
     mainLoop_ = corpc::EventLoop::getEventLoop();
     mainLoop_->setEventLoopType(MainLoop);
@@ -136,6 +146,11 @@ void TcpServer::start()
 {
     acceptor_.reset(new TcpAcceptor(addr_));
     acceptor_->init();
+    // 主线程绑核之后使用自己的协程池，只有接受连接的一个子协程
+    // 之后主线程创建的辅助线程（客户端io线程、zookeeper线程等）会临时取消绑定，不继承绑核和内存策略
+    if (gConfig->mainCpu >= 0 && CpuAffinity::bindCurrentThread(gConfig->mainCpu)) {
+        initLocalCoroutinePool(1);
+    }
     // 调用getCoroutinePool()会自动设置主线程的主协程
     acceptCor_ = getCoroutinePool()->getCoroutineInstanse(); // acceptCor_：主线程的子协程，主线程只有这一个子协程，用于接受新连接
     acceptCor_->setCallBack(std::bind(&TcpServer::mainAcceptCorFunc, this));
@@ -197,11 +212,13 @@ void TcpServer::addCoroutine(Coroutine::ptr cor)
     mainLoop_->addCoroutine(cor);
 }
 
-bool TcpServer::registerService(std::shared_ptr<google::protobuf::Service> service)
+bool TcpServer::registerService(std::shared_ptr<google::protobuf::Service> service, const std::vector<std::string> &workerMethods/* = std::vector<std::string>()*/)
 {
     if (protocolType_ == Pb_Protocol) {
         if (service) {
-            dynamic_cast<PbRpcDispacther *>(dispatcher_.get())->registerService(service);
+            if (!dynamic_cast<PbRpcDispacther *>(dispatcher_.get())->registerService(service, workerMethods)) {
+                return false;
+            }
             if (!register_) {
                 register_ = ServiceRegister::queryRegister(gConfig->serviceRegister);
             }
@@ -318,6 +335,16 @@ IOThreadPool::ptr TcpServer::getIOThreadPool()
     return ioPool_;
 }
 
+WorkerPool::ptr TcpServer::getWorkerPool()
+{
+    return workerPool_;
+}
+
+ConcurrencyLimiter::ptr TcpServer::getLimiter()
+{
+    return limiter_;
+}
+
 AbstractDispatcher::ptr TcpServer::getDispatcher()
 {
     return dispatcher_;
@@ -9,6 +9,8 @@
 #include "corpc/net/timer.h"
 #include "corpc/net/net_address.h"
 #include "corpc/net/tcp/io_thread.h"
+#include "corpc/net/worker_pool.h"
+#include "corpc/net/concurrency_limiter.h"
 #include "corpc/net/tcp/timewheel.h"
 #include "corpc/net/abstract_codec.h"
 #include "corpc/net/abstract_dispatcher.h"
@@ -52,7 +54,8 @@ public:
     void start();
     void stop();
     void addCoroutine(corpc::Coroutine::ptr cor);
-    bool registerService(std::shared_ptr<google::protobuf::Service> service);
+    // workerMethods中的方法（不带服务名）在业务线程池中执行，需要配置worker_pool
+    bool registerService(std::shared_ptr<google::protobuf::Service> service, const std::vector<std::string> &workerMethods = std::vector<std::string>());
     bool registerHttpServlet(const std::string &urlPath, HttpServlet::ptr servlet);
     bool registerService(std::shared_ptr<CustomService> service);
     TcpConnection::ptr addClient(IOThread *ioThread, int fd);
@@ -69,6 +72,10 @@ public:
     NetAddress::ptr getPeerAddr();
     NetAddress::ptr getLocalAddr();
     IOThreadPool::ptr getIOThreadPool();
+    // 没有配置worker_pool时返回nullptr
+    WorkerPool::ptr getWorkerPool();
+    // 没有配置limiter时返回nullptr
+    ConcurrencyLimiter::ptr getLimiter();
     TcpTimeWheel::ptr getTimeWheel();
 
 private:
@@ -86,6 +93,8 @@ private:
     AbstractCodeC::ptr codec_;
     AbstractServiceRegister::ptr register_;
     IOThreadPool::ptr ioPool_;
+    WorkerPool::ptr workerPool_;
+    ConcurrencyLimiter::ptr limiter_;
     ProtocolType protocolType_{Pb_Protocol};
     TcpTimeWheel::ptr timeWheel_;
     std::map<int, std::shared_ptr<TcpConnection>> clients_;
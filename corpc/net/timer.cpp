@@ -20,6 +20,13 @@ int64_t getNowMs()
     return re;
 }
 
+int64_t getNowUs()
+{
+    timeval val;
+    gettimeofday(&val, nullptr);
+    return val.tv_sec * 1000000 + val.tv_usec;
+}
+
 // timefd 是 Linux 新增的一个特性。他可以让我们把定时器当做套接字 fd 来处理。
 // 只需要把 timefd 的可读事件也注册到 epoll 上。当时间到时，timefd发生可读事件，epoll_wait 返回，然后去执行其上绑定的定时任务。
 // 可以达到 ms 级别精度
@@ -87,22 +94,28 @@ void Timer::delTimerEvent(TimerEvent::ptr event)
 
 void Timer::resetArriveTime()
 {
+    // 只需要最早到期的时间，不用拷贝整个定时事件表
+    int64_t arriveTime = -1;
     RWMutex::ReadLock lock(eventMutex_);
-    std::multimap<int64_t, TimerEvent::ptr> temp = pendingEvents_;
+    if (!pendingEvents_.empty()) {
+        arriveTime = pendingEvents_.begin()->first;
+    }
     lock.unlock();
 
-    if (temp.size() == 0) {
+    std::unique_lock<std::mutex> coLock(coTimerMutex_);
+    if (!coTimers_.empty() && (arriveTime < 0 || coTimers_[0]->arriveTime_ < arriveTime)) {
+        arriveTime = coTimers_[0]->arriveTime_;
+    }
+    coLock.unlock();
+
+    if (arriveTime < 0) {
         LOG_DEBUG << "no timerevent pending, size = 0";
         return;
     }
 
+    // 已经到期的事件也要让timerfd尽快触发，否则要等到下一个定时事件才会执行
     int64_t now = getNowMs();
-    auto it = temp.begin();
-    if (it->first < now) {
-        LOG_DEBUG << "all timer events has already expire";
-        return;
-    }
-    int64_t interval = it->first - now;
+    int64_t interval = arriveTime > now ? arriveTime - now : 1;
 
     itimerspec newValue;
     memset(&newValue, 0, sizeof(newValue));
@@ -155,12 +168,180 @@ void Timer::onTimer()
         }
     }
 
+    // 到期的协程定时器，同一个协程只唤醒一次
+    std::vector<CoTimerNode> fired;
+    std::unique_lock<std::mutex> coLock(coTimerMutex_);
+    while (!coTimers_.empty() && coTimers_[0]->arriveTime_ <= now) {
+        CoTimerNode *node = coTimers_[0];
+        removeCoTimer(0);
+        node->isFired_ = true;
+        // 唤醒协程之后节点可能已经被销毁，这里保存一份拷贝
+        fired.push_back(*node);
+    }
+    coLock.unlock();
+
     // 定时器触发之后，需要更新下次触发时间
     resetArriveTime();
 
     for (auto i : tasks) {
         i.second();
     }
+
+    for (size_t i = 0; i < fired.size(); ++i) {
+        if (fired[i].onTimeout_) {
+            fired[i].onTimeout_(fired[i].arg_);
+        }
+    }
+    for (size_t i = 0; i < fired.size(); ++i) {
+        bool resumed = false;
+        for (size_t j = 0; j < i; ++j) {
+            if (fired[j].cor_ == fired[i].cor_) {
+                resumed = true;
+                break;
+            }
+        }
+        if (!resumed && fired[i].cor_) {
+            Coroutine::resume(fired[i].cor_);
+        }
+    }
+}
+
+void Timer::addCoTimer(CoTimerNode *node)
+{
+    std::unique_lock<std::mutex> lock(coTimerMutex_);
+    node->timer_ = this;
+    node->isFired_ = false;
+    node->heapIndex_ = coTimers_.size();
+    coTimers_.push_back(node);
+    siftUpCoTimer(node->heapIndex_);
+    bool isReset = node->heapIndex_ == 0; // 比其他协程定时器都早，可能需要提前触发
+    lock.unlock();
+
+    if (isReset) {
+        resetArriveTime();
+    }
+}
+
+void Timer::delCoTimer(CoTimerNode *node)
+{
+    std::unique_lock<std::mutex> lock(coTimerMutex_);
+    if (node->timer_ != this) {
+        return;
+    }
+    removeCoTimer(node->heapIndex_);
+}
+
+void Timer::swapCoTimer(size_t i, size_t j)
+{
+    std::swap(coTimers_[i], coTimers_[j]);
+    coTimers_[i]->heapIndex_ = i;
+    coTimers_[j]->heapIndex_ = j;
+}
+
+void Timer::siftUpCoTimer(size_t index)
+{
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (coTimers_[parent]->arriveTime_ <= coTimers_[index]->arriveTime_) {
+            break;
+        }
+        swapCoTimer(parent, index);
+        index = parent;
+    }
+}
+
+void Timer::siftDownCoTimer(size_t index)
+{
+    size_t size = coTimers_.size();
+    while (true) {
+        size_t smallest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if (left < size && coTimers_[left]->arriveTime_ < coTimers_[smallest]->arriveTime_) {
+            smallest = left;
+        }
+        if (right < size && coTimers_[right]->arriveTime_ < coTimers_[smallest]->arriveTime_) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        swapCoTimer(index, smallest);
+        index = smallest;
+    }
+}
+
+void Timer::removeCoTimer(size_t index)
+{
+    CoTimerNode *node = coTimers_[index];
+    size_t last = coTimers_.size() - 1;
+    if (index != last) {
+        swapCoTimer(index, last);
+    }
+    coTimers_.pop_back();
+    if (index < coTimers_.size()) {
+        siftDownCoTimer(index);
+        siftUpCoTimer(index);
+    }
+    node->timer_ = nullptr;
+}
+
+void sleepUntil(int64_t arriveTimeMs)
+{
+    int64_t now = getNowMs();
+    if (arriveTimeMs <= now) {
+        return;
+    }
+    if (Coroutine::isMainCoroutine()) {
+        int64_t ms = arriveTimeMs - now;
+        timespec ts;
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = (ms % 1000) * 1000000;
+        nanosleep(&ts, nullptr);
+        return;
+    }
+
+    Coroutine *cor = Coroutine::getCurrentCoroutine();
+    CoTimerNode *node = cor->getTimerNode();
+    node->arriveTime_ = arriveTimeMs;
+    node->cor_ = cor;
+    node->onTimeout_ = nullptr;
+    node->arg_ = nullptr;
+    EventLoop::getEventLoop()->getTimer()->addCoTimer(node);
+
+    // 协程可能被其他事件唤醒，没有到期时继续睡眠
+    while (!node->isFired_) {
+        Coroutine::yield();
+    }
+}
+
+void sleepMs(int64_t ms)
+{
+    sleepUntil(getNowMs() + ms);
+}
+
+CoTimeout::CoTimeout(int64_t timeoutMs, void (*onTimeout)(void *arg)/* = nullptr*/, void *arg/* = nullptr*/)
+{
+    if (timeoutMs <= 0 || Coroutine::isMainCoroutine()) {
+        return;
+    }
+    node_.arriveTime_ = getNowMs() + timeoutMs;
+    node_.cor_ = Coroutine::getCurrentCoroutine();
+    node_.onTimeout_ = onTimeout;
+    node_.arg_ = arg;
+    EventLoop::getEventLoop()->getTimer()->addCoTimer(&node_);
+}
+
+CoTimeout::~CoTimeout()
+{
+    cancel();
+}
+
+void CoTimeout::cancel()
+{
+    if (node_.timer_) {
+        node_.timer_->delCoTimer(&node_);
+    }
 }
 
 }
@@ -4,6 +4,8 @@
 #include <ctime>
 #include <memory>
 #include <map>
+#include <vector>
+#include <mutex>
 #include <functional>
 #include "corpc/net/mutex.h"
 #include "corpc/net/event_loop.h"
@@ -14,6 +16,8 @@ namespace corpc {
 
 int64_t getNowMs(); // 获取当前时间戳，ms
 
+int64_t getNowUs(); // 获取当前时间戳，us
+
 class TimerEvent {
 public:
     typedef std::shared_ptr<TimerEvent> ptr;
@@ -60,9 +64,53 @@ public:
     void resetArriveTime();
     void onTimer();
 
+    // 协程定时器，节点由调用方持有，到期后从定时器中移除
+    void addCoTimer(CoTimerNode *node);
+    void delCoTimer(CoTimerNode *node);
+
+private:
+    void swapCoTimer(size_t i, size_t j);
+    void siftUpCoTimer(size_t index);
+    void siftDownCoTimer(size_t index);
+    void removeCoTimer(size_t index);
+
 private:
     std::multimap<int64_t, TimerEvent::ptr> pendingEvents_;
     RWMutex eventMutex_;
+
+    // 按到期时间排列的最小堆，通常只在io线程内访问，锁几乎没有竞争
+    std::vector<CoTimerNode *> coTimers_;
+    std::mutex coTimerMutex_;
+};
+
+// 当前协程睡眠ms毫秒，在主协程中调用时阻塞当前线程
+void sleepMs(int64_t ms);
+
+// 睡眠到指定的时间点（getNowMs()的时间戳）
+void sleepUntil(int64_t arriveTimeMs);
+
+// 协程超时作用域，超时后执行onTimeout并唤醒当前协程，离开作用域时自动取消，比如：
+// CoTimeout timeout(100);
+// read(fd, buf, len); // 100ms内没有数据时被唤醒并返回
+// if (timeout.isTimeout()) {...}
+// 超时节点在作用域对象中，不需要分配内存
+class CoTimeout {
+public:
+    // timeoutMs <= 0 或者在主协程中时不生效
+    explicit CoTimeout(int64_t timeoutMs, void (*onTimeout)(void *arg) = nullptr, void *arg = nullptr);
+    ~CoTimeout();
+
+    bool isTimeout() const { return node_.isFired_; }
+    int64_t getArriveTime() const { return node_.arriveTime_; }
+
+    void cancel();
+
+private:
+    CoTimeout(const CoTimeout &) = delete;
+    CoTimeout &operator=(const CoTimeout &) = delete;
+
+private:
+    CoTimerNode node_;
 };
 
 }
@@ -0,0 +1,96 @@
+#include "corpc/net/worker_pool.h"
+#include "corpc/net/coroutine_sync.h"
+#include "corpc/net/timer.h"
+#include "corpc/coroutine/coroutine.h"
+#include "corpc/common/log.h"
+#include "corpc/common/cpu_affinity.h"
+
+namespace corpc {
+
+WorkerPool::WorkerPool(int threadNum, int maxQueueSize) : maxQueueSize_(maxQueueSize > 0 ? maxQueueSize : 1)
+{
+    CpuAffinity::ScopedUnbind unbind;
+    for (int i = 0; i < threadNum; ++i) {
+        threads_.emplace_back(std::bind(&WorkerPool::workerFunc, this));
+    }
+    LOG_INFO << "succ create worker pool, thread num=" << threadNum << ", max queue size=" << maxQueueSize_;
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto &i : threads_) {
+        i.join();
+    }
+}
+
+bool WorkerPool::run(std::function<void()> task)
+{
+    CoWaiter::ptr waiter = CoWaiter::current();
+    if (!waiter) {
+        LOG_ERROR << "main coroutine can't run task in worker pool";
+        return false;
+    }
+
+    RunTime::ptr runtime = getCurrentRunTimePtr();
+    Task item;
+    item.enqueueTimeUs = getNowUs();
+    item.func = [task, runtime, waiter]() {
+        setCurrentRunTime(runtime.get());
+        task();
+        setCurrentRunTime(nullptr);
+        waiter->wake();
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (tasks_.size() >= maxQueueSize_) {
+            lock.unlock();
+            rejected_++;
+            LOG_WARN << "worker pool queue is full, queue size=" << maxQueueSize_;
+            return false;
+        }
+        tasks_.push_back(std::move(item));
+    }
+    cond_.notify_one();
+
+    // 唤醒任务投递到当前io线程的事件循环中，在这里挂起之后才会执行
+    waiter->park();
+    return true;
+}
+
+size_t WorkerPool::getQueueDepth()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+int64_t WorkerPool::getWaitTimeUs(double p)
+{
+    return waitTime_.percentile(p);
+}
+
+void WorkerPool::workerFunc()
+{
+    while (true) {
+        Task item;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            if (stop_ && tasks_.empty()) {
+                return;
+            }
+            item = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        waitTime_.record(getNowUs() - item.enqueueTimeUs);
+        item.func();
+        completed_++;
+    }
+}
+
+}
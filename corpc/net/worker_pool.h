@@ -0,0 +1,60 @@
+#ifndef CORPC_NET_WORKER_POOL_H
+#define CORPC_NET_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "corpc/net/latency_histogram.h"
+
+namespace corpc {
+
+// 业务线程池，用于执行cpu密集的处理，避免阻塞io线程上的其他连接
+// 协程提交任务后挂起，任务在工作线程执行完之后回到协程所在的io线程继续执行
+class WorkerPool {
+public:
+    typedef std::shared_ptr<WorkerPool> ptr;
+
+    WorkerPool(int threadNum, int maxQueueSize);
+    ~WorkerPool();
+
+    // 在工作线程中执行task，当前协程挂起直到执行完成，任务中可以通过getCurrentRunTime()取到当前协程的上下文
+    // 队列已满或者在主协程中调用时返回false，task不会执行
+    bool run(std::function<void()> task);
+
+    // 排队等待执行的任务数
+    size_t getQueueDepth();
+    // 任务从提交到开始执行的等待时间，us
+    int64_t getWaitTimeUs(double p);
+    int64_t getCompletedCount() const { return completed_; }
+    int64_t getRejectedCount() const { return rejected_; }
+
+private:
+    struct Task {
+        std::function<void()> func;
+        int64_t enqueueTimeUs{0};
+    };
+
+    void workerFunc();
+
+private:
+    size_t maxQueueSize_{0};
+    bool stop_{false};
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Task> tasks_;
+    std::vector<std::thread> threads_;
+
+    LatencyHistogram waitTime_;
+    std::atomic<int64_t> completed_{0};
+    std::atomic<int64_t> rejected_{0};
+};
+
+}
+
+#endif
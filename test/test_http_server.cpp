@@ -10,6 +10,7 @@
 #include "corpc/net/pb/pb_rpc_async_channel.h"
 #include "corpc/net/pb/pb_rpc_controller.h"
 #include "corpc/net/pb/pb_rpc_closure.h"
+#include "corpc/net/pb/pb_rpc_future.h"
 #include "corpc/net/net_address.h"
 #include "test_pb_server.pb.h"
 
@@ -145,6 +146,55 @@ public:
     }
 };
 
+class FutureCallHttpServlet : public corpc::HttpServlet {
+public:
+    FutureCallHttpServlet() = default;
+    ~FutureCallHttpServlet() = default;
+
+    void handle(corpc::HttpRequest *req, corpc::HttpResponse *res) {
+        USER_LOG_INFO << "FutureCallHttpServlet get request";
+        setHttpCode(res, corpc::HTTP_OK);
+        setHttpContentType(res, "text/html;charset=utf-8");
+
+        int count = std::atoi(req->queryMaps_["count"].c_str());
+        if (count <= 0) {
+            count = 1;
+        }
+
+        // 同时发起count个调用，在当前io线程中执行，只等待一次
+        corpc::PbRpcChannel::ptr channel = std::make_shared<corpc::PbRpcChannel>(addr);
+        std::vector<corpc::RpcFuture<queryNameRes>::ptr> futures;
+        for (int i = 0; i < count; ++i) {
+            queryNameReq rpcReq;
+            rpcReq.set_id(i);
+            futures.push_back(corpc::asyncCall(channel, &QueryService_Stub::query_name, rpcReq));
+        }
+
+        std::stringstream ss;
+        if (!corpc::whenAll(futures, 5000)) {
+            ss << "wait QueryServer rpc server timeout";
+        }
+        else {
+            int succ = 0;
+            for (auto &future : futures) {
+                if (future->controller()->ErrorCode() == 0) {
+                    succ++;
+                }
+            }
+            ss << "Success!! " << succ << "/" << count << " calls succ";
+        }
+        USER_LOG_DEBUG << ss.str();
+
+        char buf[1024] = {0};
+        sprintf(buf, html, ss.str().c_str());
+        setHttpBody(res, std::string(buf));
+    }
+
+    std::string getServletName() {
+        return "FutureCallHttpServlet";
+    }
+};
+
 class QPSHttpServlet : public corpc::HttpServlet {
 public:
     QPSHttpServlet() = default;
@@ -183,6 +233,7 @@ int main(int argc, char *argv[])
 
     REGISTER_HTTP_SERVLET("/block", BlockCallHttpServlet);
     REGISTER_HTTP_SERVLET("/nonblock", NonBlockCallHttpServlet);
+    REGISTER_HTTP_SERVLET("/future", FutureCallHttpServlet);
 
     corpc::startServer();
     return 0;
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "corpc/net/load_balance.h"
+
+/*
+ * 负载均衡策略测试，不需要启动服务
+ */
+
+static int failed = 0;
+
+static void check(bool cond, const std::string &what)
+{
+    std::cout << (cond ? "[PASS] " : "[FAIL] ") << what << std::endl;
+    if (!cond) {
+        failed++;
+    }
+}
+
+static std::vector<corpc::NetAddress::ptr> makeAddrs(int n, int basePort = 20000)
+{
+    std::vector<corpc::NetAddress::ptr> addrs;
+    for (int i = 0; i < n; ++i) {
+        addrs.push_back(std::make_shared<corpc::IPAddress>("127.0.0.1", basePort + i));
+    }
+    return addrs;
+}
+
+static corpc::PbStruct makeInvocation(const std::string &body)
+{
+    corpc::PbStruct pk;
+    pk.serviceFullName = "QueryService.query_name";
+    pk.pbData = body;
+    return pk;
+}
+
+static void testConsistentHash()
+{
+    corpc::ConsistentHashLoadBalanceStrategy strategy;
+    std::vector<corpc::NetAddress::ptr> addrs = makeAddrs(5);
+    corpc::LoadBalanceState::ptr state = strategy.prepare(addrs);
+
+    std::vector<corpc::NetAddress::ptr> empty;
+    corpc::PbStruct pk = makeInvocation("key");
+    check(!strategy.select(empty, pk) && !strategy.selectPrepared(state, empty, pk), "empty address list selects nothing");
+
+    corpc::ConsistentHashLoadBalanceStrategy noReplica(corpc::ConsistentHashLoadBalanceStrategy::methodAndBodyKey(), 0);
+    corpc::NetAddress::ptr addr = noReplica.selectPrepared(noReplica.prepare(addrs), addrs, pk);
+    check(addr && noReplica.select(addrs, pk), "ring without virtual nodes falls back to random");
+
+    // 每次新建的通道里地址对象不同，地址相同时共用一个环
+    check(strategy.prepare(makeAddrs(5)).get() == state.get(), "same address set shares one ring");
+
+    int stable = 0;
+    int stayed = 0;
+    int movedAway = 0;
+    std::vector<corpc::NetAddress::ptr> healthy = {addrs[0], addrs[1], addrs[3], addrs[4]};
+    for (int i = 0; i < 2000; ++i) {
+        pk = makeInvocation(std::to_string(i));
+        corpc::NetAddress::ptr a = strategy.selectPrepared(state, addrs, pk);
+        if (a == strategy.select(addrs, pk)) {
+            stable++;
+        }
+        corpc::NetAddress::ptr b = strategy.selectPrepared(state, healthy, pk);
+        if (a != addrs[2] && a == b) {
+            stayed++;
+        }
+        if (a == addrs[2] && b != addrs[2]) {
+            movedAway++;
+        }
+    }
+    check(stable == 2000, "same key always selects the same node");
+    check(stayed + movedAway == 2000, "excluding a node only moves the keys on it");
+
+    // 默认的key使用整个请求体，前缀相同的请求也会分散开
+    std::string prefix(64, 'p');
+    std::set<corpc::NetAddress *> byBody;
+    std::set<corpc::NetAddress *> byPrefix;
+    corpc::ConsistentHashLoadBalanceStrategy prefixStrategy(corpc::ConsistentHashLoadBalanceStrategy::methodAndPrefixKey(64));
+    for (int i = 0; i < 100; ++i) {
+        pk = makeInvocation(prefix + std::to_string(i));
+        byBody.insert(strategy.select(addrs, pk).get());
+        byPrefix.insert(prefixStrategy.select(addrs, pk).get());
+    }
+    check(byBody.size() > 1 && byPrefix.size() == 1, "default key hashes the whole body, prefix key is opt-in");
+}
+
+static std::map<corpc::NetAddress *, int> countSelected(corpc::LoadBalanceStrategy &strategy, const corpc::LoadBalanceState::ptr &state, std::vector<corpc::NetAddress::ptr> &addrs, int times)
+{
+    std::map<corpc::NetAddress *, int> counts;
+    corpc::PbStruct pk = makeInvocation("");
+    for (int i = 0; i < times; ++i) {
+        counts[strategy.selectPrepared(state, addrs, pk).get()]++;
+    }
+    return counts;
+}
+
+static void testLatencyAware()
+{
+    // 统计是全局共享的，每个用例使用不同的端口
+    std::vector<corpc::NetAddress::ptr> addrs = makeAddrs(3, 21000);
+    corpc::LeastOutstandingLoadBalanceStrategy least;
+    corpc::EndpointStatsRegistry::get(addrs[0])->onStart();
+    corpc::EndpointStatsRegistry::get(addrs[0])->onStart();
+    corpc::EndpointStatsRegistry::get(addrs[1])->onStart();
+    std::map<corpc::NetAddress *, int> counts = countSelected(least, least.prepare(addrs), addrs, 100);
+    check(counts[addrs[2].get()] == 100, "least outstanding selects the idle node");
+
+    addrs = makeAddrs(2, 21100);
+    corpc::P2CLoadBalanceStrategy p2c;
+    corpc::EndpointStatsRegistry::get(addrs[0])->onStart();
+    corpc::EndpointStatsRegistry::get(addrs[0])->onFinish(1000, true);
+    corpc::EndpointStatsRegistry::get(addrs[1])->onStart();
+    corpc::EndpointStatsRegistry::get(addrs[1])->onFinish(100, true);
+    counts = countSelected(p2c, p2c.prepare(addrs), addrs, 100);
+    check(counts[addrs[1].get()] == 100, "p2c selects the faster node");
+
+    // prepare之后修改的权重也会生效
+    addrs = makeAddrs(3, 21200);
+    corpc::WeightedRoundLoadBalanceStrategy weighted;
+    corpc::LoadBalanceState::ptr state = weighted.prepare(addrs);
+    corpc::EndpointStatsRegistry::get(addrs[0])->setWeight(3);
+    corpc::EndpointStatsRegistry::get(addrs[1])->setWeight(1);
+    std::vector<corpc::NetAddress::ptr> candidates = {addrs[0], addrs[1]};
+    counts = countSelected(weighted, state, candidates, 400);
+    check(counts[addrs[0].get()] == 300 && counts[addrs[1].get()] == 100, "weighted round follows the weights");
+
+    // 地址集合变化后按新的集合重新开始
+    candidates = {addrs[1], addrs[2]};
+    counts = countSelected(weighted, weighted.prepare(candidates), candidates, 100);
+    check(counts[addrs[1].get()] == 50 && counts[addrs[2].get()] == 50, "weighted round restarts on a new address set");
+    corpc::PbStruct pk = makeInvocation("");
+    int fromFirst = 0;
+    for (int i = 0; i < 100; ++i) {
+        std::vector<corpc::NetAddress::ptr> &set = i < 50 ? addrs : candidates;
+        fromFirst += weighted.select(set, pk) == addrs[0] ? 1 : 0;
+    }
+    check(fromFirst == 30, "weighted round without prepare handles a shrinking address set");
+}
+
+int main(int argc, char *argv[])
+{
+    testConsistentHash();
+    testLatencyAware();
+    std::cout << (failed ? "test_load_balance failed" : "test_load_balance passed") << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "corpc/common/start.h"
+#include "corpc/net/load_balance.h"
+#include "corpc/net/service_discovery.h"
+#include "corpc/net/pb/pb_codec.h"
+#include "corpc/net/pb/pb_data.h"
+#include "corpc/net/pb/pb_rpc_channel.h"
+#include "corpc/net/pb/pb_rpc_future.h"
+#include "corpc/net/tcp/tcp_buffer.h"
+#include "test_pb_server.pb.h"
+
+/*
+ * 多个线程共用一个PbRpcChannel发起异步调用，同时不断地修改服务地址和负载均衡策略
+ * 服务端是进程内的两个简单的v1服务，每个连接一个线程，回包中带上自己的端口
+ * ./test_pb_channel_concurrency ../conf/test_pb_server_client.yml
+ */
+
+static const int CALLER_NUM = 4;
+static const int BATCH_NUM = 20;
+static const int BATCH_SIZE = 20;
+
+static int failed = 0;
+
+static void check(bool cond, const std::string &what)
+{
+    std::cout << (cond ? "[PASS] " : "[FAIL] ") << what << std::endl;
+    if (!cond) {
+        failed++;
+    }
+}
+
+static void serveConnection(int fd, int port)
+{
+    corpc::PbCodeC codec;
+    corpc::TcpBuffer in(4096);
+    char buf[4096];
+    while (true) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        in.writeToBuffer(buf, n);
+        while (in.readAble() > 0) {
+            corpc::PbStruct req;
+            codec.decode(&in, &req);
+            if (!req.decodeSucc_) {
+                break;
+            }
+            queryNameReq nameReq;
+            queryNameRes nameRes;
+            nameReq.ParseFromString(req.pbData);
+            nameRes.set_id(nameReq.id());
+            nameRes.set_name(std::to_string(port));
+
+            // 不回复proto=2，客户端一直使用v1
+            corpc::PbStruct reply;
+            reply.serviceFullName = req.serviceFullName;
+            reply.msgSeq = req.msgSeq;
+            reply.isReply = true;
+            nameRes.SerializeToString(&reply.pbData);
+            corpc::TcpBuffer out(256);
+            codec.encode(&out, &reply);
+            std::string data = out.getBufferString();
+            if (::write(fd, data.data(), data.size()) != (ssize_t)data.size()) {
+                break;
+            }
+        }
+    }
+    close(fd);
+}
+
+// 返回监听的端口，失败返回0
+static int startServer()
+{
+    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t len = sizeof(addr);
+    if (bind(listenfd, (sockaddr *)&addr, len) != 0 || listen(listenfd, 128) != 0 || getsockname(listenfd, (sockaddr *)&addr, &len) != 0) {
+        close(listenfd);
+        return 0;
+    }
+    int port = ntohs(addr.sin_port);
+    std::thread([listenfd, port]() {
+        while (true) {
+            int fd = ::accept(listenfd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            std::thread(serveConnection, fd, port).detach();
+        }
+    }).detach();
+    return port;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        printf("Start test error, input argc is not 2!\n");
+        printf("Start test like this: \n");
+        printf("./test_pb_channel_concurrency conf.yaml\n");
+        return 0;
+    }
+    corpc::initConfig(argv[1]);
+
+    int portA = startServer();
+    int portB = startServer();
+    check(portA != 0 && portB != 0, "start two servers");
+    if (failed) {
+        return 1;
+    }
+    corpc::NetAddress::ptr addrA = std::make_shared<corpc::IPAddress>("127.0.0.1", portA);
+    corpc::NetAddress::ptr addrB = std::make_shared<corpc::IPAddress>("127.0.0.1", portB);
+
+    corpc::ServiceEndpoints::ptr endpoints = std::make_shared<corpc::ServiceEndpoints>("QueryService");
+    endpoints->update({addrA});
+    corpc::PbRpcChannel::ptr channel = std::make_shared<corpc::PbRpcChannel>(endpoints, corpc::LoadBalanceCategory::Round);
+
+    // 调用期间不断切换地址和负载均衡策略
+    std::atomic<bool> stop{false};
+    std::atomic<int> changes{0};
+    std::thread changer([&]() {
+        std::vector<std::vector<corpc::NetAddress::ptr>> addrSets = {{addrA}, {addrB}, {addrA, addrB}};
+        std::vector<corpc::LoadBalanceStrategy::ptr> strategies = {
+            corpc::LoadBalance::queryStrategy(corpc::LoadBalanceCategory::Round),
+            std::make_shared<corpc::ConsistentHashLoadBalanceStrategy>(),
+            corpc::LoadBalance::queryStrategy(corpc::LoadBalanceCategory::P2C),
+        };
+        for (int i = 0; !stop; ++i) {
+            endpoints->update(addrSets[i % addrSets.size()]);
+            if (i % 2 == 0) {
+                channel->setLoadBalanceStrategy(strategies[(i / 2) % strategies.size()]);
+            }
+            changes++;
+            usleep(200);
+        }
+    });
+
+    std::atomic<int> succ{0};
+    std::atomic<int> mismatched{0};
+    std::atomic<int> fromA{0};
+    std::atomic<int> fromB{0};
+    std::vector<std::thread> callers;
+    for (int c = 0; c < CALLER_NUM; ++c) {
+        callers.emplace_back([&, c]() {
+            for (int b = 0; b < BATCH_NUM; ++b) {
+                std::vector<corpc::RpcFuture<queryNameRes>::ptr> futures;
+                for (int i = 0; i < BATCH_SIZE; ++i) {
+                    queryNameReq req;
+                    req.set_id((c * BATCH_NUM + b) * BATCH_SIZE + i);
+                    corpc::PbRpcController::ptr controller = std::make_shared<corpc::PbRpcController>();
+                    controller->SetTimeout(3000);
+                    futures.push_back(corpc::asyncCall(channel, &QueryService_Stub::query_name, req, controller));
+                }
+                corpc::whenAll(futures);
+                for (int i = 0; i < BATCH_SIZE; ++i) {
+                    corpc::RpcFuture<queryNameRes>::ptr &future = futures[i];
+                    if (future->controller()->ErrorCode() != 0) {
+                        std::cout << "call error " << future->controller()->ErrorCode() << ", " << future->controller()->ErrorText() << std::endl;
+                        continue;
+                    }
+                    if (future->value().id() != (c * BATCH_NUM + b) * BATCH_SIZE + i) {
+                        mismatched++;
+                        continue;
+                    }
+                    succ++;
+                    (future->value().name() == std::to_string(portA) ? fromA : fromB)++;
+                }
+            }
+        });
+    }
+    for (auto &caller : callers) {
+        caller.join();
+    }
+    stop = true;
+    changer.join();
+
+    int total = CALLER_NUM * BATCH_NUM * BATCH_SIZE;
+    std::cout << "calls=" << total << ", succ=" << succ << ", from A=" << fromA << ", from B=" << fromB << ", endpoint changes=" << changes << std::endl;
+    check(succ == total, "all concurrent async calls succeed while endpoints change");
+    check(mismatched == 0, "every reply matches its request");
+    check(fromA > 0 && fromB > 0, "calls follow the changing endpoints");
+
+    std::cout << (failed ? "test_pb_channel_concurrency failed" : "test_pb_channel_concurrency passed") << std::endl;
+    _exit(failed ? 1 : 0);
+}
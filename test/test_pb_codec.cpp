@@ -0,0 +1,198 @@
+#include <iostream>
+#include <string>
+#include "corpc/common/compress.h"
+#include "corpc/common/error_code.h"
+#include "corpc/net/pb/pb_codec.h"
+#include "corpc/net/pb/pb_data.h"
+#include "corpc/net/tcp/tcp_buffer.h"
+
+/*
+ * pb编解码测试：v1和v2格式的包编码之后能原样解出来，分段收到的包要等收完整才解码，
+ * v2的包在传输中损坏时能发现，并且不影响后面的包
+ */
+
+static int failed = 0;
+
+static void check(bool cond, const std::string &what)
+{
+    std::cout << (cond ? "[PASS] " : "[FAIL] ") << what << std::endl;
+    if (!cond) {
+        failed++;
+    }
+}
+
+static corpc::PbStruct makeRequest(int version, const std::string &msgSeq)
+{
+    corpc::PbStruct pk;
+    pk.serviceFullName = "QueryService.query_name";
+    pk.msgSeq = msgSeq;
+    pk.pbData = "abcdef";
+    pk.protoVersion = version;
+    pk.meta["timeout"] = "1000";
+    return pk;
+}
+
+static std::string encode(corpc::PbCodeC &codec, corpc::PbStruct &pk)
+{
+    corpc::TcpBuffer buf(16);
+    codec.encode(&buf, &pk);
+    return pk.encodeSucc_ ? buf.getBufferString() : "";
+}
+
+// 一个字节一个字节地收，只有收完整之后才能解码成功
+static bool decodeByteByByte(corpc::PbCodeC &codec, const std::string &frame, corpc::PbStruct &out)
+{
+    corpc::TcpBuffer buf(4);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        buf.writeToBuffer(&frame[i], 1);
+        codec.decode(&buf, &out);
+        if (out.decodeSucc_) {
+            return i + 1 == frame.size() && buf.readAble() == 0;
+        }
+    }
+    return false;
+}
+
+static void testRoundTrip(corpc::PbCodeC &codec)
+{
+    for (int version = 1; version <= 2; ++version) {
+        // 数字序列号在v2中按varint编码，其他的按字符串编码
+        for (const std::string &msgSeq : {std::string("42"), std::string("12345678901234567890"), std::string("seq-abc")}) {
+            corpc::PbStruct req = makeRequest(version, msgSeq);
+            std::string frame = encode(codec, req);
+            corpc::PbStruct out;
+            bool succ = decodeByteByByte(codec, frame, out);
+            bool same = succ && out.protoVersion == version && out.msgSeq == msgSeq && out.pbData == "abcdef" && out.meta["timeout"] == "1000";
+            if (version == 1) {
+                same = same && out.serviceFullName == req.serviceFullName;
+            }
+            else {
+                same = same && out.methodId == req.methodId && out.methodId != 0 && !out.isReply;
+            }
+            check(same, "v" + std::to_string(version) + " request round trip, msgSeq=" + msgSeq);
+        }
+    }
+
+    corpc::PbStruct reply;
+    reply.msgSeq = "7";
+    reply.protoVersion = 2;
+    reply.isReply = true;
+    reply.errCode = corpc::ERROR_METHOD_NOT_FOUND;
+    reply.errInfo = "not found method";
+    reply.withChecksum = true;
+    std::string frame = encode(codec, reply);
+    corpc::PbStruct out;
+    bool succ = decodeByteByByte(codec, frame, out);
+    check(succ && out.isReply && out.withChecksum && out.errCode == reply.errCode && out.errInfo == reply.errInfo, "v2 reply with error and checksum round trip");
+
+    corpc::PbStruct big = makeRequest(2, "8");
+    big.pbData = std::string(4096, 'x');
+    big.compressType = corpc::COMPRESS_ZLIB;
+    big.withChecksum = true;
+    frame = encode(codec, big);
+    out = corpc::PbStruct();
+    succ = decodeByteByByte(codec, frame, out);
+    check(succ && frame.size() < big.pbData.size() && out.pbData == big.pbData && out.compressType == corpc::COMPRESS_ZLIB, "v2 compressed request round trip");
+}
+
+static void testMixedVersions(corpc::PbCodeC &codec)
+{
+    // 同一个连接上v1和v2的包可以交替出现
+    corpc::PbStruct v1 = makeRequest(1, "1");
+    corpc::PbStruct v2 = makeRequest(2, "2");
+    std::string frames = encode(codec, v1) + encode(codec, v2) + encode(codec, v1);
+    corpc::TcpBuffer buf(16);
+    buf.writeToBuffer(frames.data(), frames.size());
+    int versions[3] = {0, 0, 0};
+    for (int i = 0; i < 3; ++i) {
+        corpc::PbStruct out;
+        codec.decode(&buf, &out);
+        versions[i] = out.decodeSucc_ ? out.protoVersion : 0;
+    }
+    check(versions[0] == 1 && versions[1] == 2 && versions[2] == 1 && buf.readAble() == 0, "v1 and v2 frames in one buffer");
+}
+
+static void testV1Meta(corpc::PbCodeC &codec)
+{
+    // 附加信息中的分隔符要转义，解码之后和原来一样
+    corpc::PbStruct req = makeRequest(1, "200");
+    req.meta["trace"] = "a=1&b=%2\x01";
+    req.meta["k&="] = "";
+    corpc::PbStruct out;
+    bool succ = decodeByteByByte(codec, encode(codec, req), out);
+    check(succ && out.meta == req.meta && out.errInfo.empty(), "v1 meta with separators round trip");
+
+    // 成功的回包中的errInfo不是附加信息
+    corpc::PbStruct reply;
+    reply.serviceFullName = "QueryService.query_name";
+    reply.msgSeq = "201";
+    reply.isReply = true;
+    reply.errInfo = "a=1&b=2";
+    out = corpc::PbStruct();
+    succ = decodeByteByByte(codec, encode(codec, reply), out);
+    check(succ && out.meta.empty() && out.errInfo == reply.errInfo, "v1 reply errInfo is not parsed as meta");
+}
+
+static void testMaxMessageSize(corpc::PbCodeC &codec)
+{
+    // 没有配置时最大4MB，压缩之后很小但是解压之后超过的包按解压失败处理，不会按声明的长度分配内存
+    corpc::PbStruct bomb = makeRequest(2, "300");
+    bomb.pbData = std::string(5 * 1024 * 1024, 'z');
+    bomb.compressType = corpc::COMPRESS_ZLIB;
+    std::string frame = encode(codec, bomb);
+    corpc::TcpBuffer buf(16);
+    buf.writeToBuffer(frame.data(), frame.size());
+    corpc::PbStruct out;
+    codec.decode(&buf, &out);
+    check(!frame.empty() && out.decodeSucc_ && out.errCode == corpc::ERROR_FAILED_DECOMPRESS && out.pbData.empty(), "v2 pb data decompressed over the max size is rejected");
+
+    corpc::PbStruct large = makeRequest(2, "301");
+    large.pbData = std::string(5 * 1024 * 1024, 'z');
+    check(encode(codec, large).empty(), "v2 frame over the max size is not encoded");
+}
+
+static void testCorruptedFrame(corpc::PbCodeC &codec)
+{
+    corpc::PbStruct req = makeRequest(2, "100");
+    req.withChecksum = true;
+    std::string corrupted = encode(codec, req);
+    corpc::PbStruct next = makeRequest(2, "101");
+    next.withChecksum = true;
+    std::string good = encode(codec, next);
+    // 改掉pbData中的一个字节，长度不变，只有校验能发现
+    corrupted[corrupted.size() - 6] ^= 0x20;
+
+    corpc::TcpBuffer buf(16);
+    std::string frames = corrupted + good;
+    buf.writeToBuffer(frames.data(), frames.size());
+    corpc::PbStruct out;
+    codec.decode(&buf, &out);
+    check(out.decodeSucc_ && out.errCode == corpc::ERROR_CHECKSUM_MISMATCH && out.msgSeq == "100" && out.pbData.empty() && out.serviceFullName.empty() && out.methodId == 0,
+          "corrupted v2 frame reports checksum mismatch and keeps msgSeq");
+
+    corpc::PbStruct after;
+    codec.decode(&buf, &after);
+    check(after.decodeSucc_ && after.errCode == 0 && after.msgSeq == "101" && after.pbData == "abcdef" && buf.readAble() == 0, "frame after the corrupted one still decodes");
+
+    // 不带校验的包改掉flags，不认识的格式直接丢弃
+    corpc::PbStruct plain = makeRequest(2, "102");
+    std::string bad = encode(codec, plain);
+    bad[2] = (char)0xff;
+    corpc::TcpBuffer badBuf(16);
+    badBuf.writeToBuffer(bad.data(), bad.size());
+    corpc::PbStruct dropped;
+    codec.decode(&badBuf, &dropped);
+    check(!dropped.decodeSucc_ && badBuf.readAble() == 0, "v2 frame with unknown flags is dropped");
+}
+
+int main(int argc, char *argv[])
+{
+    corpc::PbCodeC codec;
+    testRoundTrip(codec);
+    testMixedVersions(codec);
+    testV1Meta(codec);
+    testMaxMessageSize(codec);
+    testCorruptedFrame(codec);
+    std::cout << (failed ? "test_pb_codec failed" : "test_pb_codec passed") << std::endl;
+    return failed ? 1 : 0;
+}
@@ -17,10 +17,11 @@ corpc::IPAddress::ptr gAddr = std::make_shared<corpc::IPAddress>("127.0.0.1", 20
 void testClient()
 {
     corpc::AbstractServiceRegister::ptr center = corpc::ServiceRegister::queryRegister(corpc::ServiceRegisterCategory::Zk);
-    std::vector<corpc::NetAddress::ptr> addrs = center->discoverService("QueryService");
+    // 订阅服务地址，之后地址的变化由zk的watcher推送到本地缓存
+    corpc::ServiceEndpoints::ptr endpoints = center->subscribeService("QueryService");
 
     // corpc::PbRpcChannel channel(gAddr);
-    corpc::PbRpcChannel channel(addrs, corpc::LoadBalanceCategory::Round);
+    corpc::PbRpcChannel channel(endpoints, corpc::LoadBalanceCategory::Round);
     QueryService_Stub stub(&channel);
 
     corpc::PbRpcController rpcControllerName;
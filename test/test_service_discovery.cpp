@@ -0,0 +1,210 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <zookeeper/zookeeper.h>
+#include "corpc/net/register/zk_service_register.h"
+
+/*
+ * 进程内的假zookeeper，替换掉zookeeper_mt中用到的接口，用来测试服务发现缓存
+ * watcher在调用线程中同步触发，和真实zk一样是一次性的，会话过期后旧会话上的watcher全部丢失
+ */
+
+struct _zhandle {
+    watcher_fn watcher;
+    void *context;
+    bool expired;
+};
+
+// 节点路径 -> 子节点名
+static std::map<std::string, std::set<std::string>> gNodes;
+// 节点路径 -> 设置了子节点watcher的会话
+static std::map<std::string, std::set<zhandle_t *>> gChildWatches;
+static std::map<zhandle_t *, watcher_fn> gChildWatchers;
+static zhandle_t *gSession = nullptr;
+
+extern "C" {
+
+const int ZOO_SESSION_EVENT = -1;
+const int ZOO_CONNECTED_STATE = 3;
+const int ZOO_EXPIRED_SESSION_STATE = -112;
+const int ZOO_CHILD_EVENT = 4;
+struct ACL_vector ZOO_OPEN_ACL_UNSAFE = {0, nullptr};
+
+zhandle_t *zookeeper_init(const char *host, watcher_fn fn, int recv_timeout, const clientid_t *clientid, void *context, int flags)
+{
+    gSession = new _zhandle{fn, context, false};
+    fn(gSession, ZOO_SESSION_EVENT, ZOO_CONNECTED_STATE, nullptr, context);
+    return gSession;
+}
+
+int zookeeper_close(zhandle_t *zh)
+{
+    if (zh == gSession) {
+        gSession = nullptr;
+    }
+    delete zh;
+    return ZOK;
+}
+
+const void *zoo_get_context(zhandle_t *zh)
+{
+    return zh->context;
+}
+
+void zoo_set_context(zhandle_t *zh, void *context)
+{
+    zh->context = context;
+}
+
+int zoo_exists(zhandle_t *zh, const char *path, int watch, struct Stat *stat)
+{
+    return gNodes.count(path) ? ZOK : ZNONODE;
+}
+
+int zoo_create(zhandle_t *zh, const char *path, const char *value, int valuelen,
+    const struct ACL_vector *acl, int flags, char *path_buffer, int path_buffer_len)
+{
+    std::string node(path);
+    gNodes[node];
+    size_t i = node.rfind('/');
+    if (i != 0 && i != node.npos) {
+        gNodes[node.substr(0, i)].insert(node.substr(i + 1));
+    }
+    return ZOK;
+}
+
+int zoo_delete(zhandle_t *zh, const char *path, int version)
+{
+    std::string node(path);
+    gNodes.erase(node);
+    size_t i = node.rfind('/');
+    if (i != 0 && i != node.npos) {
+        gNodes[node.substr(0, i)].erase(node.substr(i + 1));
+    }
+    return ZOK;
+}
+
+int zoo_get(zhandle_t *zh, const char *path, int watch, char *buffer, int *buffer_len, struct Stat *stat)
+{
+    return ZNONODE;
+}
+
+int zoo_wget_children(zhandle_t *zh, const char *path, watcher_fn watcher, void *watcherCtx, struct String_vector *strings)
+{
+    auto it = gNodes.find(path);
+    if (it == gNodes.end()) {
+        return ZNONODE;
+    }
+    if (!zh->expired) {
+        gChildWatches[path].insert(zh);
+        gChildWatchers[zh] = watcher;
+    }
+    strings->count = it->second.size();
+    strings->data = (char **)calloc(strings->count, sizeof(char *));
+    int i = 0;
+    for (const std::string &child : it->second) {
+        strings->data[i++] = strdup(child.c_str());
+    }
+    return ZOK;
+}
+
+int deallocate_String_vector(struct String_vector *v)
+{
+    for (int i = 0; i < v->count; ++i) {
+        free(v->data[i]);
+    }
+    free(v->data);
+    v->data = nullptr;
+    v->count = 0;
+    return ZOK;
+}
+
+void zoo_set_debug_level(ZooLogLevel logLevel) {}
+
+int zoo_recv_timeout(zhandle_t *zh)
+{
+    return 30000;
+}
+
+}
+
+// 修改子节点并触发一次性的watcher
+static void setChild(const std::string &path, const std::string &child, bool add)
+{
+    std::string node = path + "/" + child;
+    if (add) {
+        zoo_create(gSession, node.c_str(), nullptr, 0, &ZOO_OPEN_ACL_UNSAFE, 0, nullptr, 0);
+    }
+    else {
+        zoo_delete(gSession, node.c_str(), -1);
+    }
+    std::set<zhandle_t *> watches;
+    watches.swap(gChildWatches[path]);
+    for (zhandle_t *zh : watches) {
+        gChildWatchers[zh](zh, ZOO_CHILD_EVENT, ZOO_CONNECTED_STATE, path.c_str(), nullptr);
+    }
+}
+
+// 会话过期，服务端删除该会话的所有watcher
+static zhandle_t *expireSession()
+{
+    zhandle_t *old = gSession;
+    old->expired = true;
+    for (auto &item : gChildWatches) {
+        item.second.erase(old);
+    }
+    return old;
+}
+
+// 客户端收到会话过期的通知
+static void notifyExpired(zhandle_t *old)
+{
+    old->watcher(old, ZOO_SESSION_EVENT, ZOO_EXPIRED_SESSION_STATE, nullptr, old->context);
+}
+
+static int failed = 0;
+
+static void check(bool cond, const std::string &what)
+{
+    std::cout << (cond ? "[PASS] " : "[FAIL] ") << what << std::endl;
+    if (!cond) {
+        failed++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string servicePath = "/corpc/QueryService";
+    corpc::ZkServiceRegister *reg = new corpc::ZkServiceRegister("127.0.0.1", 2181, 30000);
+    zoo_create(gSession, servicePath.c_str(), nullptr, 0, &ZOO_OPEN_ACL_UNSAFE, 0, nullptr, 0);
+    setChild(servicePath, "127.0.0.1:20001", true);
+
+    corpc::ServiceEndpoints::ptr endpoints = reg->subscribeService("QueryService");
+    check(endpoints->snapshot()->addrs.size() == 1 && endpoints->version() == 1, "first subscribe fetches endpoints");
+
+    setChild(servicePath, "127.0.0.1:20002", true);
+    check(endpoints->snapshot()->addrs.size() == 2 && endpoints->version() == 2, "watch refreshes endpoints on child added");
+
+    setChild(servicePath, "127.0.0.1:20001", false);
+    corpc::EndpointSnapshot::ptr snap = endpoints->snapshot();
+    check(snap->addrs.size() == 1 && snap->addrs[0]->toString() == "127.0.0.1:20002", "watch is re-armed and refreshes on child removed");
+
+    // 会话过期期间发生的变化收不到通知
+    zhandle_t *old = expireSession();
+    setChild(servicePath, "127.0.0.1:20003", true);
+    check(endpoints->snapshot()->addrs.size() == 1, "changes are missed while session is expired");
+
+    notifyExpired(old);
+    check(endpoints->snapshot()->addrs.size() == 2, "reconnect reloads subscribed services");
+    check(reg->discoverService("QueryService").size() == 2, "reconnect drops stale children cache");
+
+    setChild(servicePath, "127.0.0.1:20004", true);
+    check(endpoints->snapshot()->addrs.size() == 3, "watch is re-armed on the new session");
+
+    delete reg;
+    std::cout << (failed ? "test_service_discovery failed" : "test_service_discovery passed") << std::endl;
+    return failed ? 1 : 0;
+}